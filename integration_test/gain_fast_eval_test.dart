@@ -0,0 +1,101 @@
+// ゲインの高速モード（22 kHz・等間隔の抜粋）を全体の計測と比べる
+// ネイティブライブラリは端末上でしか動かないため、実機で次のように実行する
+//
+//   flutter drive --driver=test_driver/integration_test.dart \
+//     --target=integration_test/gain_fast_eval_test.dart \
+//     --dart-define=GAIN_EVAL_DIR=<アプリが読める音声ファイルのディレクトリ>
+//
+// 曲ごとの行と、最後に集計（ラウドネスの誤差の平均と最大、推定誤差の範囲に
+// 収まった割合、時間の比）を出力する
+import 'dart:io';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:integration_test/integration_test.dart';
+import 'package:segue/src/native/audio_analysis.dart';
+
+const _evalDir = String.fromEnvironment('GAIN_EVAL_DIR');
+const _extensions = ['.mp3', '.flac', '.m4a', '.ogg', '.opus', '.wav'];
+// ReplayGain で聞き分けにくいとされる差
+const _toleranceLu = 1.0;
+
+void main() {
+  IntegrationTestWidgetsFlutterBinding.ensureInitialized();
+
+  test('fast gain measurement against the full pass', () async {
+    final files = Directory(_evalDir)
+        .listSync(recursive: true)
+        .whereType<File>()
+        .map((file) => file.path)
+        .where((path) => _extensions.any(path.toLowerCase().endsWith))
+        .toList();
+    files.sort();
+    expect(files, isNotEmpty, reason: 'no audio files in GAIN_EVAL_DIR');
+
+    AudioAnalysis.ensureInitialized();
+
+    var compared = 0;
+    var excerpted = 0;
+    var errorSum = 0.0;
+    var maxError = 0.0;
+    var withinTolerance = 0;
+    var withinUncertainty = 0;
+    var fullTime = Duration.zero;
+    var fastTime = Duration.zero;
+
+    for (final (index, path) in files.indexed) {
+      Future<(TrackGain?, Duration)> run(bool fast) async {
+        final stopwatch = Stopwatch()..start();
+        final gains = await AudioAnalysis.analyzeGainBatch([path], fast: fast);
+        return (gains.single, stopwatch.elapsed);
+      }
+
+      // ファイルキャッシュの効く 2 回目が偏らないよう、曲ごとに順番を入れ替える
+      final first = await run(index.isOdd);
+      final second = await run(index.isEven);
+      final (full, fullElapsed) = index.isEven ? first : second;
+      final (fast, fastElapsed) = index.isEven ? second : first;
+      if (full == null || fast == null || full.failed || fast.failed) {
+        debugPrint('skipped (measurement failed): $path');
+        continue;
+      }
+
+      final error = (fast.integratedLufs - full.integratedLufs).abs();
+      compared++;
+      if (fast.uncertaintyLu > 0) excerpted++;
+      errorSum += error;
+      if (error > maxError) maxError = error;
+      if (error <= _toleranceLu) withinTolerance++;
+      // 推定誤差は標準誤差なので、その 2 倍を 95 % の範囲とみなす
+      // 全体を測った曲は推定誤差が 0 なので数えない
+      if (fast.uncertaintyLu > 0 && error <= 2 * fast.uncertaintyLu) {
+        withinUncertainty++;
+      }
+      fullTime += fullElapsed;
+      fastTime += fastElapsed;
+      debugPrint(
+        'full ${full.integratedLufs.toStringAsFixed(2)} LUFS, '
+        'fast ${fast.integratedLufs.toStringAsFixed(2)} LUFS '
+        '(±${fast.uncertaintyLu.toStringAsFixed(2)}), '
+        'error ${error.toStringAsFixed(2)} LU, '
+        'full ${fullElapsed.inMilliseconds} ms, '
+        'fast ${fastElapsed.inMilliseconds} ms: $path',
+      );
+    }
+
+    expect(compared, greaterThan(0));
+    String percent(int count, int total) => total == 0
+        ? '-'
+        : '${(100 * count / total).toStringAsFixed(1)} %';
+    final timeRatio = fastTime.inMicroseconds / fullTime.inMicroseconds;
+    debugPrint(
+      '$compared tracks ($excerpted from excerpts): '
+      'mean error ${(errorSum / compared).toStringAsFixed(2)} LU, '
+      'max error ${maxError.toStringAsFixed(2)} LU, '
+      'within $_toleranceLu LU ${percent(withinTolerance, compared)}, '
+      'excerpts within 2x uncertainty '
+      '${percent(withinUncertainty, excerpted)}, '
+      'fast/full time ${timeRatio.toStringAsFixed(2)}',
+    );
+  }, timeout: Timeout.none);
+}
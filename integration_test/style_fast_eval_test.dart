@@ -0,0 +1,114 @@
+// classifyStyle の高速モード（パッチの間引きと早期打ち切り）を
+// 全パッチの分類と比べる
+// ネイティブライブラリは端末上でしか動かないため、実機で次のように実行する
+//
+//   flutter drive --driver=test_driver/integration_test.dart \
+//     --target=integration_test/style_fast_eval_test.dart \
+//     --dart-define=STYLE_EVAL_DIR=<アプリが読める音声ファイルのディレクトリ>
+//
+// 曲ごとの行と、最後に集計（上位 5 件の一致数、1 位の一致率、順位のずれ、
+// 時間の比）を出力する
+import 'dart:io';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:integration_test/integration_test.dart';
+import 'package:segue/src/native/audio_analysis.dart';
+import 'package:segue/src/native/model_manager.dart';
+
+const _evalDir = String.fromEnvironment('STYLE_EVAL_DIR');
+const _extensions = ['.mp3', '.flac', '.m4a', '.ogg', '.opus', '.wav'];
+const _top = 5;
+
+void main() {
+  IntegrationTestWidgetsFlutterBinding.ensureInitialized();
+
+  test('fast style classification against the full pass', () async {
+    final files = Directory(_evalDir)
+        .listSync(recursive: true)
+        .whereType<File>()
+        .map((file) => file.path)
+        .where((path) => _extensions.any(path.toLowerCase().endsWith))
+        .toList();
+    files.sort();
+    expect(files, isNotEmpty, reason: 'no audio files in STYLE_EVAL_DIR');
+
+    AudioAnalysis.ensureInitialized();
+    final modelPath = await ModelManager.ensureModel(
+      'models/discogs-effnet-bsdynamic-1.onnx',
+    );
+
+    // セッション生成を時間に含めないよう、先に 1 曲分類しておく
+    await AudioAnalysis.classifyStyle(
+      pathStr: files.first,
+      modelPath: modelPath,
+    );
+
+    var compared = 0;
+    var overlapSum = 0;
+    var top1Matches = 0;
+    var rankShiftSum = 0;
+    var fullTime = Duration.zero;
+    var fastTime = Duration.zero;
+
+    for (final (index, path) in files.indexed) {
+      Future<(List<StylePrediction>?, Duration)> run(bool fast) async {
+        final stopwatch = Stopwatch()..start();
+        final styles = await AudioAnalysis.classifyStyle(
+          pathStr: path,
+          modelPath: modelPath,
+          fast: fast,
+        );
+        return (styles, stopwatch.elapsed);
+      }
+
+      // ファイルキャッシュの効く 2 回目が偏らないよう、曲ごとに順番を入れ替える
+      final first = await run(index.isOdd);
+      final second = await run(index.isEven);
+      final (full, fullElapsed) = index.isEven ? first : second;
+      final (fast, fastElapsed) = index.isEven ? second : first;
+      if (full == null || fast == null || full.isEmpty || fast.isEmpty) {
+        debugPrint('skipped (classification failed): $path');
+        continue;
+      }
+
+      final fullTop = full.take(_top).map((p) => p.labelIndex).toList();
+      final fastRanks = fast.map((p) => p.labelIndex).toList();
+      final overlap = fullTop
+          .where((label) => fastRanks.take(_top).contains(label))
+          .length;
+      // 全パッチの上位 5 件が高速モードで何位ずれたか
+      // 返された範囲外は最下位の次とみなす
+      var rankShift = 0;
+      for (final (rank, label) in fullTop.indexed) {
+        final fastRank = fastRanks.indexOf(label);
+        rankShift += ((fastRank < 0 ? fastRanks.length : fastRank) - rank)
+            .abs();
+      }
+
+      compared++;
+      overlapSum += overlap;
+      if (fullTop.first == fastRanks.first) top1Matches++;
+      rankShiftSum += rankShift;
+      fullTime += fullElapsed;
+      fastTime += fastElapsed;
+      debugPrint(
+        'top-$_top overlap $overlap/$_top, '
+        'top-1 ${fullTop.first == fastRanks.first ? 'same' : 'differs'}, '
+        'rank shift $rankShift, full ${fullElapsed.inMilliseconds} ms, '
+        'fast ${fastElapsed.inMilliseconds} ms: $path',
+      );
+    }
+
+    expect(compared, greaterThan(0));
+    final timeRatio = fastTime.inMicroseconds / fullTime.inMicroseconds;
+    debugPrint(
+      '$compared tracks: '
+      'mean top-$_top overlap ${(overlapSum / compared).toStringAsFixed(2)}, '
+      'top-1 agreement '
+      '${(100 * top1Matches / compared).toStringAsFixed(1)} %, '
+      'mean rank shift ${(rankShiftSum / compared).toStringAsFixed(2)}, '
+      'fast/full time ${timeRatio.toStringAsFixed(2)}',
+    );
+  }, timeout: Timeout.none);
+}
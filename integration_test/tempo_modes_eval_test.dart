@@ -0,0 +1,230 @@
+// テンポの precise（RhythmExtractor2013）と fast（間引いたオンセット包絡）を
+// 合成したクリックトラックで比べる
+// ネイティブライブラリは端末上でしか動かないため、実機で次のように実行する
+//
+//   flutter drive --driver=test_driver/integration_test.dart \
+//     --target=integration_test/tempo_modes_eval_test.dart
+//
+// 曲ごとの行と、最後にモードごとの集計（Acc1 / Acc2、拍の F 値、BPM の誤差、
+// 解析時間）を出力する。信頼度は Acc1 の当たり外れごとの平均と、両者を最もよく
+// 分ける閾値も出すので、抜粋解析の打ち切り閾値をモードごとに合わせるのに使う
+import 'dart:io';
+import 'dart:math';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:integration_test/integration_test.dart';
+import 'package:segue/src/native/audio_analysis.dart';
+
+const _sampleRate = 44100;
+const _seconds = 60;
+const _bpms = [72.0, 86.0, 100.0, 118.0, 124.0, 128.0, 140.0, 150.0, 174.0];
+// Acc1 / Acc2 の許容誤差（MIREX と同じ 4 %）と、拍の一致とみなす範囲
+const _bpmTolerance = 0.04;
+const _beatTolerance = 0.07;
+
+class _ClickTrack {
+  final String name;
+  final double bpm;
+  final double firstBeat; // 秒
+  final double noiseLevel; // クリックに対する振幅比。0 = 無音の背景
+  final double jitter; // 各拍の時刻の揺れ（秒、一様分布の幅の半分）
+
+  const _ClickTrack(
+    this.name,
+    this.bpm, {
+    this.firstBeat = 0.0,
+    this.noiseLevel = 0.0,
+    this.jitter = 0.0,
+  });
+}
+
+List<_ClickTrack> _suite() => [
+  for (final bpm in _bpms) ...[
+    _ClickTrack('clean', bpm),
+    _ClickTrack('offset', bpm, firstBeat: 0.37),
+    _ClickTrack('noise', bpm, noiseLevel: 0.1),
+    _ClickTrack('jitter', bpm, firstBeat: 0.2, jitter: 0.01),
+  ],
+];
+
+// 1 小節の頭を強めた 1 kHz の減衰するクリック。戻り値は正解の拍位置（秒）
+List<double> _writeClickTrack(_ClickTrack track, String path) {
+  final random = Random(track.bpm.round() * 31 + track.name.length);
+  final samples = Float64List(_sampleRate * _seconds);
+  for (var i = 0; i < samples.length; i++) {
+    samples[i] = track.noiseLevel * (2 * random.nextDouble() - 1);
+  }
+
+  final beats = <double>[];
+  final period = 60.0 / track.bpm;
+  for (var n = 0; ; n++) {
+    final offset = track.jitter * (2 * random.nextDouble() - 1);
+    final time = track.firstBeat + n * period + offset;
+    if (time >= _seconds - 0.05) break;
+    beats.add(time);
+    final start = (time * _sampleRate).round();
+    final gain = n % 4 == 0 ? 0.9 : 0.6;
+    for (var i = 0; i < _sampleRate ~/ 50; i++) {
+      final t = i / _sampleRate;
+      samples[start + i] += gain * exp(-t * 200) * sin(2 * pi * 1000 * t);
+    }
+  }
+
+  final data = ByteData(44 + samples.length * 2);
+  void ascii(int offset, String text) {
+    for (var i = 0; i < text.length; i++) {
+      data.setUint8(offset + i, text.codeUnitAt(i));
+    }
+  }
+
+  ascii(0, 'RIFF');
+  data.setUint32(4, 36 + samples.length * 2, Endian.little);
+  ascii(8, 'WAVE');
+  ascii(12, 'fmt ');
+  data.setUint32(16, 16, Endian.little);
+  data.setUint16(20, 1, Endian.little); // PCM
+  data.setUint16(22, 1, Endian.little); // モノラル
+  data.setUint32(24, _sampleRate, Endian.little);
+  data.setUint32(28, _sampleRate * 2, Endian.little);
+  data.setUint16(32, 2, Endian.little);
+  data.setUint16(34, 16, Endian.little);
+  ascii(36, 'data');
+  data.setUint32(40, samples.length * 2, Endian.little);
+  for (var i = 0; i < samples.length; i++) {
+    final value = (samples[i].clamp(-1.0, 1.0) * 32767).round();
+    data.setInt16(44 + i * 2, value, Endian.little);
+  }
+  File(path).writeAsBytesSync(data.buffer.asUint8List());
+  return beats;
+}
+
+// 正解の拍と推定した拍を ±_beatTolerance で 1 対 1 に対応させた F 値
+double _beatFMeasure(List<double> reference, List<double> estimated) {
+  if (reference.isEmpty || estimated.isEmpty) return 0;
+  var matched = 0;
+  var j = 0;
+  for (final beat in reference) {
+    while (j < estimated.length && estimated[j] < beat - _beatTolerance) {
+      j++;
+    }
+    if (j < estimated.length && estimated[j] <= beat + _beatTolerance) {
+      matched++;
+      j++;
+    }
+  }
+  final precision = matched / estimated.length;
+  final recall = matched / reference.length;
+  return precision + recall == 0
+      ? 0
+      : 2 * precision * recall / (precision + recall);
+}
+
+class _ModeStats {
+  int count = 0;
+  int acc1 = 0;
+  int acc2 = 0;
+  double fMeasureSum = 0;
+  double errorSum = 0; // 相対誤差（%）
+  Duration time = Duration.zero;
+  final hitConfidences = <double>[];
+  final missConfidences = <double>[];
+
+  // 閾値以上を当たりとみなしたときの、当たりと外れの正答率の平均が最大になる値
+  double? bestThreshold() {
+    if (hitConfidences.isEmpty || missConfidences.isEmpty) return null;
+    double? best;
+    var bestScore = -1.0;
+    for (final threshold in [...hitConfidences, ...missConfidences]) {
+      final hits = hitConfidences.where((c) => c >= threshold).length;
+      final misses = missConfidences.where((c) => c < threshold).length;
+      final score =
+          hits / hitConfidences.length + misses / missConfidences.length;
+      if (score > bestScore) {
+        bestScore = score;
+        best = threshold;
+      }
+    }
+    return best;
+  }
+
+  String confidenceSummary(String name) {
+    String mean(List<double> values) => values.isEmpty
+        ? '-'
+        : (values.reduce((a, b) => a + b) / values.length).toStringAsFixed(3);
+    return '$name confidence: Acc1 hits mean ${mean(hitConfidences)}, '
+        'misses mean ${mean(missConfidences)}, '
+        'best threshold ${bestThreshold()?.toStringAsFixed(3) ?? '-'}';
+  }
+
+  String summary(String name) =>
+      '$name: Acc1 ${(100 * acc1 / count).toStringAsFixed(1)} %, '
+      'Acc2 ${(100 * acc2 / count).toStringAsFixed(1)} %, '
+      'beat F ${(fMeasureSum / count).toStringAsFixed(3)}, '
+      'mean BPM error ${(errorSum / count).toStringAsFixed(2)} %, '
+      'mean time ${time.inMilliseconds ~/ count} ms';
+}
+
+void main() {
+  IntegrationTestWidgetsFlutterBinding.ensureInitialized();
+
+  test('precise and fast tempo modes on click tracks', () async {
+    AudioAnalysis.ensureInitialized();
+    final dir = await Directory.systemTemp.createTemp('click_tracks');
+    final stats = {for (final mode in TempoMode.values) mode: _ModeStats()};
+
+    try {
+      for (final track in _suite()) {
+        final path = '${dir.path}/${track.name}_${track.bpm}.wav';
+        final reference = _writeClickTrack(track, path);
+
+        for (final mode in TempoMode.values) {
+          final stopwatch = Stopwatch()..start();
+          final result = await AudioAnalysis.analyze(
+            pathStr: path,
+            tempoMode: mode,
+          );
+          final elapsed = stopwatch.elapsed;
+          final modeStats = stats[mode]!..count++;
+          modeStats.time += elapsed;
+          if (result == null) {
+            debugPrint('${mode.name} failed: ${track.name} ${track.bpm}');
+            continue;
+          }
+
+          final error = (result.bpm - track.bpm).abs() / track.bpm;
+          final octaveHit = [2.0, 0.5, 3.0, 1 / 3].any((factor) {
+            final target = track.bpm * factor;
+            return (result.bpm - target).abs() <= _bpmTolerance * target;
+          });
+          final fMeasure = _beatFMeasure(reference, result.beatTicks);
+          if (error <= _bpmTolerance) {
+            modeStats.acc1++;
+            modeStats.hitConfidences.add(result.bpmConfidence);
+          } else {
+            modeStats.missConfidences.add(result.bpmConfidence);
+          }
+          if (error <= _bpmTolerance || octaveHit) modeStats.acc2++;
+          modeStats.fMeasureSum += fMeasure;
+          modeStats.errorSum += 100 * error;
+          debugPrint(
+            '${mode.name} ${track.name} ${track.bpm}: '
+            'bpm ${result.bpm.toStringAsFixed(2)}, '
+            'confidence ${result.bpmConfidence.toStringAsFixed(3)}, '
+            'beat F ${fMeasure.toStringAsFixed(3)}, '
+            '${elapsed.inMilliseconds} ms',
+          );
+        }
+      }
+    } finally {
+      await dir.delete(recursive: true);
+    }
+
+    for (final mode in TempoMode.values) {
+      debugPrint(stats[mode]!.summary(mode.name));
+      debugPrint(stats[mode]!.confidenceSummary(mode.name));
+    }
+    expect(stats[TempoMode.precise]!.count, greaterThan(0));
+  }, timeout: Timeout.none);
+}
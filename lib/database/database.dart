@@ -16,5 +16,41 @@ class AppDatabase extends _$AppDatabase {
   }
 
   @override
-  int get schemaVersion => 1;
+  int get schemaVersion => 9;
+
+  @override
+  MigrationStrategy get migration => MigrationStrategy(
+    onUpgrade: (m, from, to) async {
+      if (from < 2) {
+        await m.addColumn(tracks, tracks.beatTicks);
+      }
+      if (from < 3) {
+        await m.addColumn(tracks, tracks.lufsCachePath);
+        await m.addColumn(tracks, tracks.integratedLufs);
+      }
+      if (from < 4) {
+        await m.addColumn(tracks, tracks.trackGain);
+        await m.addColumn(tracks, tracks.trackPeak);
+        await m.addColumn(tracks, tracks.albumGain);
+        await m.addColumn(tracks, tracks.albumPeak);
+      }
+      if (from < 5) {
+        await m.addColumn(tracks, tracks.contentStartUs);
+        await m.addColumn(tracks, tracks.contentEndUs);
+      }
+      if (from < 6) {
+        await m.addColumn(tracks, tracks.mixPointsJson);
+        await m.addColumn(tracks, tracks.energy);
+      }
+      if (from < 7) {
+        await m.addColumn(tracks, tracks.fingerprint);
+      }
+      if (from < 8) {
+        await m.addColumn(tracks, tracks.previewStartUs);
+      }
+      if (from < 9) {
+        await m.addColumn(tracks, tracks.analysisVersion);
+      }
+    },
+  );
 }
@@ -14,7 +14,22 @@ class Tracks extends Table {
   RealColumn get bpmConfidence => real().nullable()();
   TextColumn get musicalKey => text().nullable()();
   RealColumn get keyConfidence => real().nullable()();
+  BlobColumn get beatTicks => blob().nullable()(); // Float32 の拍位置（秒）
   TextColumn get stylesJson => text().nullable()();
+  TextColumn get lufsCachePath => text().nullable()();
+  RealColumn get integratedLufs => real().nullable()(); // EBU R128（LUFS）
+  RealColumn get trackGain => real().nullable()(); // dB（基準 -18 LUFS）
+  RealColumn get trackPeak => real().nullable()(); // 線形
+  RealColumn get albumGain => real().nullable()();
+  RealColumn get albumPeak => real().nullable()();
+  IntColumn get contentStartUs => integer().nullable()(); // 先頭の無音の直後
+  IntColumn get contentEndUs => integer().nullable()(); // 末尾の無音の直前
+  TextColumn get mixPointsJson => text().nullable()();
+  RealColumn get energy => real().nullable()(); // 0..1
+  // Uint32 のクロマ。空 = 作れなかった曲（trackGain も null なら計測に失敗）
+  BlobColumn get fingerprint => blob().nullable()();
+  IntColumn get previewStartUs => integer().nullable()(); // サビの先頭
+  IntColumn get analysisVersion => integer().nullable()(); // 解析結果の形式
   DateTimeColumn get scannedAt => dateTime()();
   DateTimeColumn get analyzedAt => dateTime().nullable()();
 
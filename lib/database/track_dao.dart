@@ -8,6 +8,10 @@ part 'track_dao.g.dart';
 class TrackDao extends DatabaseAccessor<AppDatabase> with _$TrackDaoMixin {
   TrackDao(super.db);
 
+  // saveAnalysisResult が書く列の組。解析結果の列を増やしたら上げる
+  // これより古い曲は再生時に解析し直す（null はこの列より前の解析）
+  static const analysisVersion = 1;
+
   Future<Track?> getTrackByPath(String filePath) {
     return (select(
       tracks,
@@ -23,6 +27,18 @@ class TrackDao extends DatabaseAccessor<AppDatabase> with _$TrackDaoMixin {
     )..where((track) => track.filePath.like('$prefix%'))).get();
   }
 
+  Future<List<Track>> getAnalyzedTracks() {
+    return (select(tracks)..where((track) => track.bpm.isNotNull())).get();
+  }
+
+  // 空の blob はフィンガープリントを作れなかった曲なので除く
+  Future<List<Track>> getFingerprintedTracks() async {
+    final rows = await (select(
+      tracks,
+    )..where((track) => track.fingerprint.isNotNull())).get();
+    return rows.where((track) => track.fingerprint!.isNotEmpty).toList();
+  }
+
   Future<void> upsertTrack(TracksCompanion entry) {
     return into(tracks).insertOnConflictUpdate(entry);
   }
@@ -38,6 +54,10 @@ class TrackDao extends DatabaseAccessor<AppDatabase> with _$TrackDaoMixin {
     required double bpmConfidence,
     required String musicalKey,
     required double keyConfidence,
+    required Uint8List beatTicks,
+    required String mixPointsJson,
+    double? energy,
+    Duration? previewStart,
   }) {
     return (update(
       tracks,
@@ -47,6 +67,11 @@ class TrackDao extends DatabaseAccessor<AppDatabase> with _$TrackDaoMixin {
         bpmConfidence: Value(bpmConfidence),
         musicalKey: Value(musicalKey),
         keyConfidence: Value(keyConfidence),
+        beatTicks: Value(beatTicks),
+        mixPointsJson: Value(mixPointsJson),
+        energy: Value(energy),
+        previewStartUs: Value(previewStart?.inMicroseconds),
+        analysisVersion: const Value(analysisVersion),
         analyzedAt: Value(DateTime.now()),
       ),
     );
@@ -59,4 +84,87 @@ class TrackDao extends DatabaseAccessor<AppDatabase> with _$TrackDaoMixin {
     return (update(tracks)..where((track) => track.filePath.equals(filePath)))
         .write(TracksCompanion(stylesJson: Value(stylesJson)));
   }
+
+  Future<void> saveLoudness({
+    required String filePath,
+    required String lufsCachePath,
+    required double integratedLufs,
+    required Duration contentStart,
+    required Duration contentEnd,
+  }) {
+    return (update(
+      tracks,
+    )..where((track) => track.filePath.equals(filePath))).write(
+      TracksCompanion(
+        lufsCachePath: Value(lufsCachePath),
+        integratedLufs: Value(integratedLufs),
+        contentStartUs: Value(contentStart.inMicroseconds),
+        contentEndUs: Value(contentEnd.inMicroseconds),
+      ),
+    );
+  }
+
+  Future<void> saveTrackGain({
+    required String filePath,
+    required double integratedLufs,
+    required double trackGain,
+    required double trackPeak,
+    Uint8List? fingerprint,
+  }) {
+    return (update(
+      tracks,
+    )..where((track) => track.filePath.equals(filePath))).write(
+      TracksCompanion(
+        integratedLufs: Value(integratedLufs),
+        trackGain: Value(trackGain),
+        trackPeak: Value(trackPeak),
+        // 作れなかった曲も空の blob を入れ、次のスキャンで測り直さない
+        fingerprint: Value(fingerprint ?? Uint8List(0)),
+      ),
+    );
+  }
+
+  // ゲインを測れなかった曲。空のフィンガープリントを入れて計測対象から外す
+  Future<void> markGainFailed(String filePath) {
+    return (update(tracks)..where((track) => track.filePath.equals(filePath)))
+        .write(TracksCompanion(fingerprint: Value(Uint8List(0))));
+  }
+
+  // 同じ録音と分かった曲へ from の解析結果を写す。ゲインは各ファイルで測る
+  // from の時刻は写し先に合わせておく（analysisDonors）
+  Future<void> copyAnalysis({
+    required Track from,
+    required List<String> filePaths,
+  }) {
+    return (update(tracks)..where((track) => track.filePath.isIn(filePaths)))
+        .write(
+          TracksCompanion(
+            bpm: Value(from.bpm),
+            bpmConfidence: Value(from.bpmConfidence),
+            musicalKey: Value(from.musicalKey),
+            keyConfidence: Value(from.keyConfidence),
+            beatTicks: Value(from.beatTicks),
+            stylesJson: Value(from.stylesJson),
+            mixPointsJson: Value(from.mixPointsJson),
+            energy: Value(from.energy),
+            previewStartUs: Value(from.previewStartUs),
+            analysisVersion: Value(from.analysisVersion),
+            analyzedAt: Value(from.analyzedAt),
+          ),
+        );
+  }
+
+  Future<void> saveAlbumGain({
+    required List<String> filePaths,
+    required double albumGain,
+    required double albumPeak,
+  }) {
+    return (update(tracks)..where((track) => track.filePath.isIn(filePaths)))
+        .write(
+          TracksCompanion(
+            albumGain: Value(albumGain),
+            albumPeak: Value(albumPeak),
+          ),
+        );
+  }
 }
@@ -0,0 +1,110 @@
+import 'dart:typed_data';
+
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+import 'package:segue/database/database.dart';
+import 'package:segue/providers/database_provider.dart';
+import 'package:segue/src/native/audio_analysis.dart';
+
+class LibraryIndex {
+  final TrackIndex index;
+  final List<Track> tracks; // index の行番号順
+  final Map<String, int> _rows;
+
+  LibraryIndex(this.index, this.tracks)
+    : _rows = {for (var i = 0; i < tracks.length; i++) tracks[i].filePath: i};
+
+  Track? trackFor(String filePath) {
+    final row = _rows[filePath];
+    return row != null ? tracks[row] : null;
+  }
+
+  // filePath の曲の次に合う曲を合う順に返す。未解析の曲なら空
+  List<Track> compatibleWith(
+    String filePath, {
+    double bpmTolerance = 0.06,
+    bool harmonicOnly = true,
+    int maxResults = 20,
+  }) {
+    final row = _rows[filePath];
+    if (row == null) return const [];
+    final track = tracks[row];
+    final matches = index.query(
+      bpm: track.bpm ?? 0,
+      bpmTolerance: bpmTolerance,
+      camelot: TrackIndex.camelotFromKey(track.musicalKey),
+      harmonicOnly: harmonicOnly,
+      energy: track.energy,
+      loudness: track.integratedLufs,
+      excludeRow: row,
+      maxResults: maxResults,
+    );
+    return [for (final match in matches) tracks[match.row]];
+  }
+}
+
+// tracks をつなぎやすい順に並べ替える。ジャンルの推定があれば似た曲を近くに置く
+// first を指定するとその曲から始める。キャンセルされたら null
+Future<List<Track>?> sequenceForMix(
+  List<Track> tracks, {
+  Track? first,
+  bool risingEnergy = false,
+}) async {
+  if (tracks.length < 3) return tracks;
+  final dim = StylePrediction.genres.length;
+  final embeddings = Float32List(tracks.length * dim);
+  for (var i = 0; i < tracks.length; i++) {
+    final json = tracks[i].stylesJson;
+    if (json == null) continue;
+    final vector = StylePrediction.genreEmbedding(
+      StylePrediction.listFromJson(json),
+    );
+    embeddings.setAll(i * dim, vector);
+  }
+
+  final order = await AudioAnalysis.sequenceTracks(
+    bpm: Float32List.fromList([for (final t in tracks) t.bpm ?? 0]),
+    camelot: Int8List.fromList([
+      for (final t in tracks) TrackIndex.camelotFromKey(t.musicalKey),
+    ]),
+    energy: Float32List.fromList([for (final t in tracks) t.energy ?? -1]),
+    embeddings: embeddings,
+    embeddingDim: dim,
+    firstTrack: first != null ? tracks.indexOf(first) : -1,
+    risingEnergy: risingEnergy,
+  );
+  if (order == null) return null;
+  return [for (final i in order) tracks[i]];
+}
+
+// テンポを解析済みの全曲から作る。解析結果を保存したら invalidate する
+final libraryIndexProvider = FutureProvider<LibraryIndex>((ref) async {
+  final tracks = await ref.watch(trackDaoProvider).getAnalyzedTracks();
+
+  final index = AudioAnalysis.createTrackIndex();
+  ref.onDispose(index.dispose);
+  index.load(
+    bpm: Float32List.fromList([for (final t in tracks) t.bpm ?? 0]),
+    camelot: Int8List.fromList([
+      for (final t in tracks) TrackIndex.camelotFromKey(t.musicalKey),
+    ]),
+    energy: Float32List.fromList([for (final t in tracks) t.energy ?? -1]),
+    loudness: Float32List.fromList([
+      for (final t in tracks) t.integratedLufs ?? -100,
+    ]),
+  );
+  return LibraryIndex(index, tracks);
+});
+
+// filePath の曲の次に合う曲を、その曲から続けてつなぎやすい順に並べる
+final upNextProvider = FutureProvider.autoDispose.family<List<Track>, String>((
+  ref,
+  filePath,
+) async {
+  final index = await ref.watch(libraryIndexProvider.future);
+  final current = index.trackFor(filePath);
+  final candidates = index.compatibleWith(filePath, maxResults: 5);
+  if (current == null || candidates.length < 2) return candidates;
+
+  final order = await sequenceForMix([current, ...candidates], first: current);
+  return order != null ? order.skip(1).toList() : candidates;
+});
@@ -1,9 +1,15 @@
+import 'dart:async';
+import 'dart:io';
+
 import 'package:audio_service/audio_service.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
+import 'package:path/path.dart' as p;
 import 'package:segue/providers/audio_handler_provider.dart';
 import 'package:segue/src/native/audio_analysis.dart';
 
-final spectrumProvider = FutureProvider.autoDispose<SpectrumResult?>((
+// 量子化済みのキャッシュがあればそれを使う。なければ再生位置の周辺から
+// 計算を始め、残りはネイティブ側で順次埋まる。揃った時点でキャッシュに書き出す
+final spectrumProvider = FutureProvider.autoDispose<SpectrumFrames?>((
   ref,
 ) async {
   final item = ref.watch(_mediaItemProvider).value;
@@ -12,11 +18,53 @@ final spectrumProvider = FutureProvider.autoDispose<SpectrumResult?>((
   final path = item.id;
   if (path.isEmpty) return null;
 
+  // 波形キャッシュと同じハッシュ名で拡張子だけ変える
+  final wavePath = item.extras?['wavePath'] as String?;
+  final cacheFile = wavePath == null || wavePath.isEmpty
+      ? null
+      : File(p.setExtension(wavePath, '.spec'));
+
+  if (cacheFile != null && await cacheFile.exists()) {
+    try {
+      final cached = QuantizedSpectrum.fromBytes(await cacheFile.readAsBytes());
+      if (cached != null) return cached;
+    } on FileSystemException {
+      // 読めなければ計算し直す
+    }
+  }
+
+  var disposed = false;
+  SpectrumStream? stream;
+  Timer? saveTimer;
   ref.onDispose(() {
-    AudioAnalysis.cancelComputeSpectrum();
+    disposed = true;
+    saveTimer?.cancel();
+    stream?.dispose();
   });
 
-  return await AudioAnalysis.computeSpectrum(pathStr: path);
+  final handler = ref.read(audioHandlerProvider);
+  final position = handler.playbackState.value.position;
+  stream = await AudioAnalysis.startSpectrumStream(
+    pathStr: path,
+    focusSec: position.inMicroseconds / 1000000.0,
+  );
+  if (disposed) {
+    stream?.dispose();
+    return null;
+  }
+
+  final started = stream;
+  if (started != null && cacheFile != null) {
+    saveTimer = Timer.periodic(const Duration(seconds: 1), (timer) {
+      if (!started.isDone) return;
+      timer.cancel();
+      final quantized = started.quantize();
+      if (quantized != null) {
+        cacheFile.writeAsBytes(quantized.toBytes()).ignore();
+      }
+    });
+  }
+  return started;
 });
 
 final _mediaItemProvider = StreamProvider<MediaItem?>((ref) {
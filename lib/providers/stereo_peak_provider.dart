@@ -1,8 +1,14 @@
+import 'dart:io';
+
 import 'package:audio_service/audio_service.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
+import 'package:path/path.dart' as p;
 import 'package:segue/providers/audio_handler_provider.dart';
+import 'package:segue/providers/database_provider.dart';
 import 'package:segue/src/native/audio_analysis.dart';
 
+// ピークとラウドネスは同じパスで求まるため、まとめてキャッシュし
+// 曲全体のラウドネスは DB にも残す
 final stereoPeakProvider = FutureProvider.autoDispose<StereoPeakResult?>((
   ref,
 ) async {
@@ -12,11 +18,43 @@ final stereoPeakProvider = FutureProvider.autoDispose<StereoPeakResult?>((
   final path = item.id;
   if (path.isEmpty) return null;
 
+  // 波形キャッシュと同じハッシュ名で拡張子だけ変える
+  final wavePath = item.extras?['wavePath'] as String?;
+  final cacheFile = wavePath == null || wavePath.isEmpty
+      ? null
+      : File(p.setExtension(wavePath, '.lufs'));
+
+  if (cacheFile != null && await cacheFile.exists()) {
+    try {
+      final cached = StereoPeakResult.fromBytes(await cacheFile.readAsBytes());
+      if (cached != null) return cached;
+    } on FileSystemException {
+      // 読めなければ計算し直す
+    }
+  }
+
   ref.onDispose(() {
     AudioAnalysis.cancelComputeStereoPeaks();
   });
 
-  return await AudioAnalysis.computeStereoPeaks(pathStr: path);
+  final result = await AudioAnalysis.computeStereoPeaks(pathStr: path);
+  if (result != null && cacheFile != null) {
+    try {
+      await cacheFile.writeAsBytes(result.toBytes());
+      await ref
+          .read(trackDaoProvider)
+          .saveLoudness(
+            filePath: path,
+            lufsCachePath: cacheFile.path,
+            integratedLufs: result.integratedLufs,
+            contentStart: result.contentStart,
+            contentEnd: result.contentEnd,
+          );
+    } on FileSystemException {
+      // キャッシュできなくても表示には使える
+    }
+  }
+  return result;
 });
 
 final _mediaItemProvider = StreamProvider<MediaItem?>((ref) {
@@ -10,18 +10,89 @@ import 'discogs_labels.dart';
 import 'essentia_bindings.dart';
 import 'native_library.dart';
 
+// fast はライブラリの一括解析向け。再生中の曲は precise で解析する
+enum TempoMode { precise, fast }
+
+// 並びはネイティブの ESSENTIA_KEY_PROFILE_* と一致させる
+enum KeyProfile { bgate, edma, temperley }
+
+// 次の曲へつなぐ区間の候補。拍のグリッド上の 16 拍単位のフレーズ境界に揃う
+class MixPoint {
+  final bool isMixIn; // true = 曲頭側（入り）、false = 曲末側（抜け）
+  final double startSec;
+  final double endSec;
+  final int phraseBeats; // 16 or 32
+  final double score; // 同じ曲の候補どうしでのみ比較できる
+
+  const MixPoint({
+    required this.isMixIn,
+    required this.startSec,
+    required this.endSec,
+    required this.phraseBeats,
+    required this.score,
+  });
+
+  static String listToJson(List<MixPoint> points) {
+    return jsonEncode([
+      for (final point in points)
+        {
+          'in': point.isMixIn,
+          'start': point.startSec,
+          'end': point.endSec,
+          'beats': point.phraseBeats,
+          'score': point.score,
+        },
+    ]);
+  }
+
+  static List<MixPoint> listFromJson(String json) {
+    final list = (jsonDecode(json) as List).cast<Map<String, dynamic>>();
+    return [
+      for (final entry in list)
+        MixPoint(
+          isMixIn: entry['in'] as bool,
+          startSec: (entry['start'] as num).toDouble(),
+          endSec: (entry['end'] as num).toDouble(),
+          phraseBeats: entry['beats'] as int,
+          score: (entry['score'] as num).toDouble(),
+        ),
+    ];
+  }
+}
+
 class AnalysisResult {
   final double bpm;
   final double bpmConfidence;
   final String key;
   final double keyConfidence;
+  final Float32List beatTicks; // 拍位置（秒）
+  final Map<KeyProfile, String> profileKeys; // 全プロファイルでの推定結果
+  final List<MixPoint> mixPoints; // スコアの高い順。抜粋解析では空
+  final double? energy; // 0..1 の相対的な勢い
+  final Duration? previewStart; // 試聴の開始位置（サビ）。抜粋解析では null
 
   const AnalysisResult({
     required this.bpm,
     required this.bpmConfidence,
     required this.key,
     required this.keyConfidence,
+    required this.beatTicks,
+    this.profileKeys = const {},
+    this.mixPoints = const [],
+    this.energy,
+    this.previewStart,
   });
+
+  Uint8List beatTicksToBlob() => Uint8List.view(
+    beatTicks.buffer,
+    beatTicks.offsetInBytes,
+    beatTicks.lengthInBytes,
+  );
+
+  // SQLite から読んだ Blob は 4 バイト境界に揃っていない場合があるためコピーしてから解釈する
+  static Float32List beatTicksFromBlob(Uint8List blob) {
+    return Uint8List.fromList(blob).buffer.asFloat32List();
+  }
 }
 
 class StylePrediction {
@@ -75,6 +146,27 @@ class StylePrediction {
     ];
   }
 
+  // Discogs ラベルのジャンル部分。genreEmbedding の次元の並び
+  static final List<String> genres = _buildGenres();
+
+  static List<String> _buildGenres() {
+    final seen = <String>{};
+    return [
+      for (final label in discogsLabels)
+        if (seen.add(label.split('---')[0])) label.split('---')[0],
+    ];
+  }
+
+  // ジャンルごとに確信度を足したベクトル。曲順の最適化で似た曲を近づける
+  static Float32List genreEmbedding(List<StylePrediction> predictions) {
+    final vector = Float32List(genres.length);
+    for (final prediction in predictions) {
+      final i = genres.indexOf(prediction.genre);
+      if (i >= 0) vector[i] += prediction.confidence;
+    }
+    return vector;
+  }
+
   static StylePrediction fromLabelIndex(int index, double confidence) {
     final label = discogsLabels[index];
     final parts = label.split('---');
@@ -93,6 +185,23 @@ class StylePrediction {
   }
 }
 
+class StyleTimelineResult {
+  final List<List<StylePrediction>> segments;
+  final double segmentDuration;
+  final List<StylePrediction> summary;
+
+  const StyleTimelineResult({
+    required this.segments,
+    required this.segmentDuration,
+    required this.summary,
+  });
+
+  List<StylePrediction> segmentAt(double seconds) {
+    final index = (seconds / segmentDuration).floor();
+    return segments[index.clamp(0, segments.length - 1)];
+  }
+}
+
 class SpectrumResult {
   final Float32List bands;
   final int numFrames;
@@ -120,19 +229,607 @@ class SpectrumResult {
   }
 }
 
+// ピラミッドの上の段で 2 フレームをまとめる方法
+enum SpectrumReduce { max, mean }
+
+// 時間方向に 2 倍ずつ間引いたスペクトログラムの段。段 0 が元の解像度
+class SpectrumPyramid {
+  final Float32List bands;
+  final Int32List levelOffsets;
+  final Int32List levelFrames;
+  final int numBands;
+  final double hopDuration;
+
+  const SpectrumPyramid({
+    required this.bands,
+    required this.levelOffsets,
+    required this.levelFrames,
+    required this.numBands,
+    required this.hopDuration,
+  });
+
+  int get numLevels => levelFrames.length;
+
+  double levelHopDuration(int level) => hopDuration * (1 << level);
+
+  // 1 ピクセルあたりの秒数に対して、フレームが 1 ピクセル以上になる最も細かい段
+  int levelFor(double secondsPerPixel) {
+    int level = 0;
+    while (level + 1 < numLevels &&
+        levelHopDuration(level) < secondsPerPixel) {
+      level++;
+    }
+    return level;
+  }
+
+  Float32List getFrame(int level, int index) {
+    final start = levelOffsets[level] + index * numBands;
+    return Float32List.sublistView(bands, start, start + numBands);
+  }
+
+  int frameIndexForTime(int level, double seconds) {
+    final index = (seconds / levelHopDuration(level)).floor();
+    return index.clamp(0, levelFrames[level] - 1);
+  }
+}
+
+// 表示側から見たスペクトル。計算中のストリームとキャッシュ済みの量子化データを
+// 同じように扱う
+abstract interface class SpectrumFrames {
+  int get numFrames;
+  int get numBands;
+  double get hopDuration;
+
+  Float32List getFrame(int index);
+
+  bool isFrameReady(int index);
+
+  // 未計算の位置を優先させる。計算済みのデータでは何もしない
+  void setFocus(double seconds);
+}
+
+// 8 bit に量子化したスペクトル（dB = dbOffset + 値 * dbScale、約 0.5 dB 刻み）
+// キャッシュファイルと Isolate 間の受け渡しに同じ形式を使う
+class QuantizedSpectrum implements SpectrumFrames {
+  static const _magic = 0x31515053; // 'SPQ1'
+  static const _headerBytes = 24;
+
+  final Uint8List bands;
+  @override
+  final int numFrames;
+  @override
+  final int numBands;
+  @override
+  final double hopDuration;
+  final double dbOffset;
+  final double dbScale;
+
+  const QuantizedSpectrum({
+    required this.bands,
+    required this.numFrames,
+    required this.numBands,
+    required this.hopDuration,
+    required this.dbOffset,
+    required this.dbScale,
+  });
+
+  @override
+  Float32List getFrame(int index) {
+    final frame = Float32List(numBands);
+    final base = index * numBands;
+    for (int i = 0; i < numBands; i++) {
+      frame[i] = dbOffset + bands[base + i] * dbScale;
+    }
+    return frame;
+  }
+
+  @override
+  bool isFrameReady(int index) => true;
+
+  @override
+  void setFocus(double seconds) {}
+
+  int frameIndexForTime(double seconds) {
+    final index = (seconds / hopDuration).floor();
+    return index.clamp(0, numFrames - 1);
+  }
+
+  Uint8List toBytes() {
+    final bytes = Uint8List(_headerBytes + bands.length);
+    ByteData.sublistView(bytes)
+      ..setUint32(0, _magic, Endian.little)
+      ..setUint32(4, numFrames, Endian.little)
+      ..setUint32(8, numBands, Endian.little)
+      ..setFloat32(12, hopDuration, Endian.little)
+      ..setFloat32(16, dbOffset, Endian.little)
+      ..setFloat32(20, dbScale, Endian.little);
+    bytes.setAll(_headerBytes, bands);
+    return bytes;
+  }
+
+  // 形式が違う・途中で切れているファイルは null
+  static QuantizedSpectrum? fromBytes(Uint8List bytes) {
+    if (bytes.length < _headerBytes) return null;
+    final header = ByteData.sublistView(bytes, 0, _headerBytes);
+    if (header.getUint32(0, Endian.little) != _magic) return null;
+    final numFrames = header.getUint32(4, Endian.little);
+    final numBands = header.getUint32(8, Endian.little);
+    if (bytes.length != _headerBytes + numFrames * numBands) return null;
+    return QuantizedSpectrum(
+      bands: Uint8List.sublistView(bytes, _headerBytes),
+      numFrames: numFrames,
+      numBands: numBands,
+      hopDuration: header.getFloat32(12, Endian.little),
+      dbOffset: header.getFloat32(16, Endian.little),
+      dbScale: header.getFloat32(20, Endian.little),
+    );
+  }
+}
+
+// ネイティブのワーカーが再生位置の周辺から順に埋めていくスペクトル
+// bands はネイティブメモリを直接参照するため、dispose 後は触らないこと
+class SpectrumStream implements SpectrumFrames {
+  final Pointer<SpectrumStreamHandle> _handle;
+  final Pointer<SpectrumStreamInfo> _info;
+  final EssentiaSpectrumStreamSetFocus _setFocus;
+  final EssentiaSpectrumStreamDestroy _destroy;
+  final EssentiaQuantizeSpectrumBands _quantize;
+  final Float32List bands;
+  final Uint8List _chunkReady;
+  @override
+  final int numFrames;
+  @override
+  final int numBands;
+  final int framesPerChunk;
+  @override
+  final double hopDuration;
+  bool _disposed = false;
+
+  SpectrumStream._(
+    this._handle,
+    this._info,
+    this._setFocus,
+    this._destroy,
+    this._quantize,
+  ) : bands = _info.ref.bands.asTypedList(
+        _info.ref.numFrames * _info.ref.numBands,
+      ),
+      _chunkReady = _info.ref.chunkReady.asTypedList(_info.ref.numChunks),
+      numFrames = _info.ref.numFrames,
+      numBands = _info.ref.numBands,
+      framesPerChunk = _info.ref.framesPerChunk,
+      hopDuration = _info.ref.hopDuration;
+
+  bool get isDone => _disposed || _info.ref.done != 0;
+
+  int get errorCode => _disposed ? 1 : _info.ref.errorCode;
+
+  @override
+  bool isFrameReady(int index) =>
+      !_disposed && _chunkReady[index ~/ framesPerChunk] != 0;
+
+  @override
+  Float32List getFrame(int index) {
+    return Float32List.sublistView(
+      bands,
+      index * numBands,
+      (index + 1) * numBands,
+    );
+  }
+
+  int frameIndexForTime(double seconds) {
+    final index = (seconds / hopDuration).floor();
+    return index.clamp(0, numFrames - 1);
+  }
+
+  // シーク後など、未計算の位置を次に計算させる
+  @override
+  void setFocus(double seconds) {
+    if (!_disposed) _setFocus(_handle, seconds);
+  }
+
+  // 全チャンクが揃ってから呼ぶ。未完了・失敗なら null
+  QuantizedSpectrum? quantize() {
+    if (_disposed || !isDone || errorCode != 0) return null;
+
+    final count = numFrames * numBands;
+    final out = calloc<Uint8>(count);
+    final params = calloc<Float>(2);
+    try {
+      _quantize(_info.ref.bands, count, out, params, params + 1);
+      return QuantizedSpectrum(
+        bands: Uint8List.fromList(out.asTypedList(count)),
+        numFrames: numFrames,
+        numBands: numBands,
+        hopDuration: hopDuration,
+        dbOffset: params[0],
+        dbScale: params[1],
+      );
+    } finally {
+      calloc.free(out);
+      calloc.free(params);
+    }
+  }
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    _destroy(_handle);
+  }
+}
+
+// 再生中の PCM から表示フレームごとにバンドとピークを求める解析器
+// push は PCM を供給する側、poll は描画側からそれぞれ 1 箇所だけで呼ぶこと
+class RealtimeAnalyzer {
+  final Pointer<RealtimeAnalyzerHandle> _handle;
+  final EssentiaRealtimePush _push;
+  final EssentiaRealtimePoll _poll;
+  final EssentiaRealtimeReset _reset;
+  final EssentiaRealtimeDestroy _destroy;
+  final Pointer<RealtimeFrame> _frame = calloc<RealtimeFrame>();
+  final int channels;
+  Pointer<Float> _pushBuffer = nullptr;
+  int _pushCapacity = 0;
+  bool _disposed = false;
+
+  RealtimeAnalyzer._(
+    this._handle,
+    this._push,
+    this._poll,
+    this._reset,
+    this._destroy,
+    this.channels,
+  );
+
+  // 受け付けたフレーム数を返す。リングに入りきらない分は framesDropped に現れる
+  int push(Float32List interleaved) {
+    if (_disposed) return 0;
+    if (interleaved.length > _pushCapacity) {
+      calloc.free(_pushBuffer);
+      _pushBuffer = calloc<Float>(interleaved.length);
+      _pushCapacity = interleaved.length;
+    }
+    _pushBuffer.asTypedList(interleaved.length).setAll(0, interleaved);
+    return _push(_handle, _pushBuffer, interleaved.length ~/ channels);
+  }
+
+  // 新しいサンプルがあれば true。bands などは次の poll まで有効
+  bool poll() => !_disposed && _poll(_handle, _frame) != 0;
+
+  Float32List get bands => _frame.ref.bands == nullptr
+      ? Float32List(0)
+      : _frame.ref.bands.asTypedList(_frame.ref.numBands);
+
+  double get leftPeak => _frame.ref.leftPeak;
+
+  double get rightPeak => _frame.ref.rightPeak;
+
+  int get clipFlags => _frame.ref.clipFlags;
+
+  int get framesDropped => _frame.ref.framesDropped;
+
+  // シーク時に溜まっている PCM と解析履歴を捨てる
+  void reset() {
+    if (!_disposed) _reset(_handle);
+  }
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    _destroy(_handle);
+    calloc.free(_frame);
+    calloc.free(_pushBuffer);
+  }
+}
+
+class TrackMatch {
+  final int row;
+  final double distance; // 小さいほど合う
+
+  const TrackMatch(this.row, this.distance);
+}
+
+// 曲ごとのテンポ・調・エネルギー・ラウドネスを列ごとにネイティブ側へ置き、
+// 「この曲の次に合う曲」を 1 ms 未満で引く。行番号は load に渡した順
+class TrackIndex {
+  final Pointer<TrackIndexHandle> _handle;
+  final EssentiaTrackIndexLoad _load;
+  final EssentiaTrackIndexQuery _query;
+  final EssentiaTrackIndexDestroy _destroy;
+  final Pointer<EssentiaTrackQuery> _request = calloc<EssentiaTrackQuery>();
+  Pointer<EssentiaTrackMatch> _matches = nullptr;
+  int _matchCapacity = 0;
+  int _length = 0;
+  bool _disposed = false;
+
+  TrackIndex._(this._handle, this._load, this._query, this._destroy);
+
+  int get length => _length;
+
+  // 不明な値は bpm 0、camelot -1、energy -1、loudness -100 で渡す
+  bool load({
+    required Float32List bpm,
+    required Int8List camelot,
+    required Float32List energy,
+    required Float32List loudness,
+  }) {
+    if (_disposed) return false;
+    final count = bpm.length;
+    final bpmPtr = calloc<Float>(count);
+    final camelotPtr = calloc<Int8>(count);
+    final energyPtr = calloc<Float>(count);
+    final loudnessPtr = calloc<Float>(count);
+    try {
+      bpmPtr.asTypedList(count).setAll(0, bpm);
+      camelotPtr.asTypedList(count).setAll(0, camelot);
+      energyPtr.asTypedList(count).setAll(0, energy);
+      loudnessPtr.asTypedList(count).setAll(0, loudness);
+      final status = _load(
+        _handle,
+        bpmPtr,
+        camelotPtr,
+        energyPtr,
+        loudnessPtr,
+        count,
+      );
+      _length = status == 0 ? count : 0;
+      return status == 0;
+    } finally {
+      calloc.free(bpmPtr);
+      calloc.free(camelotPtr);
+      calloc.free(energyPtr);
+      calloc.free(loudnessPtr);
+    }
+  }
+
+  // 距離の小さい順。harmonicOnly なら同じ・隣接・平行調（Camelot）以外を除く
+  List<TrackMatch> query({
+    double bpm = 0,
+    double bpmTolerance = 0.06,
+    bool halfDouble = true,
+    int camelot = -1,
+    bool harmonicOnly = true,
+    double? energy,
+    double? loudness,
+    int excludeRow = -1,
+    int maxResults = 50,
+  }) {
+    if (_disposed || maxResults <= 0) return const [];
+    if (maxResults > _matchCapacity) {
+      calloc.free(_matches);
+      _matches = calloc<EssentiaTrackMatch>(maxResults);
+      _matchCapacity = maxResults;
+    }
+    _request.ref
+      ..bpm = bpm
+      ..bpmTolerance = bpmTolerance
+      ..halfDouble = halfDouble ? 1 : 0
+      ..camelot = camelot
+      ..harmonicOnly = harmonicOnly ? 1 : 0
+      ..energy = energy ?? -1
+      ..loudness = loudness ?? -100
+      ..excludeRow = excludeRow;
+    final count = _query(_handle, _request, _matches, maxResults);
+    return [
+      for (var i = 0; i < count; i++)
+        TrackMatch(_matches[i].row, _matches[i].distance),
+    ];
+  }
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    _destroy(_handle);
+    calloc.free(_request);
+    calloc.free(_matches);
+  }
+
+  static const _pitchClasses = {
+    'C': 0,
+    'C#': 1,
+    'Db': 1,
+    'D': 2,
+    'Eb': 3,
+    'E': 4,
+    'F': 5,
+    'F#': 6,
+    'Gb': 6,
+    'G': 7,
+    'G#': 8,
+    'Ab': 8,
+    'A': 9,
+    'Bb': 10,
+    'B': 11,
+  };
+
+  // 'Db Major' / 'C# Minor' 形式の調を Camelot コードにする。読めなければ -1
+  // コードは (番号 - 1) * 2 + (B なら 1)
+  static int camelotFromKey(String? key) {
+    if (key == null) return -1;
+    final parts = key.split(' ');
+    if (parts.length != 2) return -1;
+    final pitch = _pitchClasses[parts[0]];
+    if (pitch == null) return -1;
+    final minor = parts[1] == 'Minor';
+    if (!minor && parts[1] != 'Major') return -1;
+    // 長調は C = 8B から 5 度ごとに 1 進む。短調は平行長調と同じ番号
+    final major = minor ? (pitch + 3) % 12 : pitch;
+    final number = (major * 7 + 7) % 12 + 1;
+    return (number - 1) * 2 + (minor ? 0 : 1);
+  }
+}
+
 class StereoPeakResult {
+  static const _magic = 0x3246554c; // 'LUF2'
+  static const _headerBytes = 40;
+
   final Float32List leftPeaks;
   final Float32List rightPeaks;
-  final Uint8List clipFlags; // bit0=left clipped, bit1=right clipped
+  // bit0/bit1=左右のクリップ、bit2/bit3=左右のトゥルーピークが 0 dBTP 超え
+  final Uint8List clipFlags;
+  final Float32List momentary; // LUFS（400 ms）
+  final Float32List shortTerm; // LUFS（3 s）
+  final Float32List truePeaks; // dBTP
   final int numFrames;
   final double hopDuration;
+  final double integratedLufs;
+  final double loudnessRange; // LU
+  final double truePeakMax; // dBTP
+  // 前後の無音を除いた区間。全体が無音なら曲全体
+  final Duration contentStart;
+  final Duration contentEnd;
 
   const StereoPeakResult({
     required this.leftPeaks,
     required this.rightPeaks,
     required this.clipFlags,
+    required this.momentary,
+    required this.shortTerm,
+    required this.truePeaks,
     required this.numFrames,
     required this.hopDuration,
+    required this.integratedLufs,
+    required this.loudnessRange,
+    required this.truePeakMax,
+    required this.contentStart,
+    required this.contentEnd,
+  });
+
+  // キャッシュファイル形式。ヘッダの後に Float32 の配列 5 本とフラグを並べる
+  Uint8List toBytes() {
+    final floatBytes = numFrames * 4;
+    final bytes = Uint8List(_headerBytes + floatBytes * 5 + numFrames);
+    ByteData.sublistView(bytes)
+      ..setUint32(0, _magic, Endian.little)
+      ..setUint32(4, numFrames, Endian.little)
+      ..setFloat32(8, hopDuration, Endian.little)
+      ..setFloat32(12, integratedLufs, Endian.little)
+      ..setFloat32(16, loudnessRange, Endian.little)
+      ..setFloat32(20, truePeakMax, Endian.little)
+      ..setInt64(24, contentStart.inMicroseconds, Endian.little)
+      ..setInt64(32, contentEnd.inMicroseconds, Endian.little);
+    final lists = [leftPeaks, rightPeaks, momentary, shortTerm, truePeaks];
+    var offset = _headerBytes;
+    for (final list in lists) {
+      bytes.setAll(offset, Uint8List.sublistView(list));
+      offset += floatBytes;
+    }
+    bytes.setAll(offset, clipFlags);
+    return bytes;
+  }
+
+  // 形式が違う・途中で切れているファイルは null
+  static StereoPeakResult? fromBytes(Uint8List bytes) {
+    if (bytes.length < _headerBytes) return null;
+    final header = ByteData.sublistView(bytes, 0, _headerBytes);
+    if (header.getUint32(0, Endian.little) != _magic) return null;
+    final numFrames = header.getUint32(4, Endian.little);
+    final floatBytes = numFrames * 4;
+    if (bytes.length != _headerBytes + floatBytes * 5 + numFrames) return null;
+
+    // 4 バイト境界に揃っている保証がないためコピーしてから解釈する
+    Float32List floats(int index) {
+      final start = _headerBytes + floatBytes * index;
+      return Uint8List.fromList(
+        bytes.sublist(start, start + floatBytes),
+      ).buffer.asFloat32List();
+    }
+
+    return StereoPeakResult(
+      leftPeaks: floats(0),
+      rightPeaks: floats(1),
+      momentary: floats(2),
+      shortTerm: floats(3),
+      truePeaks: floats(4),
+      clipFlags: bytes.sublist(_headerBytes + floatBytes * 5),
+      numFrames: numFrames,
+      hopDuration: header.getFloat32(8, Endian.little),
+      integratedLufs: header.getFloat32(12, Endian.little),
+      loudnessRange: header.getFloat32(16, Endian.little),
+      truePeakMax: header.getFloat32(20, Endian.little),
+      contentStart: Duration(microseconds: header.getInt64(24, Endian.little)),
+      contentEnd: Duration(microseconds: header.getInt64(32, Endian.little)),
+    );
+  }
+}
+
+// ReplayGain 2.0 の基準（-18 LUFS）に対するトラックゲイン
+class TrackGain {
+  final double integratedLufs;
+  final double peak; // 線形。抜粋を測った場合は下限
+  final double gainDb;
+  final double uncertaintyLu; // 抜粋による推定誤差。0 = 全体を計測
+  final double analyzedSeconds;
+  final Uint32List? fingerprint; // 曲頭 30 秒のクロマ。重複の検出に使う
+  final int errorCode; // 0 = 計測済み。2 = デコード失敗、3 = 解析失敗
+
+  const TrackGain({
+    required this.integratedLufs,
+    required this.peak,
+    required this.gainDb,
+    required this.uncertaintyLu,
+    required this.analyzedSeconds,
+    this.fingerprint,
+    this.errorCode = 0,
+  });
+
+  // 計測できなかった曲。値はどれも使わない
+  const TrackGain.failed(this.errorCode)
+    : integratedLufs = -100,
+      peak = 0,
+      gainDb = 0,
+      uncertaintyLu = 0,
+      analyzedSeconds = 0,
+      fingerprint = null;
+
+  bool get failed => errorCode != 0;
+
+  Uint8List? fingerprintToBlob() {
+    final fp = fingerprint;
+    if (fp == null) return null;
+    return Uint8List.view(fp.buffer, fp.offsetInBytes, fp.lengthInBytes);
+  }
+
+  // beatTicksFromBlob と同じ理由でコピーしてから解釈する
+  static Uint32List fingerprintFromBlob(Uint8List blob) {
+    return Uint8List.fromList(blob).buffer.asUint32List();
+  }
+}
+
+// 重複の組の 1 曲。この曲の時刻 t は、組の先頭の曲の t + offsetSec に当たる
+class DuplicateMember {
+  final int index; // fingerprints の添字
+  final double offsetSec;
+
+  const DuplicateMember(this.index, this.offsetSec);
+}
+
+// analyzeTrack で求める節。bit はネイティブの ESSENTIA_FEATURE_*
+enum TrackFeature {
+  tempoKey(essentiaFeatureTempoKey),
+  style(essentiaFeatureStyle),
+  spectrum(essentiaFeatureSpectrum),
+  stereoPeaks(essentiaFeatureStereoPeaks);
+
+  final int bit;
+
+  const TrackFeature(this.bit);
+}
+
+// 要求しなかった節と失敗した節は null。失敗した節の errorCode は errors に入る
+class TrackAnalysisResult {
+  final AnalysisResult? analysis;
+  final List<StylePrediction>? styles;
+  final QuantizedSpectrum? spectrum;
+  final StereoPeakResult? stereoPeaks;
+  final Map<TrackFeature, int> errors;
+
+  const TrackAnalysisResult({
+    this.analysis,
+    this.styles,
+    this.spectrum,
+    this.stereoPeaks,
+    this.errors = const {},
   });
 }
 
@@ -142,11 +839,17 @@ class AudioAnalysis {
   static late final EssentiaCancelFlagSet _cancelFlagSet;
   static late final EssentiaCancelFlagDestroy _cancelFlagDestroy;
   static late final EssentiaInit _init;
+  static late final EssentiaAnalyzeTrackAsync _analyzeTrackAsync;
+  static late final EssentiaFreeTrackAnalysis _freeTrackAnalysis;
 
   static Pointer<EssentiaCancelFlag>? _currentCancelFlag;
   static Pointer<EssentiaCancelFlag>? _currentStyleCancelFlag;
+  static Pointer<EssentiaCancelFlag>? _currentStyleTimelineCancelFlag;
   static Pointer<EssentiaCancelFlag>? _currentSpectrumCancelFlag;
   static Pointer<EssentiaCancelFlag>? _currentStereoPeakCancelFlag;
+  static Pointer<EssentiaCancelFlag>? _currentGainCancelFlag;
+  static Pointer<EssentiaCancelFlag>? _currentSequenceCancelFlag;
+  static Pointer<EssentiaCancelFlag>? _currentTrackCancelFlag;
 
   static void ensureInitialized() {
     if (_lib != null) return;
@@ -176,9 +879,63 @@ class AudioAnalysis {
     );
 
     _init();
+
+    // 解析結果はブリッジのスレッドから ReceivePort へ直接届く
+    lib.lookupFunction<
+      EssentiaSetDartPostCObjectNative,
+      EssentiaSetDartPostCObject
+    >('essentia_set_dart_post_cobject')(NativeApi.postCObject);
+
+    _analyzeTrackAsync = lib
+        .lookupFunction<
+          EssentiaAnalyzeTrackAsyncNative,
+          EssentiaAnalyzeTrackAsync
+        >('essentia_analyze_track_async');
+
+    _freeTrackAnalysis = lib
+        .lookupFunction<
+          EssentiaFreeTrackAnalysisNative,
+          EssentiaFreeTrackAnalysis
+        >('essentia_free_track_analysis');
+  }
+
+  // 0 はネイティブ側の既定値（コア数基準）。ORT のスレッド数は最初の推論前のみ反映される
+  static void setThreadBudget({
+    int maxThreads = 0,
+    int ortIntraOpThreads = 0,
+    int ortInterOpThreads = 0,
+  }) {
+    ensureInitialized();
+
+    final setBudget = _lib!
+        .lookupFunction<EssentiaSetThreadBudgetNative, EssentiaSetThreadBudget>(
+          'essentia_set_thread_budget',
+        );
+    setBudget(maxThreads, ortIntraOpThreads, ortInterOpThreads);
+  }
+
+  static void setModelCacheDir(String dir) {
+    ensureInitialized();
+
+    final setDir = _lib!
+        .lookupFunction<
+          EssentiaSetModelCacheDirNative,
+          EssentiaSetModelCacheDir
+        >('essentia_set_model_cache_dir');
+    final dirPtr = dir.toNativeUtf8();
+    try {
+      setDir(dirPtr);
+    } finally {
+      malloc.free(dirPtr);
+    }
   }
 
-  static Future<AnalysisResult?> analyze({required String pathStr}) async {
+  static Future<AnalysisResult?> analyze({
+    required String pathStr,
+    TempoMode tempoMode = TempoMode.precise,
+    KeyProfile keyProfile = KeyProfile.bgate,
+    bool excerpt = false,
+  }) async {
     ensureInitialized();
 
     // 前回の分析にキャンセルを通知（破棄は前回の finally に任せる）
@@ -189,24 +946,44 @@ class AudioAnalysis {
 
     final flag = _cancelFlagCreate();
     _currentCancelFlag = flag;
-    final flagAddress = flag.address;
 
+    var workerDone = false;
     try {
-      final result = await Isolate.run(() {
-        return _runAnalysis(pathStr, flagAddress);
-      });
-      return result;
+      final (result, done) = await _analyzeTrackOnPort(
+        pathStr,
+        {TrackFeature.tempoKey},
+        flag,
+        tempoMode: tempoMode,
+        keyProfile: keyProfile,
+        excerpt: excerpt,
+      );
+      workerDone = done;
+      return result?.analysis;
     } finally {
-      _cancelFlagDestroy(flag);
       if (_currentCancelFlag == flag) {
         _currentCancelFlag = null;
       }
+      if (workerDone) _cancelFlagDestroy(flag);
     }
   }
 
+  // 高速モードでラウンド間の上位スタイルの信頼度変化がこの値以下なら打ち切る
+  static const _fastStyleStabilityThreshold = 0.01;
+
+  // 抜粋モードの区間長の合計と、全曲解析に切り替える信頼度の閾値
+  static const _excerptSeconds = 45.0;
+  static const _excerptMinBpmConfidence = 1.5;
+  // 高速モードの信頼度（拍周期の自己相関、0..1）は尺度が違うので別に持つ
+  // 値は従来の 1.5 / 5.32 相当の暫定値。tempo_modes_eval_test の出力で合わせる
+  static const _excerptMinFastBpmConfidence = 0.28;
+  static const _excerptMinKeyConfidence = 0.5;
+  static const _excerptStyleMinMargin = 0.05;
+
   static Future<List<StylePrediction>?> classifyStyle({
     required String pathStr,
     required String modelPath,
+    bool fast = false,
+    bool excerpt = false,
   }) async {
     ensureInitialized();
 
@@ -217,21 +994,70 @@ class AudioAnalysis {
 
     final flag = _cancelFlagCreate();
     _currentStyleCancelFlag = flag;
+
+    var workerDone = false;
+    try {
+      final (result, done) = await _analyzeTrackOnPort(
+        pathStr,
+        {TrackFeature.style},
+        flag,
+        modelPath: modelPath,
+        excerpt: excerpt,
+        fastStyle: fast,
+      );
+      workerDone = done;
+      return result?.styles;
+    } finally {
+      if (_currentStyleCancelFlag == flag) {
+        _currentStyleCancelFlag = null;
+      }
+      if (workerDone) _cancelFlagDestroy(flag);
+    }
+  }
+
+  static Future<StyleTimelineResult?> classifyStyleTimeline({
+    required String pathStr,
+    required String modelPath,
+    int patchesPerSegment = 4,
+    int topK = 3,
+  }) async {
+    ensureInitialized();
+
+    final oldFlag = _currentStyleTimelineCancelFlag;
+    if (oldFlag != null) {
+      _cancelFlagSet(oldFlag);
+    }
+
+    final flag = _cancelFlagCreate();
+    _currentStyleTimelineCancelFlag = flag;
     final flagAddress = flag.address;
 
     try {
       final result = await Isolate.run(() {
-        return _runStyleClassification(pathStr, modelPath, flagAddress);
+        return _runStyleTimeline(
+          pathStr,
+          modelPath,
+          patchesPerSegment,
+          topK,
+          flagAddress,
+        );
       });
       return result;
     } finally {
       _cancelFlagDestroy(flag);
-      if (_currentStyleCancelFlag == flag) {
-        _currentStyleCancelFlag = null;
+      if (_currentStyleTimelineCancelFlag == flag) {
+        _currentStyleTimelineCancelFlag = null;
       }
     }
   }
 
+  static void cancelStyleTimeline() {
+    final flag = _currentStyleTimelineCancelFlag;
+    if (flag != null) {
+      _cancelFlagSet(flag);
+    }
+  }
+
   static const _errorMessages = {
     0: 'success',
     1: 'cancelled',
@@ -240,83 +1066,178 @@ class AudioAnalysis {
     4: 'model load error',
   };
 
-  static AnalysisResult? _runAnalysis(String pathStr, int flagAddress) {
-    dev.log('analyze: path=$pathStr', name: 'Essentia');
+  static void _fillAnalysisOptions(
+    EssentiaAnalysisOptions options,
+    TempoMode tempoMode,
+    KeyProfile keyProfile,
+    bool excerpt,
+  ) {
+    options.tempoMode = tempoMode == TempoMode.fast
+        ? essentiaTempoFast
+        : essentiaTempoPrecise;
+    options.keyProfile = keyProfile.index;
+    options.excerptMode = excerpt ? 1 : 0;
+    options.excerptSeconds = _excerptSeconds;
+    options.minBpmConfidence = _excerptMinBpmConfidence;
+    options.minKeyConfidence = _excerptMinKeyConfidence;
+    options.minFastBpmConfidence = _excerptMinFastBpmConfidence;
+  }
 
-    final lib = openEssentiaLibrary();
-    final analyze = lib.lookupFunction<EssentiaAnalyzeNative, EssentiaAnalyze>(
-      'essentia_analyze',
+  // ネイティブメモリ解放前に Dart 側へコピーする。失敗していれば null
+  static AnalysisResult? _analysisFromNative(EssentiaAnalysis data) {
+    final result = data.result;
+    dev.log(
+      'result: errorCode=${result.errorCode} (${_errorMessages[result.errorCode] ?? "unknown"}), '
+      'bpm=${result.bpm}, bpmConf=${result.bpmConfidence}, '
+      'keyNote=${result.keyNote}, keyScale=${result.keyScale}, keyConf=${result.keyConfidence}, '
+      'beats=${data.numBeats}, analyzed=${data.analyzedSeconds}s, '
+      'escalated=${data.escalated}, mixPoints=${data.numMixPoints}, '
+      'energy=${data.energy}, '
+      'preview=${data.previewStartSec}s (${data.previewScore})',
+      name: 'Essentia',
     );
 
-    final pathPtr = pathStr.toNativeUtf8();
-    final flag = Pointer<EssentiaCancelFlag>.fromAddress(flagAddress);
+    if (result.errorCode != 0) return null;
 
-    try {
-      final result = analyze(pathPtr, flag);
+    final beatTicks = Float32List(data.numBeats);
+    if (data.numBeats > 0) {
+      beatTicks.setAll(0, data.beatTicks.asTypedList(data.numBeats));
+    }
+    final mixPoints = [
+      for (var i = 0; i < data.numMixPoints; i++)
+        MixPoint(
+          isMixIn: data.mixPoints[i].kind == essentiaMixIn,
+          startSec: data.mixPoints[i].startSec,
+          endSec: data.mixPoints[i].endSec,
+          phraseBeats: data.mixPoints[i].phraseBeats,
+          score: data.mixPoints[i].score,
+        ),
+    ];
 
-      dev.log(
-        'result: errorCode=${result.errorCode} (${_errorMessages[result.errorCode] ?? "unknown"}), '
-        'bpm=${result.bpm}, bpmConf=${result.bpmConfidence}, '
-        'keyNote=${result.keyNote}, keyScale=${result.keyScale}, keyConf=${result.keyConfidence}',
-        name: 'Essentia',
-      );
+    return AnalysisResult(
+      bpm: result.bpm,
+      bpmConfidence: result.bpmConfidence,
+      key: _noteToString(result.keyNote, result.keyScale),
+      keyConfidence: result.keyConfidence,
+      beatTicks: beatTicks,
+      profileKeys: {
+        for (final profile in KeyProfile.values)
+          profile: _noteToString(
+            data.profileKeys[profile.index].keyNote,
+            data.profileKeys[profile.index].keyScale,
+          ),
+      },
+      mixPoints: mixPoints,
+      energy: data.energy < 0 ? null : data.energy,
+      previewStart: data.previewStartSec < 0
+          ? null
+          : Duration(microseconds: (data.previewStartSec * 1e6).round()),
+    );
+  }
 
-      if (result.errorCode != 0) {
-        return null;
-      }
+  static List<StylePrediction>? _stylesFromNative(StyleResult result) {
+    dev.log(
+      'style result: errorCode=${result.errorCode} '
+      '(${_errorMessages[result.errorCode] ?? "unknown"}), '
+      'count=${result.count}, '
+      'patches=${result.patchesEvaluated}/${result.patchesTotal}',
+      name: 'Essentia',
+    );
 
-      return AnalysisResult(
-        bpm: result.bpm,
-        bpmConfidence: result.bpmConfidence,
-        key: _noteToString(result.keyNote, result.keyScale),
-        keyConfidence: result.keyConfidence,
-      );
-    } finally {
-      malloc.free(pathPtr);
+    if (result.errorCode != 0) {
+      return null;
     }
+
+    final predictions = <StylePrediction>[];
+    for (int i = 0; i < result.count; i++) {
+      predictions.add(
+        StylePrediction.fromLabelIndex(
+          result.indices[i],
+          result.confidences[i],
+        ),
+      );
+    }
+    return predictions;
   }
 
-  static List<StylePrediction>? _runStyleClassification(
+  static StyleTimelineResult? _runStyleTimeline(
     String pathStr,
     String modelPath,
+    int patchesPerSegment,
+    int topK,
     int flagAddress,
   ) {
-    dev.log('classifyStyle: path=$pathStr', name: 'Essentia');
+    dev.log('classifyStyleTimeline: path=$pathStr', name: 'Essentia');
 
     final lib = openEssentiaLibrary();
     final classify = lib
-        .lookupFunction<EssentiaClassifyStyleNative, EssentiaClassifyStyle>(
-          'essentia_classify_style',
-        );
+        .lookupFunction<
+          EssentiaClassifyStyleTimelineNative,
+          EssentiaClassifyStyleTimeline
+        >('essentia_classify_style_timeline');
+    final free = lib
+        .lookupFunction<
+          EssentiaFreeStyleTimelineNative,
+          EssentiaFreeStyleTimeline
+        >('essentia_free_style_timeline');
 
     final pathPtr = pathStr.toNativeUtf8();
     final modelPtr = modelPath.toNativeUtf8();
     final flag = Pointer<EssentiaCancelFlag>.fromAddress(flagAddress);
 
     try {
-      final result = classify(pathPtr, modelPtr, flag);
+      final dataPtr = classify(
+        pathPtr,
+        modelPtr,
+        patchesPerSegment,
+        topK,
+        flag,
+      );
 
+      if (dataPtr == nullptr) {
+        dev.log('classifyStyleTimeline: null result', name: 'Essentia');
+        return null;
+      }
+
+      final data = dataPtr.ref;
       dev.log(
-        'style result: errorCode=${result.errorCode} '
-        '(${_errorMessages[result.errorCode] ?? "unknown"}), '
-        'count=${result.count}',
+        'style timeline result: errorCode=${data.errorCode} '
+        '(${_errorMessages[data.errorCode] ?? "unknown"}), '
+        'segments=${data.numSegments}, topK=${data.topK}',
         name: 'Essentia',
       );
 
-      if (result.errorCode != 0) {
+      if (data.errorCode != 0) {
+        free(dataPtr);
         return null;
       }
 
-      final predictions = <StylePrediction>[];
-      for (int i = 0; i < result.count; i++) {
-        predictions.add(
-          StylePrediction.fromLabelIndex(
-            result.indices[i],
-            result.confidences[i],
-          ),
-        );
+      final segments = <List<StylePrediction>>[];
+      for (int s = 0; s < data.numSegments; s++) {
+        segments.add([
+          for (int i = 0; i < data.topK; i++)
+            StylePrediction.fromLabelIndex(
+              data.indices[s * data.topK + i],
+              data.confidences[s * data.topK + i],
+            ),
+        ]);
       }
-      return predictions;
+
+      final summary = data.summary;
+      final result = StyleTimelineResult(
+        segments: segments,
+        segmentDuration: data.segmentDuration,
+        summary: [
+          for (int i = 0; i < summary.count; i++)
+            StylePrediction.fromLabelIndex(
+              summary.indices[i],
+              summary.confidences[i],
+            ),
+        ],
+      );
+
+      free(dataPtr);
+      return result;
     } finally {
       malloc.free(pathPtr);
       malloc.free(modelPtr);
@@ -337,6 +1258,229 @@ class AudioAnalysis {
     }
   }
 
+  // features の節を 1 回の呼び出しでまとめて求める。デコードは形式ごとに
+  // 1 回だけで、analyze や classifyStyle を別々に呼ぶより軽い
+  // excerpt は拍・調とスタイルの両方に効く。style には modelPath が必要
+  // onSection は節が終わるたびに、結果より先に呼ばれる
+  static Future<TrackAnalysisResult?> analyzeTrack({
+    required String pathStr,
+    required Set<TrackFeature> features,
+    String? modelPath,
+    TempoMode tempoMode = TempoMode.precise,
+    KeyProfile keyProfile = KeyProfile.bgate,
+    bool excerpt = false,
+    bool fastStyle = false,
+    int numBands = 32,
+    int frameSize = 4096,
+    int hopSize = 1024,
+    int peakHopSize = 1024,
+    double silenceStartDb = -60,
+    double silenceEndDb = -60,
+    void Function(TrackFeature feature, int errorCode)? onSection,
+  }) async {
+    ensureInitialized();
+
+    final oldFlag = _currentTrackCancelFlag;
+    if (oldFlag != null) {
+      _cancelFlagSet(oldFlag);
+    }
+
+    final flag = _cancelFlagCreate();
+    _currentTrackCancelFlag = flag;
+
+    var workerDone = false;
+    try {
+      final (result, done) = await _analyzeTrackOnPort(
+        pathStr,
+        features,
+        flag,
+        modelPath: modelPath,
+        tempoMode: tempoMode,
+        keyProfile: keyProfile,
+        excerpt: excerpt,
+        fastStyle: fastStyle,
+        numBands: numBands,
+        frameSize: frameSize,
+        hopSize: hopSize,
+        peakHopSize: peakHopSize,
+        silenceStartDb: silenceStartDb,
+        silenceEndDb: silenceEndDb,
+        onSection: onSection,
+      );
+      workerDone = done;
+      return result;
+    } finally {
+      if (_currentTrackCancelFlag == flag) {
+        _currentTrackCancelFlag = null;
+      }
+      if (workerDone) _cancelFlagDestroy(flag);
+    }
+  }
+
+  static void cancelAnalyzeTrack() {
+    final flag = _currentTrackCancelFlag;
+    if (flag != null) {
+      _cancelFlagSet(flag);
+    }
+  }
+
+  // Isolate を立てずに、ネイティブのワーカーから ReceivePort で結果を受け取る
+  // flag は DONE が届くまでネイティブ側が使う。2 つ目の値が true のときだけ
+  // 呼び出し側が破棄してよい。false なら flag にキャンセルを通知済みで、
+  // ワーカーがまだ読むかもしれないので解放せずに残す
+  static Future<(TrackAnalysisResult?, bool)> _analyzeTrackOnPort(
+    String pathStr,
+    Set<TrackFeature> features,
+    Pointer<EssentiaCancelFlag> flag, {
+    String? modelPath,
+    TempoMode tempoMode = TempoMode.precise,
+    KeyProfile keyProfile = KeyProfile.bgate,
+    bool excerpt = false,
+    bool fastStyle = false,
+    int numBands = 32,
+    int frameSize = 4096,
+    int hopSize = 1024,
+    int peakHopSize = 1024,
+    double silenceStartDb = -60,
+    double silenceEndDb = -60,
+    void Function(TrackFeature feature, int errorCode)? onSection,
+  }) async {
+    dev.log(
+      'analyzeTrack: path=$pathStr, '
+      'features=${features.map((f) => f.name).join(',')}, excerpt=$excerpt',
+      name: 'Essentia',
+    );
+
+    final port = ReceivePort();
+    final pathPtr = pathStr.toNativeUtf8();
+    final Pointer<Utf8> modelPtr = modelPath?.toNativeUtf8() ?? nullptr;
+    final configPtr = calloc<EssentiaTrackConfig>();
+    configPtr.ref
+      ..features = features.fold(0, (bits, feature) => bits | feature.bit)
+      ..modelPath = modelPtr
+      ..styleMode = excerpt
+          ? essentiaStyleExcerpt
+          : (fastStyle ? essentiaStyleFast : essentiaStyleFull)
+      ..styleStabilityThreshold = _fastStyleStabilityThreshold
+      ..styleExcerptSeconds = _excerptSeconds
+      ..styleMinMargin = _excerptStyleMinMargin
+      ..spectrumBands = numBands
+      ..spectrumFrameSize = frameSize
+      ..spectrumHopSize = hopSize
+      ..peakHopSize = peakHopSize
+      ..silenceStartDb = silenceStartDb
+      ..silenceEndDb = silenceEndDb;
+    _fillAnalysisOptions(
+      configPtr.ref.analysis,
+      tempoMode,
+      keyProfile,
+      excerpt,
+    );
+
+    // path と config はネイティブ側が複製するので、呼び出し直後に解放してよい
+    final int started;
+    try {
+      started = _analyzeTrackAsync(
+        pathPtr,
+        configPtr,
+        flag,
+        port.sendPort.nativePort,
+      );
+    } finally {
+      malloc.free(pathPtr);
+      if (modelPtr != nullptr) malloc.free(modelPtr);
+      calloc.free(configPtr);
+    }
+
+    if (started != 0) {
+      port.close();
+      dev.log('analyzeTrack: worker not started', name: 'Essentia');
+      return (null, true);
+    }
+
+    var workerDone = false;
+    try {
+      await for (final message in port) {
+        final values = (message as List).cast<int>();
+        if (values[0] == essentiaTrackMessageSection) {
+          // 呼び出し側の例外で受信をやめると DONE を受け取れなくなる
+          try {
+            onSection?.call(
+              TrackFeature.values.firstWhere((f) => f.bit == values[1]),
+              values[2],
+            );
+          } catch (e) {
+            dev.log('analyzeTrack: onSection failed: $e', name: 'Essentia');
+          }
+          continue;
+        }
+
+        workerDone = true;
+        final dataPtr = Pointer<EssentiaTrackAnalysis>.fromAddress(values[1]);
+        if (dataPtr == nullptr) {
+          dev.log('analyzeTrack: null result', name: 'Essentia');
+          return (null, true);
+        }
+        try {
+          return (_trackResultFromNative(dataPtr.ref, features), true);
+        } finally {
+          _freeTrackAnalysis(dataPtr);
+        }
+      }
+      return (null, workerDone);
+    } finally {
+      port.close();
+      if (!workerDone) _cancelFlagSet(flag);
+    }
+  }
+
+  static TrackAnalysisResult _trackResultFromNative(
+    EssentiaTrackAnalysis data,
+    Set<TrackFeature> features,
+  ) {
+    dev.log(
+      'track result: errorCode=${data.errorCode} '
+      '(${_errorMessages[data.errorCode] ?? "unknown"}), '
+      'decodes=${data.decodes}',
+      name: 'Essentia',
+    );
+
+    // 節ごとに errorCode を見て、失敗した節は errors に残す
+    final errors = <TrackFeature, int>{};
+    T? section<T>(TrackFeature feature, int errorCode, T? Function() read) {
+      if (!features.contains(feature)) return null;
+      if (errorCode != 0) {
+        errors[feature] = errorCode;
+        return null;
+      }
+      return read();
+    }
+
+    return TrackAnalysisResult(
+      analysis: section(
+        TrackFeature.tempoKey,
+        data.analysis == nullptr ? 3 : data.analysis.ref.result.errorCode,
+        () => _analysisFromNative(data.analysis.ref),
+      ),
+      styles: section(
+        TrackFeature.style,
+        data.style.errorCode,
+        () => _stylesFromNative(data.style),
+      ),
+      spectrum: section(
+        TrackFeature.spectrum,
+        data.spectrum == nullptr ? 3 : data.spectrum.ref.errorCode,
+        () => _quantizedSpectrumFromNative(data.spectrum.ref),
+      ),
+      stereoPeaks: section(
+        TrackFeature.stereoPeaks,
+        data.stereoPeaks == nullptr ? 3 : data.stereoPeaks.ref.errorCode,
+        () => _stereoPeaksFromNative(data.stereoPeaks.ref),
+      ),
+      errors: errors,
+    );
+  }
+
   static Future<SpectrumResult?> computeSpectrum({
     required String pathStr,
     int numBands = 32,
@@ -373,6 +1517,84 @@ class AudioAnalysis {
     }
   }
 
+  // computeSpectrum と同じ値を 8 bit で受け取る（Isolate 間のコピーは 1/4）
+  static Future<QuantizedSpectrum?> computeSpectrumQuantized({
+    required String pathStr,
+    int numBands = 32,
+    int frameSize = 4096,
+    int hopSize = 1024,
+  }) async {
+    ensureInitialized();
+
+    final oldFlag = _currentSpectrumCancelFlag;
+    if (oldFlag != null) {
+      _cancelFlagSet(oldFlag);
+    }
+
+    final flag = _cancelFlagCreate();
+    _currentSpectrumCancelFlag = flag;
+    final flagAddress = flag.address;
+
+    try {
+      final result = await Isolate.run(() {
+        return _runComputeSpectrumQuantized(
+          pathStr,
+          numBands,
+          frameSize,
+          hopSize,
+          flagAddress,
+        );
+      });
+      return result;
+    } finally {
+      _cancelFlagDestroy(flag);
+      if (_currentSpectrumCancelFlag == flag) {
+        _currentSpectrumCancelFlag = null;
+      }
+    }
+  }
+
+  // ズームアウトした表示向け。段は画面幅から SpectrumPyramid.levelFor で選ぶ
+  static Future<SpectrumPyramid?> computeSpectrumPyramid({
+    required String pathStr,
+    int numBands = 32,
+    int frameSize = 4096,
+    int hopSize = 1024,
+    SpectrumReduce reduce = SpectrumReduce.max,
+  }) async {
+    ensureInitialized();
+
+    final oldFlag = _currentSpectrumCancelFlag;
+    if (oldFlag != null) {
+      _cancelFlagSet(oldFlag);
+    }
+
+    final flag = _cancelFlagCreate();
+    _currentSpectrumCancelFlag = flag;
+    final flagAddress = flag.address;
+
+    try {
+      final result = await Isolate.run(() {
+        return _runComputeSpectrumPyramid(
+          pathStr,
+          numBands,
+          frameSize,
+          hopSize,
+          reduce == SpectrumReduce.mean
+              ? spectrumPyramidMean
+              : spectrumPyramidMax,
+          flagAddress,
+        );
+      });
+      return result;
+    } finally {
+      _cancelFlagDestroy(flag);
+      if (_currentSpectrumCancelFlag == flag) {
+        _currentSpectrumCancelFlag = null;
+      }
+    }
+  }
+
   static void cancelComputeSpectrum() {
     final flag = _currentSpectrumCancelFlag;
     if (flag != null) {
@@ -380,9 +1602,152 @@ class AudioAnalysis {
     }
   }
 
+  // 曲長の取得とワーカーの起動だけを行い、フレームは計算され次第 bands に現れる
+  static Future<SpectrumStream?> startSpectrumStream({
+    required String pathStr,
+    double focusSec = 0,
+    int numBands = 32,
+    int frameSize = 4096,
+    int hopSize = 1024,
+  }) async {
+    ensureInitialized();
+
+    final address = await Isolate.run(() {
+      final lib = openEssentiaLibrary();
+      final start = lib
+          .lookupFunction<
+            EssentiaSpectrumStreamStartNative,
+            EssentiaSpectrumStreamStart
+          >('essentia_spectrum_stream_start');
+      final pathPtr = pathStr.toNativeUtf8();
+      try {
+        return start(pathPtr, numBands, frameSize, hopSize, focusSec).address;
+      } finally {
+        malloc.free(pathPtr);
+      }
+    });
+
+    if (address == 0) {
+      dev.log('spectrumStream: failed to start', name: 'Essentia');
+      return null;
+    }
+
+    final lib = _lib!;
+    final handle = Pointer<SpectrumStreamHandle>.fromAddress(address);
+    final info = lib
+        .lookupFunction<
+          EssentiaSpectrumStreamInfoNative,
+          EssentiaSpectrumStreamInfo
+        >('essentia_spectrum_stream_info');
+    final setFocus = lib
+        .lookupFunction<
+          EssentiaSpectrumStreamSetFocusNative,
+          EssentiaSpectrumStreamSetFocus
+        >('essentia_spectrum_stream_set_focus');
+    final destroy = lib
+        .lookupFunction<
+          EssentiaSpectrumStreamDestroyNative,
+          EssentiaSpectrumStreamDestroy
+        >('essentia_spectrum_stream_destroy');
+
+    final quantize = lib
+        .lookupFunction<
+          EssentiaQuantizeSpectrumBandsNative,
+          EssentiaQuantizeSpectrumBands
+        >('essentia_quantize_spectrum_bands');
+
+    final stream = SpectrumStream._(
+      handle,
+      info(handle),
+      setFocus,
+      destroy,
+      quantize,
+    );
+    dev.log(
+      'spectrumStream: path=$pathStr, frames=${stream.numFrames}, '
+      'focus=$focusSec',
+      name: 'Essentia',
+    );
+    return stream;
+  }
+
+  // ファイルを読まないため同期で生成できる。引数が不正なら null
+  static RealtimeAnalyzer? createRealtimeAnalyzer({
+    required int sampleRate,
+    int channels = 2,
+    int numBands = 32,
+    int frameSize = 4096,
+    int capacityFrames = 0,
+  }) {
+    ensureInitialized();
+
+    final lib = _lib!;
+    final create = lib
+        .lookupFunction<EssentiaRealtimeCreateNative, EssentiaRealtimeCreate>(
+          'essentia_realtime_create',
+        );
+    final handle = create(
+      sampleRate,
+      channels,
+      numBands,
+      frameSize,
+      capacityFrames,
+    );
+    if (handle == nullptr) {
+      dev.log('realtimeAnalyzer: invalid arguments', name: 'Essentia');
+      return null;
+    }
+
+    return RealtimeAnalyzer._(
+      handle,
+      lib.lookupFunction<EssentiaRealtimePushNative, EssentiaRealtimePush>(
+        'essentia_realtime_push',
+      ),
+      lib.lookupFunction<EssentiaRealtimePollNative, EssentiaRealtimePoll>(
+        'essentia_realtime_poll',
+      ),
+      lib.lookupFunction<EssentiaRealtimeResetNative, EssentiaRealtimeReset>(
+        'essentia_realtime_reset',
+      ),
+      lib.lookupFunction<
+        EssentiaRealtimeDestroyNative,
+        EssentiaRealtimeDestroy
+      >('essentia_realtime_destroy'),
+      channels,
+    );
+  }
+
+  static TrackIndex createTrackIndex() {
+    ensureInitialized();
+
+    final lib = _lib!;
+    final create = lib
+        .lookupFunction<
+          EssentiaTrackIndexCreateNative,
+          EssentiaTrackIndexCreate
+        >('essentia_track_index_create');
+    return TrackIndex._(
+      create(),
+      lib.lookupFunction<EssentiaTrackIndexLoadNative, EssentiaTrackIndexLoad>(
+        'essentia_track_index_load',
+      ),
+      lib.lookupFunction<
+        EssentiaTrackIndexQueryNative,
+        EssentiaTrackIndexQuery
+      >('essentia_track_index_query'),
+      lib.lookupFunction<
+        EssentiaTrackIndexDestroyNative,
+        EssentiaTrackIndexDestroy
+      >('essentia_track_index_destroy'),
+    );
+  }
+
+  // silenceStartDb / silenceEndDb: 前後の無音とみなすピークの上限（dBFS）
   static Future<StereoPeakResult?> computeStereoPeaks({
     required String pathStr,
     int hopSize = 1024,
+    double silenceStartDb = -60,
+    double silenceEndDb = -60,
   }) async {
     ensureInitialized();
 
@@ -393,18 +1758,24 @@ class AudioAnalysis {
 
     final flag = _cancelFlagCreate();
     _currentStereoPeakCancelFlag = flag;
-    final flagAddress = flag.address;
 
+    var workerDone = false;
     try {
-      final result = await Isolate.run(() {
-        return _runComputeStereoPeaks(pathStr, hopSize, flagAddress);
-      });
-      return result;
+      final (result, done) = await _analyzeTrackOnPort(
+        pathStr,
+        {TrackFeature.stereoPeaks},
+        flag,
+        peakHopSize: hopSize,
+        silenceStartDb: silenceStartDb,
+        silenceEndDb: silenceEndDb,
+      );
+      workerDone = done;
+      return result?.stereoPeaks;
     } finally {
-      _cancelFlagDestroy(flag);
       if (_currentStereoPeakCancelFlag == flag) {
         _currentStereoPeakCancelFlag = null;
       }
+      if (workerDone) _cancelFlagDestroy(flag);
     }
   }
 
@@ -415,6 +1786,386 @@ class AudioAnalysis {
     }
   }
 
+  // ライブラリスキャン向け。ネイティブ側でスレッド予算の範囲で並列に測る
+  // キャンセルで測らなかった曲は null、計測に失敗した曲は failed
+  static Future<List<TrackGain?>> analyzeGainBatch(
+    List<String> paths, {
+    bool fast = true,
+  }) async {
+    ensureInitialized();
+    if (paths.isEmpty) return const [];
+
+    final oldFlag = _currentGainCancelFlag;
+    if (oldFlag != null) {
+      _cancelFlagSet(oldFlag);
+    }
+
+    final flag = _cancelFlagCreate();
+    _currentGainCancelFlag = flag;
+    final flagAddress = flag.address;
+
+    try {
+      return await Isolate.run(() {
+        return _runAnalyzeGainBatch(paths, fast, flagAddress);
+      });
+    } finally {
+      _cancelFlagDestroy(flag);
+      if (_currentGainCancelFlag == flag) {
+        _currentGainCancelFlag = null;
+      }
+    }
+  }
+
+  static void cancelAnalyzeGain() {
+    final flag = _currentGainCancelFlag;
+    if (flag != null) {
+      _cancelFlagSet(flag);
+    }
+  }
+
+  // 同じ録音とみなせる曲の組を返す。各組は添字の昇順で 2 曲以上。
+  // 一致は推移的にまとめる。null の曲は対象外
+  static Future<List<List<DuplicateMember>>> findDuplicateGroups(
+    List<Uint32List?> fingerprints, {
+    double minSimilarity = 0.8,
+  }) async {
+    ensureInitialized();
+    if (fingerprints.length < 2) return const [];
+    return Isolate.run(() {
+      return _runFindDuplicateGroups(fingerprints, minSimilarity);
+    });
+  }
+
+  static List<List<DuplicateMember>> _runFindDuplicateGroups(
+    List<Uint32List?> fingerprints,
+    double minSimilarity,
+  ) {
+    final lib = openEssentiaLibrary();
+    final create = lib
+        .lookupFunction<
+          EssentiaFingerprintIndexCreateNative,
+          EssentiaFingerprintIndexCreate
+        >('essentia_fingerprint_index_create');
+    final add = lib
+        .lookupFunction<
+          EssentiaFingerprintIndexAddNative,
+          EssentiaFingerprintIndexAdd
+        >('essentia_fingerprint_index_add');
+    final query = lib
+        .lookupFunction<
+          EssentiaFingerprintIndexQueryNative,
+          EssentiaFingerprintIndexQuery
+        >('essentia_fingerprint_index_query');
+    final destroy = lib
+        .lookupFunction<
+          EssentiaFingerprintIndexDestroyNative,
+          EssentiaFingerprintIndexDestroy
+        >('essentia_fingerprint_index_destroy');
+
+    final index = create();
+    if (index == nullptr) return const [];
+
+    const maxMatches = 16;
+    final maxLength = fingerprints.fold<int>(
+      1,
+      (m, fp) => fp != null && fp.length > m ? fp.length : m,
+    );
+    final buffer = calloc<Uint32>(maxLength);
+    final matches = calloc<EssentiaFingerprintMatch>(maxMatches);
+    final parent = List<int>.generate(fingerprints.length, (i) => i);
+    // i の時刻 t は parent[i] の t + shift[i] に当たる
+    final shift = List<double>.filled(fingerprints.length, 0);
+    int root(int i) {
+      var r = i;
+      var total = 0.0;
+      while (parent[r] != r) {
+        total += shift[r];
+        r = parent[r];
+      }
+      // 経路上の曲を根へ直接つなぎ、ずれも根からの値に直す
+      while (parent[i] != r) {
+        final next = parent[i];
+        final own = shift[i];
+        parent[i] = r;
+        shift[i] = total;
+        total -= own;
+        i = next;
+      }
+      return r;
+    }
+
+    try {
+      final stopwatch = Stopwatch()..start();
+      for (var i = 0; i < fingerprints.length; i++) {
+        final fp = fingerprints[i];
+        if (fp == null || fp.isEmpty) continue;
+        buffer.asTypedList(fp.length).setAll(0, fp);
+        add(index, i, buffer, fp.length);
+      }
+
+      var pairs = 0;
+      for (var i = 0; i < fingerprints.length; i++) {
+        final fp = fingerprints[i];
+        if (fp == null || fp.isEmpty) continue;
+        buffer.asTypedList(fp.length).setAll(0, fp);
+        final count = query(
+          index,
+          buffer,
+          fp.length,
+          minSimilarity,
+          matches,
+          maxMatches,
+        );
+        for (var k = 0; k < count; k++) {
+          final j = matches[k].id;
+          final a = root(i);
+          final b = root(j);
+          if (a == b) continue;
+          // i の t は j の t + offsetSec。根どうしのずれに直してつなぐ
+          final d = matches[k].offsetSec + shift[j] - shift[i];
+          if (a > b) {
+            parent[a] = b;
+            shift[a] = d;
+          } else {
+            parent[b] = a;
+            shift[b] = -d;
+          }
+          pairs++;
+        }
+      }
+
+      final byRoot = <int, List<int>>{};
+      for (var i = 0; i < fingerprints.length; i++) {
+        if (fingerprints[i] == null) continue;
+        byRoot.putIfAbsent(root(i), () => []).add(i);
+      }
+      // 根は組で最も小さい添字なので、根からのずれがそのまま先頭の曲からのずれ
+      final groups = [
+        for (final group in byRoot.values)
+          if (group.length > 1)
+            [for (final i in group) DuplicateMember(i, shift[i])],
+      ];
+      dev.log(
+        'duplicates: tracks=${fingerprints.length}, links=$pairs, '
+        'groups=${groups.length}, ${stopwatch.elapsedMilliseconds} ms',
+        name: 'Essentia',
+      );
+      return groups;
+    } finally {
+      destroy(index);
+      calloc.free(buffer);
+      calloc.free(matches);
+    }
+  }
+
+  static List<TrackGain?> _runAnalyzeGainBatch(
+    List<String> paths,
+    bool fast,
+    int flagAddress,
+  ) {
+    final lib = openEssentiaLibrary();
+    final analyze = lib
+        .lookupFunction<
+          EssentiaAnalyzeGainBatchNative,
+          EssentiaAnalyzeGainBatch
+        >('essentia_analyze_gain_batch');
+    final freeFingerprints = lib
+        .lookupFunction<
+          EssentiaFreeGainFingerprintsNative,
+          EssentiaFreeGainFingerprints
+        >('essentia_free_gain_fingerprints');
+
+    final count = paths.length;
+    final pathPtrs = calloc<Pointer<Utf8>>(count);
+    final results = calloc<EssentiaGainResult>(count);
+    final flag = Pointer<EssentiaCancelFlag>.fromAddress(flagAddress);
+
+    try {
+      for (var i = 0; i < count; i++) {
+        pathPtrs[i] = paths[i].toNativeUtf8();
+      }
+      analyze(pathPtrs, count, fast ? 1 : 0, results, flag);
+
+      final gains = <TrackGain?>[];
+      var failed = 0;
+      var maxUncertainty = 0.0;
+      for (var i = 0; i < count; i++) {
+        final r = results[i];
+        if (r.errorCode == 1) {
+          gains.add(null);
+          continue;
+        }
+        if (r.errorCode != 0) {
+          failed++;
+          gains.add(TrackGain.failed(r.errorCode));
+          continue;
+        }
+        if (r.uncertaintyLu > maxUncertainty) maxUncertainty = r.uncertaintyLu;
+        gains.add(
+          TrackGain(
+            integratedLufs: r.integratedLufs,
+            peak: r.peak,
+            gainDb: r.gainDb,
+            uncertaintyLu: r.uncertaintyLu,
+            analyzedSeconds: r.analyzedSeconds,
+            fingerprint: r.fingerprint == nullptr
+                ? null
+                : Uint32List.fromList(
+                    r.fingerprint.asTypedList(r.fingerprintLength),
+                  ),
+          ),
+        );
+      }
+      dev.log(
+        'gain batch: tracks=$count, failed=$failed, fast=$fast, '
+        'maxUncertainty=${maxUncertainty.toStringAsFixed(2)} LU',
+        name: 'Essentia',
+      );
+      return gains;
+    } finally {
+      for (var i = 0; i < count; i++) {
+        if (pathPtrs[i] != nullptr) malloc.free(pathPtrs[i]);
+      }
+      freeFingerprints(results, count);
+      calloc.free(pathPtrs);
+      calloc.free(results);
+    }
+  }
+
+  // 隣り合う曲のつなぎにくさ（テンポ・調・埋め込み・エネルギー）の合計が
+  // 小さくなる順に並べ、元の添字の並びを返す。不明な値は TrackIndex.load と
+  // 同じ。embeddings は曲数 × embeddingDim。キャンセルや失敗なら null
+  static Future<List<int>?> sequenceTracks({
+    required Float32List bpm,
+    required Int8List camelot,
+    required Float32List energy,
+    Float32List? embeddings,
+    int embeddingDim = 0,
+    int firstTrack = -1,
+    bool risingEnergy = false,
+    int restarts = 8,
+    int timeLimitMs = 0,
+  }) async {
+    ensureInitialized();
+    if (bpm.isEmpty) return const [];
+
+    final oldFlag = _currentSequenceCancelFlag;
+    if (oldFlag != null) {
+      _cancelFlagSet(oldFlag);
+    }
+
+    final flag = _cancelFlagCreate();
+    _currentSequenceCancelFlag = flag;
+    final flagAddress = flag.address;
+
+    try {
+      return await Isolate.run(() {
+        return _runSequenceTracks(
+          bpm,
+          camelot,
+          energy,
+          embeddings,
+          embeddingDim,
+          firstTrack,
+          risingEnergy,
+          restarts,
+          timeLimitMs,
+          flagAddress,
+        );
+      });
+    } finally {
+      _cancelFlagDestroy(flag);
+      if (_currentSequenceCancelFlag == flag) {
+        _currentSequenceCancelFlag = null;
+      }
+    }
+  }
+
+  static void cancelSequenceTracks() {
+    final flag = _currentSequenceCancelFlag;
+    if (flag != null) {
+      _cancelFlagSet(flag);
+    }
+  }
+
+  static List<int>? _runSequenceTracks(
+    Float32List bpm,
+    Int8List camelot,
+    Float32List energy,
+    Float32List? embeddings,
+    int embeddingDim,
+    int firstTrack,
+    bool risingEnergy,
+    int restarts,
+    int timeLimitMs,
+    int flagAddress,
+  ) {
+    final lib = openEssentiaLibrary();
+    final sequence = lib
+        .lookupFunction<EssentiaSequenceTracksNative, EssentiaSequenceTracks>(
+          'essentia_sequence_tracks',
+        );
+
+    final count = bpm.length;
+    final dim = embeddings != null ? embeddingDim : 0;
+    final bpmPtr = calloc<Float>(count);
+    final camelotPtr = calloc<Int8>(count);
+    final energyPtr = calloc<Float>(count);
+    final embeddingPtr = dim > 0 ? calloc<Float>(count * dim) : nullptr;
+    final options = calloc<EssentiaSequenceOptions>();
+    final order = calloc<Int32>(count);
+    final cost = calloc<Float>();
+    final flag = Pointer<EssentiaCancelFlag>.fromAddress(flagAddress);
+
+    try {
+      bpmPtr.asTypedList(count).setAll(0, bpm);
+      camelotPtr.asTypedList(count).setAll(0, camelot);
+      energyPtr.asTypedList(count).setAll(0, energy);
+      if (dim > 0) embeddingPtr.asTypedList(count * dim).setAll(0, embeddings!);
+      options.ref
+        ..tempoWeight = 1.0
+        ..keyWeight = 1.0
+        ..embeddingWeight = 0.5
+        ..energyWeight = 1.0
+        ..energyShape = risingEnergy
+            ? essentiaEnergyRising
+            : essentiaEnergySmooth
+        ..firstTrack = firstTrack
+        ..restarts = restarts
+        ..timeLimitMs = timeLimitMs;
+
+      final stopwatch = Stopwatch()..start();
+      final status = sequence(
+        bpmPtr,
+        camelotPtr,
+        energyPtr,
+        embeddingPtr,
+        dim,
+        count,
+        options,
+        order,
+        cost,
+        flag,
+      );
+      dev.log(
+        'sequenceTracks: tracks=$count, status=$status, '
+        'cost=${cost.value.toStringAsFixed(2)}, '
+        '${stopwatch.elapsedMilliseconds} ms',
+        name: 'Essentia',
+      );
+      if (status != 0) return null;
+      return List<int>.of(order.asTypedList(count));
+    } finally {
+      calloc.free(bpmPtr);
+      calloc.free(camelotPtr);
+      calloc.free(energyPtr);
+      if (embeddingPtr != nullptr) calloc.free(embeddingPtr);
+      calloc.free(options);
+      calloc.free(order);
+      calloc.free(cost);
+    }
+  }
+
   static SpectrumResult? _runComputeSpectrum(
     String pathStr,
     int numBands,
@@ -478,40 +2229,51 @@ class AudioAnalysis {
     }
   }
 
-  static StereoPeakResult? _runComputeStereoPeaks(
+  static SpectrumPyramid? _runComputeSpectrumPyramid(
     String pathStr,
+    int numBands,
+    int frameSize,
     int hopSize,
+    int reduce,
     int flagAddress,
   ) {
-    dev.log('computeStereoPeaks: path=$pathStr', name: 'Essentia');
+    dev.log('computeSpectrumPyramid: path=$pathStr', name: 'Essentia');
 
     final lib = openEssentiaLibrary();
     final compute = lib
         .lookupFunction<
-          EssentiaComputeStereoPeaksNative,
-          EssentiaComputeStereoPeaks
-        >('essentia_compute_stereo_peaks');
+          EssentiaComputeSpectrumPyramidNative,
+          EssentiaComputeSpectrumPyramid
+        >('essentia_compute_spectrum_pyramid');
     final free = lib
-        .lookupFunction<EssentiaFreeStereoPeaksNative, EssentiaFreeStereoPeaks>(
-          'essentia_free_stereo_peaks',
-        );
+        .lookupFunction<
+          EssentiaFreeSpectrumPyramidNative,
+          EssentiaFreeSpectrumPyramid
+        >('essentia_free_spectrum_pyramid');
 
     final pathPtr = pathStr.toNativeUtf8();
     final flag = Pointer<EssentiaCancelFlag>.fromAddress(flagAddress);
 
     try {
-      final dataPtr = compute(pathPtr, hopSize, flag);
+      final dataPtr = compute(
+        pathPtr,
+        numBands,
+        frameSize,
+        hopSize,
+        reduce,
+        flag,
+      );
 
       if (dataPtr == nullptr) {
-        dev.log('computeStereoPeaks: null result', name: 'Essentia');
+        dev.log('computeSpectrumPyramid: null result', name: 'Essentia');
         return null;
       }
 
       final data = dataPtr.ref;
       dev.log(
-        'stereo peaks result: errorCode=${data.errorCode} '
+        'spectrum pyramid result: errorCode=${data.errorCode} '
         '(${_errorMessages[data.errorCode] ?? "unknown"}), '
-        'frames=${data.numFrames}',
+        'levels=${data.numLevels}, bands=${data.numBands}',
         name: 'Essentia',
       );
 
@@ -520,19 +2282,21 @@ class AudioAnalysis {
         return null;
       }
 
-      final numFrames = data.numFrames;
-      final leftPeaks = Float32List(numFrames);
-      final rightPeaks = Float32List(numFrames);
-      final clipFlags = Uint8List(numFrames);
-      leftPeaks.setAll(0, data.leftPeaks.asTypedList(numFrames));
-      rightPeaks.setAll(0, data.rightPeaks.asTypedList(numFrames));
-      clipFlags.setAll(0, data.clipFlags.asTypedList(numFrames));
-
-      final result = StereoPeakResult(
-        leftPeaks: leftPeaks,
-        rightPeaks: rightPeaks,
-        clipFlags: clipFlags,
-        numFrames: numFrames,
+      // ネイティブメモリ解放前に Dart 側へコピー
+      final levels = data.numLevels;
+      final levelOffsets = Int32List.fromList(
+        data.levelOffset.asTypedList(levels),
+      );
+      final levelFrames = Int32List.fromList(
+        data.levelFrames.asTypedList(levels),
+      );
+      final total =
+          levelOffsets[levels - 1] + levelFrames[levels - 1] * data.numBands;
+      final result = SpectrumPyramid(
+        bands: Float32List.fromList(data.bands.asTypedList(total)),
+        levelOffsets: levelOffsets,
+        levelFrames: levelFrames,
+        numBands: data.numBands,
         hopDuration: data.hopDuration,
       );
 
@@ -543,6 +2307,106 @@ class AudioAnalysis {
     }
   }
 
+  static QuantizedSpectrum? _runComputeSpectrumQuantized(
+    String pathStr,
+    int numBands,
+    int frameSize,
+    int hopSize,
+    int flagAddress,
+  ) {
+    dev.log('computeSpectrumQuantized: path=$pathStr', name: 'Essentia');
+
+    final lib = openEssentiaLibrary();
+    final compute = lib
+        .lookupFunction<
+          EssentiaComputeSpectrumU8Native,
+          EssentiaComputeSpectrumU8
+        >('essentia_compute_spectrum_u8');
+    final free = lib
+        .lookupFunction<EssentiaFreeSpectrumU8Native, EssentiaFreeSpectrumU8>(
+          'essentia_free_spectrum_u8',
+        );
+
+    final pathPtr = pathStr.toNativeUtf8();
+    final flag = Pointer<EssentiaCancelFlag>.fromAddress(flagAddress);
+
+    try {
+      final dataPtr = compute(pathPtr, numBands, frameSize, hopSize, flag);
+
+      if (dataPtr == nullptr) {
+        dev.log('computeSpectrumQuantized: null result', name: 'Essentia');
+        return null;
+      }
+
+      final result = _quantizedSpectrumFromNative(dataPtr.ref);
+      free(dataPtr);
+      return result;
+    } finally {
+      malloc.free(pathPtr);
+    }
+  }
+
+  // ネイティブメモリ解放前に Dart 側へコピーする。失敗していれば null
+  static QuantizedSpectrum? _quantizedSpectrumFromNative(SpectrumDataU8 data) {
+    dev.log(
+      'spectrum result: errorCode=${data.errorCode} '
+      '(${_errorMessages[data.errorCode] ?? "unknown"}), '
+      'frames=${data.numFrames}, bands=${data.numBands}, '
+      'dB=${data.dbOffset}+n*${data.dbScale}',
+      name: 'Essentia',
+    );
+
+    if (data.errorCode != 0) return null;
+
+    final total = data.numFrames * data.numBands;
+    return QuantizedSpectrum(
+      bands: Uint8List.fromList(data.bands.asTypedList(total)),
+      numFrames: data.numFrames,
+      numBands: data.numBands,
+      hopDuration: data.hopDuration,
+      dbOffset: data.dbOffset,
+      dbScale: data.dbScale,
+    );
+  }
+
+  // ネイティブメモリ解放前に Dart 側へコピーする。失敗していれば null
+  static StereoPeakResult? _stereoPeaksFromNative(StereoPeakData data) {
+    dev.log(
+      'stereo peaks result: errorCode=${data.errorCode} '
+      '(${_errorMessages[data.errorCode] ?? "unknown"}), '
+      'frames=${data.numFrames}, integrated=${data.integratedLufs} LUFS, '
+      'lra=${data.loudnessRange} LU, truePeak=${data.truePeakMax} dBTP, '
+      'content=${data.contentStartUs}-${data.contentEndUs} us',
+      name: 'Essentia',
+    );
+
+    if (data.errorCode != 0) return null;
+
+    final numFrames = data.numFrames;
+    final leftPeaks = Float32List(numFrames);
+    final rightPeaks = Float32List(numFrames);
+    final clipFlags = Uint8List(numFrames);
+    leftPeaks.setAll(0, data.leftPeaks.asTypedList(numFrames));
+    rightPeaks.setAll(0, data.rightPeaks.asTypedList(numFrames));
+    clipFlags.setAll(0, data.clipFlags.asTypedList(numFrames));
+
+    return StereoPeakResult(
+      leftPeaks: leftPeaks,
+      rightPeaks: rightPeaks,
+      clipFlags: clipFlags,
+      momentary: Float32List.fromList(data.momentary.asTypedList(numFrames)),
+      shortTerm: Float32List.fromList(data.shortTerm.asTypedList(numFrames)),
+      truePeaks: Float32List.fromList(data.truePeaks.asTypedList(numFrames)),
+      numFrames: numFrames,
+      hopDuration: data.hopDuration,
+      integratedLufs: data.integratedLufs,
+      loudnessRange: data.loudnessRange,
+      truePeakMax: data.truePeakMax,
+      contentStart: Duration(microseconds: data.contentStartUs),
+      contentEnd: Duration(microseconds: data.contentEndUs),
+    );
+  }
+
   static const _majorNames = [
     'C',
     'Db',
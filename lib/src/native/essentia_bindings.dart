@@ -21,6 +21,106 @@ final class EssentiaResult extends Struct {
   external int errorCode; // 0=success, 1=cancelled, 2=decode error, 3=analysis error
 }
 
+const int essentiaKeyProfileCount = 3;
+
+final class EssentiaKeyEstimate extends Struct {
+  @Int8()
+  external int keyNote; // 0-11 (C=0...B=11), -1 = unknown
+
+  @Int8()
+  external int keyScale; // 0=major, 1=minor
+
+  @Float()
+  external double strength;
+}
+
+const int essentiaMixIn = 0;
+const int essentiaMixOut = 1;
+
+final class EssentiaMixPoint extends Struct {
+  @Float()
+  external double startSec;
+
+  @Float()
+  external double endSec;
+
+  @Int32()
+  external int kind; // essentiaMixIn / essentiaMixOut
+
+  @Int32()
+  external int phraseBeats;
+
+  @Float()
+  external double score;
+}
+
+final class EssentiaAnalysis extends Struct {
+  external EssentiaResult result;
+
+  external Pointer<Float> beatTicks;
+
+  @Int32()
+  external int numBeats;
+
+  external Pointer<Float> bpmEstimates;
+
+  @Int32()
+  external int numBpmEstimates;
+
+  @Array(essentiaKeyProfileCount)
+  external Array<EssentiaKeyEstimate> profileKeys; // KeyProfile の順
+
+  @Float()
+  external double analyzedSeconds;
+
+  @Int32()
+  external int escalated; // 1 = 抜粋の信頼度不足で全曲を解析し直した
+
+  external Pointer<EssentiaMixPoint> mixPoints; // イン候補、アウト候補の順
+
+  @Int32()
+  external int numMixPoints;
+
+  @Float()
+  external double energy; // 0..1、-1 = 不明
+
+  // 最も繰り返される大きな区間（サビ）。全曲解析のときだけ、-1 = なし
+  @Float()
+  external double previewStartSec;
+
+  @Float()
+  external double previewEndSec;
+
+  @Float()
+  external double previewScore; // 0..1
+}
+
+const int essentiaTempoPrecise = 0;
+const int essentiaTempoFast = 1;
+
+final class EssentiaAnalysisOptions extends Struct {
+  @Int32()
+  external int tempoMode; // essentiaTempoPrecise / essentiaTempoFast
+
+  @Int32()
+  external int keyProfile; // KeyProfile.index
+
+  @Int32()
+  external int excerptMode; // 1 = 抜粋区間のみ解析し、信頼度不足なら全曲
+
+  @Float()
+  external double excerptSeconds;
+
+  @Float()
+  external double minBpmConfidence;
+
+  @Float()
+  external double minKeyConfidence;
+
+  @Float()
+  external double minFastBpmConfidence; // 高速モードの信頼度は 0..1
+}
+
 const int styleMaxResults = 5;
 
 final class StyleResult extends Struct {
@@ -33,6 +133,12 @@ final class StyleResult extends Struct {
   @Array(styleMaxResults)
   external Array<Float> confidences;
 
+  @Int32()
+  external int patchesEvaluated;
+
+  @Int32()
+  external int patchesTotal;
+
   @Int32()
   external int errorCode;
 }
@@ -57,6 +163,26 @@ typedef EssentiaInit = void Function();
 typedef EssentiaShutdownNative = Void Function();
 typedef EssentiaShutdown = void Function();
 
+typedef EssentiaSetThreadBudgetNative =
+    Void Function(
+      Int32 maxThreads,
+      Int32 ortIntraOpThreads,
+      Int32 ortInterOpThreads,
+    );
+typedef EssentiaSetThreadBudget =
+    void Function(int maxThreads, int ortIntraOpThreads, int ortInterOpThreads);
+
+// NativeApi.postCObject を渡し、ブリッジのスレッドから ReceivePort へ送る
+typedef DartPostCObject =
+    NativeFunction<Int8 Function(Int64, Pointer<Dart_CObject>)>;
+typedef EssentiaSetDartPostCObjectNative =
+    Void Function(Pointer<DartPostCObject> post);
+typedef EssentiaSetDartPostCObject =
+    void Function(Pointer<DartPostCObject> post);
+
+typedef EssentiaSetModelCacheDirNative = Void Function(Pointer<Utf8> dir);
+typedef EssentiaSetModelCacheDir = void Function(Pointer<Utf8> dir);
+
 typedef EssentiaAnalyzeNative =
     EssentiaResult Function(
       Pointer<Utf8> path,
@@ -68,6 +194,23 @@ typedef EssentiaAnalyze =
       Pointer<EssentiaCancelFlag> cancelFlag,
     );
 
+typedef EssentiaAnalyzeDetailedNative =
+    Pointer<EssentiaAnalysis> Function(
+      Pointer<Utf8> path,
+      Pointer<EssentiaAnalysisOptions> options,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+typedef EssentiaAnalyzeDetailed =
+    Pointer<EssentiaAnalysis> Function(
+      Pointer<Utf8> path,
+      Pointer<EssentiaAnalysisOptions> options,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+
+typedef EssentiaFreeAnalysisNative =
+    Void Function(Pointer<EssentiaAnalysis> analysis);
+typedef EssentiaFreeAnalysis = void Function(Pointer<EssentiaAnalysis> analysis);
+
 typedef EssentiaClassifyStyleNative =
     StyleResult Function(
       Pointer<Utf8> audioPath,
@@ -81,6 +224,79 @@ typedef EssentiaClassifyStyle =
       Pointer<EssentiaCancelFlag> cancelFlag,
     );
 
+typedef EssentiaClassifyStyleFastNative =
+    StyleResult Function(
+      Pointer<Utf8> audioPath,
+      Pointer<Utf8> modelPath,
+      Float stabilityThreshold,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+typedef EssentiaClassifyStyleFast =
+    StyleResult Function(
+      Pointer<Utf8> audioPath,
+      Pointer<Utf8> modelPath,
+      double stabilityThreshold,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+
+typedef EssentiaClassifyStyleExcerptNative =
+    StyleResult Function(
+      Pointer<Utf8> audioPath,
+      Pointer<Utf8> modelPath,
+      Float excerptSeconds,
+      Float minMargin,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+typedef EssentiaClassifyStyleExcerpt =
+    StyleResult Function(
+      Pointer<Utf8> audioPath,
+      Pointer<Utf8> modelPath,
+      double excerptSeconds,
+      double minMargin,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+
+final class StyleTimeline extends Struct {
+  external Pointer<Int32> indices;
+  external Pointer<Float> confidences;
+
+  @Int32()
+  external int numSegments;
+
+  @Int32()
+  external int topK;
+
+  @Float()
+  external double segmentDuration;
+
+  external StyleResult summary;
+
+  @Int32()
+  external int errorCode;
+}
+
+typedef EssentiaClassifyStyleTimelineNative =
+    Pointer<StyleTimeline> Function(
+      Pointer<Utf8> audioPath,
+      Pointer<Utf8> modelPath,
+      Int32 patchesPerSegment,
+      Int32 topK,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+typedef EssentiaClassifyStyleTimeline =
+    Pointer<StyleTimeline> Function(
+      Pointer<Utf8> audioPath,
+      Pointer<Utf8> modelPath,
+      int patchesPerSegment,
+      int topK,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+
+typedef EssentiaFreeStyleTimelineNative =
+    Void Function(Pointer<StyleTimeline> timeline);
+typedef EssentiaFreeStyleTimeline =
+    void Function(Pointer<StyleTimeline> timeline);
+
 final class SpectrumData extends Struct {
   external Pointer<Float> bands;
 
@@ -117,10 +333,179 @@ typedef EssentiaComputeSpectrum =
 typedef EssentiaFreeSpectrumNative = Void Function(Pointer<SpectrumData> data);
 typedef EssentiaFreeSpectrum = void Function(Pointer<SpectrumData> data);
 
+const int spectrumPyramidMax = 0;
+const int spectrumPyramidMean = 1;
+
+final class SpectrumPyramidData extends Struct {
+  external Pointer<Float> bands; // 全段を段 0 から連続して格納
+  external Pointer<Int32> levelOffset;
+  external Pointer<Int32> levelFrames;
+
+  @Int32()
+  external int numLevels;
+
+  @Int32()
+  external int numBands;
+
+  @Float()
+  external double hopDuration; // 段 0 のホップ。段 l は 2^l 倍
+
+  @Int32()
+  external int errorCode;
+}
+
+typedef EssentiaComputeSpectrumPyramidNative =
+    Pointer<SpectrumPyramidData> Function(
+      Pointer<Utf8> path,
+      Int32 numBands,
+      Int32 frameSize,
+      Int32 hopSize,
+      Int32 reduce,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+typedef EssentiaComputeSpectrumPyramid =
+    Pointer<SpectrumPyramidData> Function(
+      Pointer<Utf8> path,
+      int numBands,
+      int frameSize,
+      int hopSize,
+      int reduce,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+
+typedef EssentiaFreeSpectrumPyramidNative =
+    Void Function(Pointer<SpectrumPyramidData> pyramid);
+typedef EssentiaFreeSpectrumPyramid =
+    void Function(Pointer<SpectrumPyramidData> pyramid);
+
+final class SpectrumDataU8 extends Struct {
+  external Pointer<Uint8> bands;
+
+  @Int32()
+  external int numFrames;
+
+  @Int32()
+  external int numBands;
+
+  @Float()
+  external double hopDuration;
+
+  @Float()
+  external double dbOffset; // dB = dbOffset + value * dbScale
+
+  @Float()
+  external double dbScale;
+
+  @Int32()
+  external int errorCode;
+}
+
+typedef EssentiaComputeSpectrumU8Native =
+    Pointer<SpectrumDataU8> Function(
+      Pointer<Utf8> path,
+      Int32 numBands,
+      Int32 frameSize,
+      Int32 hopSize,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+typedef EssentiaComputeSpectrumU8 =
+    Pointer<SpectrumDataU8> Function(
+      Pointer<Utf8> path,
+      int numBands,
+      int frameSize,
+      int hopSize,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+
+typedef EssentiaFreeSpectrumU8Native =
+    Void Function(Pointer<SpectrumDataU8> data);
+typedef EssentiaFreeSpectrumU8 = void Function(Pointer<SpectrumDataU8> data);
+
+typedef EssentiaQuantizeSpectrumBandsNative =
+    Void Function(
+      Pointer<Float> bands,
+      Int32 count,
+      Pointer<Uint8> out,
+      Pointer<Float> dbOffset,
+      Pointer<Float> dbScale,
+    );
+typedef EssentiaQuantizeSpectrumBands =
+    void Function(
+      Pointer<Float> bands,
+      int count,
+      Pointer<Uint8> out,
+      Pointer<Float> dbOffset,
+      Pointer<Float> dbScale,
+    );
+
+final class SpectrumStreamHandle extends Opaque {}
+
+// ネイティブのワーカーが書き込む共有領域。レイアウト項目は開始時に確定する
+final class SpectrumStreamInfo extends Struct {
+  external Pointer<Float> bands;
+  external Pointer<Uint8> chunkReady;
+
+  @Int32()
+  external int numFrames;
+
+  @Int32()
+  external int numBands;
+
+  @Int32()
+  external int numChunks;
+
+  @Int32()
+  external int framesPerChunk;
+
+  @Float()
+  external double hopDuration;
+
+  @Int32()
+  external int errorCode;
+
+  @Int32()
+  external int done;
+}
+
+typedef EssentiaSpectrumStreamStartNative =
+    Pointer<SpectrumStreamHandle> Function(
+      Pointer<Utf8> path,
+      Int32 numBands,
+      Int32 frameSize,
+      Int32 hopSize,
+      Float focusSec,
+    );
+typedef EssentiaSpectrumStreamStart =
+    Pointer<SpectrumStreamHandle> Function(
+      Pointer<Utf8> path,
+      int numBands,
+      int frameSize,
+      int hopSize,
+      double focusSec,
+    );
+
+typedef EssentiaSpectrumStreamInfoNative =
+    Pointer<SpectrumStreamInfo> Function(Pointer<SpectrumStreamHandle> stream);
+typedef EssentiaSpectrumStreamInfo =
+    Pointer<SpectrumStreamInfo> Function(Pointer<SpectrumStreamHandle> stream);
+
+typedef EssentiaSpectrumStreamSetFocusNative =
+    Void Function(Pointer<SpectrumStreamHandle> stream, Float positionSec);
+typedef EssentiaSpectrumStreamSetFocus =
+    void Function(Pointer<SpectrumStreamHandle> stream, double positionSec);
+
+typedef EssentiaSpectrumStreamDestroyNative =
+    Void Function(Pointer<SpectrumStreamHandle> stream);
+typedef EssentiaSpectrumStreamDestroy =
+    void Function(Pointer<SpectrumStreamHandle> stream);
+
 final class StereoPeakData extends Struct {
   external Pointer<Float> leftPeaks;
   external Pointer<Float> rightPeaks;
   external Pointer<Uint8> clipFlags;
+  external Pointer<Float> momentary; // LUFS
+  external Pointer<Float> shortTerm; // LUFS
+  external Pointer<Float> truePeaks; // dBTP
 
   @Int32()
   external int numFrames;
@@ -128,6 +513,21 @@ final class StereoPeakData extends Struct {
   @Float()
   external double hopDuration;
 
+  @Float()
+  external double integratedLufs;
+
+  @Float()
+  external double loudnessRange;
+
+  @Float()
+  external double truePeakMax;
+
+  @Int64()
+  external int contentStartUs;
+
+  @Int64()
+  external int contentEndUs;
+
   @Int32()
   external int errorCode;
 }
@@ -136,15 +536,438 @@ typedef EssentiaComputeStereoPeaksNative =
     Pointer<StereoPeakData> Function(
       Pointer<Utf8> path,
       Int32 hopSize,
+      Float silenceStartDb,
+      Float silenceEndDb,
       Pointer<EssentiaCancelFlag> cancelFlag,
     );
 typedef EssentiaComputeStereoPeaks =
     Pointer<StereoPeakData> Function(
       Pointer<Utf8> path,
       int hopSize,
+      double silenceStartDb,
+      double silenceEndDb,
       Pointer<EssentiaCancelFlag> cancelFlag,
     );
 
 typedef EssentiaFreeStereoPeaksNative =
     Void Function(Pointer<StereoPeakData> data);
 typedef EssentiaFreeStereoPeaks = void Function(Pointer<StereoPeakData> data);
+
+final class RealtimeAnalyzerHandle extends Opaque {}
+
+final class RealtimeFrame extends Struct {
+  external Pointer<Float> bands; // 次の poll / reset まで有効
+
+  @Int32()
+  external int numBands;
+
+  @Float()
+  external double leftPeak;
+
+  @Float()
+  external double rightPeak;
+
+  @Uint8()
+  external int clipFlags; // bit0=left clipped, bit1=right clipped
+
+  @Int32()
+  external int framesConsumed;
+
+  @Int32()
+  external int framesDropped;
+}
+
+typedef EssentiaRealtimeCreateNative =
+    Pointer<RealtimeAnalyzerHandle> Function(
+      Int32 sampleRate,
+      Int32 channels,
+      Int32 numBands,
+      Int32 frameSize,
+      Int32 capacityFrames,
+    );
+typedef EssentiaRealtimeCreate =
+    Pointer<RealtimeAnalyzerHandle> Function(
+      int sampleRate,
+      int channels,
+      int numBands,
+      int frameSize,
+      int capacityFrames,
+    );
+
+typedef EssentiaRealtimePushNative =
+    Int32 Function(
+      Pointer<RealtimeAnalyzerHandle> analyzer,
+      Pointer<Float> interleaved,
+      Int32 numFrames,
+    );
+typedef EssentiaRealtimePush =
+    int Function(
+      Pointer<RealtimeAnalyzerHandle> analyzer,
+      Pointer<Float> interleaved,
+      int numFrames,
+    );
+
+typedef EssentiaRealtimePollNative =
+    Int32 Function(
+      Pointer<RealtimeAnalyzerHandle> analyzer,
+      Pointer<RealtimeFrame> out,
+    );
+typedef EssentiaRealtimePoll =
+    int Function(
+      Pointer<RealtimeAnalyzerHandle> analyzer,
+      Pointer<RealtimeFrame> out,
+    );
+
+typedef EssentiaRealtimeResetNative =
+    Void Function(Pointer<RealtimeAnalyzerHandle> analyzer);
+typedef EssentiaRealtimeReset =
+    void Function(Pointer<RealtimeAnalyzerHandle> analyzer);
+
+typedef EssentiaRealtimeDestroyNative =
+    Void Function(Pointer<RealtimeAnalyzerHandle> analyzer);
+typedef EssentiaRealtimeDestroy =
+    void Function(Pointer<RealtimeAnalyzerHandle> analyzer);
+
+final class EssentiaGainResult extends Struct {
+  @Float()
+  external double integratedLufs;
+
+  @Float()
+  external double peak; // 線形。抜粋を測った場合は下限
+
+  @Float()
+  external double gainDb;
+
+  @Float()
+  external double uncertaintyLu; // 抜粋による推定誤差。0 = 全体を計測
+
+  @Float()
+  external double analyzedSeconds;
+
+  @Int32()
+  external int errorCode;
+
+  external Pointer<Uint32> fingerprint; // 曲頭 30 秒のクロマ。null = 失敗
+
+  @Int32()
+  external int fingerprintLength;
+}
+
+typedef EssentiaAnalyzeGainBatchNative =
+    Void Function(
+      Pointer<Pointer<Utf8>> paths,
+      Int32 count,
+      Int32 fast,
+      Pointer<EssentiaGainResult> results,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+typedef EssentiaAnalyzeGainBatch =
+    void Function(
+      Pointer<Pointer<Utf8>> paths,
+      int count,
+      int fast,
+      Pointer<EssentiaGainResult> results,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+
+typedef EssentiaFreeGainFingerprintsNative =
+    Void Function(Pointer<EssentiaGainResult> results, Int32 count);
+typedef EssentiaFreeGainFingerprints =
+    void Function(Pointer<EssentiaGainResult> results, int count);
+
+final class TrackIndexHandle extends Opaque {}
+
+final class EssentiaTrackQuery extends Struct {
+  @Float()
+  external double bpm; // 0 以下 = テンポを問わない
+
+  @Float()
+  external double bpmTolerance; // 相対値（0.06 = ±6%）
+
+  @Int32()
+  external int halfDouble; // 1 = 半分・倍のテンポも含める
+
+  @Int32()
+  external int camelot; // -1 = 調を問わない
+
+  @Int32()
+  external int harmonicOnly; // 1 = 同じ・隣接・平行調だけ
+
+  @Float()
+  external double energy; // 負 = 無視
+
+  @Float()
+  external double loudness; // -70 以下 = 無視
+
+  @Int32()
+  external int excludeRow;
+}
+
+final class EssentiaTrackMatch extends Struct {
+  @Int32()
+  external int row;
+
+  @Float()
+  external double distance;
+}
+
+typedef EssentiaTrackIndexCreateNative = Pointer<TrackIndexHandle> Function();
+typedef EssentiaTrackIndexCreate = Pointer<TrackIndexHandle> Function();
+
+typedef EssentiaTrackIndexLoadNative =
+    Int32 Function(
+      Pointer<TrackIndexHandle> index,
+      Pointer<Float> bpm,
+      Pointer<Int8> camelot,
+      Pointer<Float> energy,
+      Pointer<Float> loudness,
+      Int32 count,
+    );
+typedef EssentiaTrackIndexLoad =
+    int Function(
+      Pointer<TrackIndexHandle> index,
+      Pointer<Float> bpm,
+      Pointer<Int8> camelot,
+      Pointer<Float> energy,
+      Pointer<Float> loudness,
+      int count,
+    );
+
+typedef EssentiaTrackIndexQueryNative =
+    Int32 Function(
+      Pointer<TrackIndexHandle> index,
+      Pointer<EssentiaTrackQuery> query,
+      Pointer<EssentiaTrackMatch> out,
+      Int32 maxResults,
+    );
+typedef EssentiaTrackIndexQuery =
+    int Function(
+      Pointer<TrackIndexHandle> index,
+      Pointer<EssentiaTrackQuery> query,
+      Pointer<EssentiaTrackMatch> out,
+      int maxResults,
+    );
+
+typedef EssentiaTrackIndexDestroyNative =
+    Void Function(Pointer<TrackIndexHandle> index);
+typedef EssentiaTrackIndexDestroy =
+    void Function(Pointer<TrackIndexHandle> index);
+
+const int essentiaEnergySmooth = 0;
+const int essentiaEnergyRising = 1;
+
+final class EssentiaSequenceOptions extends Struct {
+  @Float()
+  external double tempoWeight;
+
+  @Float()
+  external double keyWeight;
+
+  @Float()
+  external double embeddingWeight;
+
+  @Float()
+  external double energyWeight;
+
+  @Int32()
+  external int energyShape; // essentiaEnergy*
+
+  @Int32()
+  external int firstTrack; // -1 = 先頭を固定しない
+
+  @Int32()
+  external int restarts; // 0 以下 = 8
+
+  @Int32()
+  external int timeLimitMs; // 0 以下 = 改善がなくなるまで
+}
+
+typedef EssentiaSequenceTracksNative =
+    Int32 Function(
+      Pointer<Float> bpm,
+      Pointer<Int8> camelot,
+      Pointer<Float> energy,
+      Pointer<Float> embeddings,
+      Int32 embeddingDim,
+      Int32 count,
+      Pointer<EssentiaSequenceOptions> options,
+      Pointer<Int32> outOrder,
+      Pointer<Float> outCost,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+typedef EssentiaSequenceTracks =
+    int Function(
+      Pointer<Float> bpm,
+      Pointer<Int8> camelot,
+      Pointer<Float> energy,
+      Pointer<Float> embeddings,
+      int embeddingDim,
+      int count,
+      Pointer<EssentiaSequenceOptions> options,
+      Pointer<Int32> outOrder,
+      Pointer<Float> outCost,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+
+final class FingerprintIndexHandle extends Opaque {}
+
+final class EssentiaFingerprintMatch extends Struct {
+  @Int32()
+  external int id;
+
+  @Float()
+  external double similarity; // 一致したビットの割合。0.5 = 無関係
+
+  @Float()
+  external double offsetSec;
+}
+
+typedef EssentiaFingerprintIndexCreateNative =
+    Pointer<FingerprintIndexHandle> Function();
+typedef EssentiaFingerprintIndexCreate =
+    Pointer<FingerprintIndexHandle> Function();
+
+typedef EssentiaFingerprintIndexAddNative =
+    Int32 Function(
+      Pointer<FingerprintIndexHandle> index,
+      Int32 id,
+      Pointer<Uint32> fingerprint,
+      Int32 length,
+    );
+typedef EssentiaFingerprintIndexAdd =
+    int Function(
+      Pointer<FingerprintIndexHandle> index,
+      int id,
+      Pointer<Uint32> fingerprint,
+      int length,
+    );
+
+typedef EssentiaFingerprintIndexQueryNative =
+    Int32 Function(
+      Pointer<FingerprintIndexHandle> index,
+      Pointer<Uint32> fingerprint,
+      Int32 length,
+      Float minSimilarity,
+      Pointer<EssentiaFingerprintMatch> out,
+      Int32 maxResults,
+    );
+typedef EssentiaFingerprintIndexQuery =
+    int Function(
+      Pointer<FingerprintIndexHandle> index,
+      Pointer<Uint32> fingerprint,
+      int length,
+      double minSimilarity,
+      Pointer<EssentiaFingerprintMatch> out,
+      int maxResults,
+    );
+
+typedef EssentiaFingerprintIndexDestroyNative =
+    Void Function(Pointer<FingerprintIndexHandle> index);
+typedef EssentiaFingerprintIndexDestroy =
+    void Function(Pointer<FingerprintIndexHandle> index);
+
+// EssentiaTrackConfig.features のビット
+const int essentiaFeatureTempoKey = 1 << 0;
+const int essentiaFeatureStyle = 1 << 1;
+const int essentiaFeatureSpectrum = 1 << 2;
+const int essentiaFeatureStereoPeaks = 1 << 3;
+
+const int essentiaStyleFull = 0;
+const int essentiaStyleFast = 1;
+const int essentiaStyleExcerpt = 2;
+
+final class EssentiaTrackConfig extends Struct {
+  @Int32()
+  external int features; // essentiaFeature* の OR
+
+  external EssentiaAnalysisOptions analysis;
+
+  external Pointer<Utf8> modelPath;
+
+  @Int32()
+  external int styleMode; // essentiaStyle*
+
+  @Float()
+  external double styleStabilityThreshold;
+
+  @Float()
+  external double styleExcerptSeconds;
+
+  @Float()
+  external double styleMinMargin;
+
+  @Int32()
+  external int spectrumBands;
+
+  @Int32()
+  external int spectrumFrameSize;
+
+  @Int32()
+  external int spectrumHopSize;
+
+  @Int32()
+  external int peakHopSize;
+
+  @Float()
+  external double silenceStartDb;
+
+  @Float()
+  external double silenceEndDb;
+}
+
+// 要求しなかった節は nullptr（style は count 0）
+final class EssentiaTrackAnalysis extends Struct {
+  @Int32()
+  external int features;
+
+  external Pointer<EssentiaAnalysis> analysis;
+
+  external StyleResult style;
+
+  external Pointer<SpectrumDataU8> spectrum;
+
+  external Pointer<StereoPeakData> stereoPeaks;
+
+  @Int32()
+  external int decodes; // 呼び出し全体でファイルをデコードした回数
+
+  @Int32()
+  external int errorCode; // 最初に失敗した節の errorCode
+}
+
+typedef EssentiaAnalyzeTrackNative =
+    Pointer<EssentiaTrackAnalysis> Function(
+      Pointer<Utf8> path,
+      Pointer<EssentiaTrackConfig> config,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+typedef EssentiaAnalyzeTrack =
+    Pointer<EssentiaTrackAnalysis> Function(
+      Pointer<Utf8> path,
+      Pointer<EssentiaTrackConfig> config,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+    );
+
+// essentia_analyze_track_async が送るメッセージ（List<int> の先頭）
+const int essentiaTrackMessageSection = 0; // [type, 節のビット, errorCode]
+const int essentiaTrackMessageDone = 1; // [type, 結果のアドレス]
+
+typedef EssentiaAnalyzeTrackAsyncNative =
+    Int32 Function(
+      Pointer<Utf8> path,
+      Pointer<EssentiaTrackConfig> config,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+      Int64 dartPort,
+    );
+typedef EssentiaAnalyzeTrackAsync =
+    int Function(
+      Pointer<Utf8> path,
+      Pointer<EssentiaTrackConfig> config,
+      Pointer<EssentiaCancelFlag> cancelFlag,
+      int dartPort,
+    );
+
+typedef EssentiaFreeTrackAnalysisNative =
+    Void Function(Pointer<EssentiaTrackAnalysis> analysis);
+typedef EssentiaFreeTrackAnalysis =
+    void Function(Pointer<EssentiaTrackAnalysis> analysis);
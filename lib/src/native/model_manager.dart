@@ -4,6 +4,8 @@ import 'dart:io';
 import 'package:flutter/services.dart';
 import 'package:path_provider/path_provider.dart';
 
+import 'audio_analysis.dart';
+
 class ModelManager {
   static String? _cachedModelPath;
 
@@ -30,6 +32,13 @@ class ModelManager {
       );
     }
 
+    // ORT が最適化したモデルをキャッシュに保存し、次回以降のセッション生成を高速化する
+    final ortCacheDir = Directory(
+      '${(await getApplicationCacheDirectory()).path}/ort',
+    );
+    await ortCacheDir.create(recursive: true);
+    AudioAnalysis.setModelCacheDir(ortCacheDir.path);
+
     _cachedModelPath = modelFile.path;
     dev.log('Model path: $_cachedModelPath', name: 'ModelManager');
     return _cachedModelPath!;
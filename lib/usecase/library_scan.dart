@@ -1,12 +1,16 @@
 import 'dart:convert';
 import 'dart:io';
+import 'dart:math' as math;
+import 'dart:typed_data';
 
 import 'package:audio_metadata_reader/audio_metadata_reader.dart';
 import 'package:audio_service/audio_service.dart';
 import 'package:crypto/crypto.dart';
+import 'package:drift/drift.dart' show Value;
 import 'package:path/path.dart' as p;
 import 'package:segue/database/database.dart';
 import 'package:segue/model/album.dart';
+import 'package:segue/src/native/audio_analysis.dart';
 
 enum ScanKind { uncached, artMissing }
 
@@ -128,6 +132,139 @@ List<Album> groupByAlbum(List<MediaItem> items) {
   return albums;
 }
 
+// ReplayGain 2.0 の基準ラウドネス
+const double gainReferenceLufs = -18.0;
+
+class AlbumGain {
+  final List<String> filePaths;
+  final double gain;
+  final double peak;
+  const AlbumGain(this.filePaths, this.gain, this.peak);
+}
+
+// アルバムごとのラウドネスを曲長で重み付けしたエネルギー平均で求める
+// ゲートは曲単位のため、BS.1770 をアルバム全体に掛けた値とは僅かに異なる
+// アルバム名のない曲と、ゲインが未計測の曲が残っているアルバムは対象外
+// 各曲のラウドネスはトラックゲインの元になった値を使う（integratedLufs は
+// ピーク計測でも上書きされるため、トラックゲインと食い違うことがある）
+Map<String, AlbumGain> computeAlbumGains(List<Track> tracks) {
+  final byAlbum = <String, List<Track>>{};
+  for (final track in tracks) {
+    final album = track.album;
+    if (album == null) continue;
+    byAlbum.putIfAbsent(album, () => []).add(track);
+  }
+
+  final out = <String, AlbumGain>{};
+  byAlbum.forEach((album, members) {
+    if (members.any((t) => t.trackGain == null)) return;
+
+    var energy = 0.0;
+    var weight = 0.0;
+    var peak = 0.0;
+    for (final t in members) {
+      final lufs = gainReferenceLufs - t.trackGain!;
+      final w = (t.durationMs ?? 1000) / 1000.0;
+      if (lufs > -70) {
+        energy += w * math.pow(10, lufs / 10);
+        weight += w;
+      }
+      peak = math.max(peak, t.trackPeak ?? 0);
+    }
+    if (weight == 0) return;
+
+    final lufs = 10 * math.log(energy / weight) / math.ln10;
+    out[album] = AlbumGain(
+      members.map((t) => t.filePath).toList(),
+      gainReferenceLufs - lufs,
+      peak,
+    );
+  });
+  return out;
+}
+
+// 曲長の差がこれ以内なら、曲頭のずれを直せば拍位置やミックスポイントを
+// 使い回せるとみなす
+const int duplicateMaxDurationDiffMs = 1000;
+
+// 重複の組（tracks の添字）ごとに、未解析の曲へ結果を写せる解析済みの曲を選ぶ
+// 戻り値は写し先の filePath から、時刻を写し先に合わせた写し元。
+// 曲長が不明か大きく違う曲どうしは対象外
+Map<String, Track> analysisDonors(
+  List<Track> tracks,
+  List<List<DuplicateMember>> groups,
+) {
+  final out = <String, Track>{};
+  for (final group in groups) {
+    final analyzed = group.where((m) => tracks[m.index].bpm != null).toList();
+    if (analyzed.isEmpty) continue;
+    for (final member in group) {
+      final track = tracks[member.index];
+      final trackMs = track.durationMs;
+      if (track.bpm != null || trackMs == null) continue;
+      for (final donorMember in analyzed) {
+        final donor = tracks[donorMember.index];
+        final donorMs = donor.durationMs;
+        if (donorMs == null) continue;
+        if ((donorMs - trackMs).abs() <= duplicateMaxDurationDiffMs) {
+          out[track.filePath] = _shiftAnalysis(
+            donor,
+            donorMember.offsetSec - member.offsetSec,
+            trackMs / 1000,
+          );
+          break;
+        }
+      }
+    }
+  }
+  return out;
+}
+
+// from の拍位置・ミックスポイント・試聴位置を shiftSec ずらす。
+// 曲の範囲（0..durationSec）から外れた拍とミックスポイントは捨てる
+Track _shiftAnalysis(Track from, double shiftSec, double durationSec) {
+  if (shiftSec == 0) return from;
+
+  Uint8List? beatTicks;
+  final blob = from.beatTicks;
+  if (blob != null) {
+    // SQLite から読んだ Blob は 4 バイト境界に揃っていない場合がある
+    final ticks = Uint8List.fromList(blob).buffer.asFloat32List();
+    final shifted = Float32List.fromList([
+      for (final t in ticks)
+        if (t + shiftSec >= 0 && t + shiftSec < durationSec) t + shiftSec,
+    ]);
+    beatTicks = shifted.buffer.asUint8List();
+  }
+
+  String? mixPointsJson;
+  final json = from.mixPointsJson;
+  if (json != null) {
+    final points = (jsonDecode(json) as List).cast<Map<String, dynamic>>();
+    mixPointsJson = jsonEncode([
+      for (final point in points)
+        if ((point['start'] as num) + shiftSec >= 0 &&
+            (point['end'] as num) + shiftSec <= durationSec)
+          {
+            ...point,
+            'start': (point['start'] as num) + shiftSec,
+            'end': (point['end'] as num) + shiftSec,
+          },
+    ]);
+  }
+
+  final previewUs = from.previewStartUs;
+  return from.copyWith(
+    beatTicks: Value(beatTicks),
+    mixPointsJson: Value(mixPointsJson),
+    previewStartUs: Value(
+      previewUs == null
+          ? null
+          : math.max(0, previewUs + (shiftSec * 1e6).round()),
+    ),
+  );
+}
+
 class Partition {
   final List<Track> cachedReady;
   final List<ScanRequest> toScan;
@@ -155,6 +292,13 @@ MediaItem mediaItemFromTrack(
       'discNumber': track.discNumber,
       'trackNumber': track.trackNumber,
       'wavePath': track.waveCachePath,
+      // 前後の無音を飛ばすための区間（未解析なら null）
+      'contentStartUs': track.contentStartUs,
+      'contentEndUs': track.contentEndUs,
+      // 曲間のつなぎの計画用（MixPoint.listFromJson で読む）
+      'mixPointsJson': track.mixPointsJson,
+      // 試聴を始める位置（サビ、未解析なら null）
+      'previewStartUs': track.previewStartUs,
     },
   );
 }
@@ -3,6 +3,7 @@ import 'dart:typed_data';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
 import 'package:flutter/material.dart';
 import 'package:flutter/scheduler.dart';
+import 'package:segue/database/database.dart';
 import 'package:segue/model/analysis_tab.dart';
 import 'package:segue/providers/analysis_sheet_controller_provider.dart';
 import 'package:segue/providers/audio_handler_provider.dart';
@@ -82,6 +83,10 @@ class _AnalysisScreenState extends ConsumerState<AnalysisScreen>
 
         final exactIndex = seconds / spectrumData.hopDuration;
         final index0 = exactIndex.floor().clamp(0, spectrumData.numFrames - 1);
+        // シーク先が未計算ならそこを優先して計算させる
+        if (!spectrumData.isFrameReady(index0)) {
+          spectrumData.setFocus(seconds);
+        }
         final index1 = (index0 + 1).clamp(0, spectrumData.numFrames - 1);
         final t = (exactIndex - index0).clamp(0.0, 1.0);
 
@@ -104,9 +109,10 @@ class _AnalysisScreenState extends ConsumerState<AnalysisScreen>
           targetPeakR =
               peakData.rightPeaks[pi0] +
               (peakData.rightPeaks[pi1] - peakData.rightPeaks[pi0]) * pt;
+          // サンプル値のクリップに加え、トゥルーピークの 0 dBTP 超えも示す
           final flags = peakData.clipFlags[pi0];
-          targetClipL = (flags & 1) != 0;
-          targetClipR = (flags & 2) != 0;
+          targetClipL = (flags & (1 | 4)) != 0;
+          targetClipR = (flags & (2 | 8)) != 0;
         }
       }
     }
@@ -343,6 +349,20 @@ class _AnalysisScreenState extends ConsumerState<AnalysisScreen>
             ),
           ),
         ],
+        if (playerState.compatibleTracks.isNotEmpty) ...[
+          const SizedBox(height: 16),
+          Text(
+            '次に合う曲',
+            style: theme.textTheme.labelLarge?.copyWith(color: Colors.white54),
+          ),
+          const SizedBox(height: 8),
+          ...playerState.compatibleTracks.map(
+            (track) => Padding(
+              padding: const EdgeInsets.only(bottom: 8),
+              child: _buildCompatibleRow(context, track),
+            ),
+          ),
+        ],
         if (playerState.bpm == null &&
             playerState.key == null &&
             (playerState.styles == null || playerState.styles!.isEmpty))
@@ -356,6 +376,30 @@ class _AnalysisScreenState extends ConsumerState<AnalysisScreen>
     );
   }
 
+  Widget _buildCompatibleRow(BuildContext context, Track track) {
+    final theme = Theme.of(context);
+
+    return Row(
+      children: [
+        Expanded(
+          child: Text(
+            track.title,
+            style: theme.textTheme.bodyLarge,
+            overflow: TextOverflow.ellipsis,
+          ),
+        ),
+        const SizedBox(width: 8),
+        Text(
+          [
+            if (track.bpm != null) '${track.bpm!.round()}',
+            if (track.musicalKey != null) track.musicalKey!,
+          ].join(' · '),
+          style: theme.textTheme.bodyMedium?.copyWith(color: Colors.white54),
+        ),
+      ],
+    );
+  }
+
   Widget _buildStyleRow(BuildContext context, style) {
     final theme = Theme.of(context);
     final percentage = (style.confidence * 100).toStringAsFixed(1);
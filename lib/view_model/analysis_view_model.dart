@@ -1,4 +1,6 @@
 import 'package:flutter_riverpod/flutter_riverpod.dart';
+import 'package:segue/database/database.dart';
+import 'package:segue/providers/library_index_provider.dart';
 import 'package:segue/src/native/audio_analysis.dart';
 import 'package:segue/view_model/player_view_model.dart';
 
@@ -7,22 +9,29 @@ class AnalysisState {
   final double? bpm;
   final String? key;
   final List<StylePrediction>? styles;
+  final List<Track> compatibleTracks; // 再生中の曲から続けてつなぐ順
 
   const AnalysisState({
     this.isAnalyzing = false,
     this.bpm,
     this.key,
     this.styles,
+    this.compatibleTracks = const [],
   });
 }
 
 final analysisViewModelProvider = Provider<AnalysisState>((ref) {
   // TODO: player_view_model への依存を解消する
   final player = ref.watch(playerViewModelProvider);
+  final filePath = player.playingMediaItem?.id;
+  final upNext = filePath != null
+      ? ref.watch(upNextProvider(filePath)).value
+      : null;
   return AnalysisState(
     isAnalyzing: player.isAnalyzing,
     bpm: player.bpm,
     key: player.key,
     styles: player.styles,
+    compatibleTracks: upNext ?? const [],
   );
 });
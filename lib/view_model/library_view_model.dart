@@ -14,6 +14,8 @@ import 'package:segue/model/album.dart';
 import 'package:segue/model/library_state.dart';
 import 'package:segue/providers/audio_handler_provider.dart';
 import 'package:segue/providers/database_provider.dart';
+import 'package:segue/providers/library_index_provider.dart';
+import 'package:segue/src/native/audio_analysis.dart';
 import 'package:segue/usecase/library_scan.dart';
 
 final libraryViewModelProvider =
@@ -150,6 +152,88 @@ class LibraryViewModel extends Notifier<LibraryState> {
       writer: _writerFor(dao),
       runBatch: (batch) => Isolate.run(() => scanBatch(batch, tempDirPath)),
     );
+
+    if (gen != _scanGeneration) return;
+    await _analyzeGains(dao, path, gen);
+  }
+
+  // タグの読み込み後、ゲイン未計測の曲を測ってアルバムゲインを更新する
+  Future<void> _analyzeGains(TrackDao dao, String directory, int gen) async {
+    final tracks = await dao.getTracksByDirectory(directory);
+    // フィンガープリントの列は計測を試みたかどうかも表す（失敗した曲は空）
+    final pending = tracks
+        .where((t) => t.fingerprint == null)
+        .map((t) => t.filePath)
+        .toList();
+
+    for (final batch in chunk(pending, _scanBatchSize)) {
+      if (gen != _scanGeneration) return;
+      final gains = await AudioAnalysis.analyzeGainBatch(batch);
+      if (gen != _scanGeneration) return;
+
+      await dao.transaction(() async {
+        for (var i = 0; i < batch.length; i++) {
+          final gain = gains[i];
+          if (gain == null) continue;
+          if (gain.failed) {
+            // 読めない曲は何度測っても同じなので、次のスキャンでは測らない
+            await dao.markGainFailed(batch[i]);
+            continue;
+          }
+          await dao.saveTrackGain(
+            filePath: batch[i],
+            integratedLufs: gain.integratedLufs,
+            trackGain: gain.gainDb,
+            trackPeak: gain.peak,
+            fingerprint: gain.fingerprintToBlob(),
+          );
+        }
+      });
+    }
+
+    if (gen != _scanGeneration) return;
+    if (pending.isNotEmpty) {
+      final albums = computeAlbumGains(
+        await dao.getTracksByDirectory(directory),
+      );
+      await dao.transaction(() async {
+        for (final album in albums.values) {
+          await dao.saveAlbumGain(
+            filePaths: album.filePaths,
+            albumGain: album.gain,
+            albumPeak: album.peak,
+          );
+        }
+      });
+    }
+
+    // 計測する曲がなくても、他のフォルダで解析された重複を拾うため毎回行う
+    if (gen != _scanGeneration) return;
+    await _shareDuplicateAnalysis(dao, gen);
+  }
+
+  // ライブラリ全体でフィンガープリントが一致した曲のうち、
+  // 未解析の曲へ解析済みの曲の結果を写す
+  Future<void> _shareDuplicateAnalysis(TrackDao dao, int gen) async {
+    final tracks = await dao.getFingerprintedTracks();
+    final groups = await AudioAnalysis.findDuplicateGroups([
+      for (final t in tracks) TrackGain.fingerprintFromBlob(t.fingerprint!),
+    ]);
+    if (gen != _scanGeneration) return;
+
+    final donors = analysisDonors(tracks, groups);
+    if (donors.isEmpty) return;
+    // 写し元が同じでも曲頭のずれが違えば時刻も違うので、写す内容でまとめる
+    final byDonor = <Track, List<String>>{};
+    donors.forEach((filePath, donor) {
+      byDonor.putIfAbsent(donor, () => []).add(filePath);
+    });
+    await dao.transaction(() async {
+      for (final entry in byDonor.entries) {
+        await dao.copyAnalysis(from: entry.key, filePaths: entry.value);
+      }
+    });
+    ref.invalidate(libraryIndexProvider);
   }
 
   static ScanWriter _writerFor(TrackDao dao) => _DaoScanWriter(dao);
@@ -1,9 +1,11 @@
 import 'package:audio_service/audio_service.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
 import 'package:rxdart/rxdart.dart';
+import 'package:segue/database/track_dao.dart';
 import 'package:segue/model/player_state.dart';
 import 'package:segue/providers/audio_handler_provider.dart';
 import 'package:segue/providers/database_provider.dart';
+import 'package:segue/providers/library_index_provider.dart';
 import 'package:segue/src/native/audio_analysis.dart';
 import 'package:segue/src/native/model_manager.dart';
 
@@ -27,32 +29,56 @@ class PlayerViewModel extends Notifier<PlayerState> {
           final cached = await dao.getTrackByPath(item.id);
           if (state.playingMediaItem?.id != item.id) return;
 
+          List<StylePrediction>? cachedStyles;
           if (cached != null && cached.analyzedAt != null) {
-            final styles = cached.stylesJson != null
+            cachedStyles = cached.stylesJson != null
                 ? StylePrediction.listFromJson(cached.stylesJson!)
                 : null;
+            final current = cached.analysisVersion == TrackDao.analysisVersion;
             state = state.copyWith(
               bpm: cached.bpm,
               key: cached.musicalKey,
-              styles: styles,
-              isAnalyzing: styles == null,
+              styles: cachedStyles,
+              isAnalyzing: cachedStyles == null || !current,
             );
-            if (styles != null) return;
+            if (current) {
+              if (cachedStyles != null) return;
 
-            await _classifyStyle(item.id);
-            if (state.playingMediaItem?.id != item.id) return;
-            state = state.copyWith(isAnalyzing: false);
-            return;
+              await _classifyStyle(item.id);
+              if (state.playingMediaItem?.id != item.id) return;
+              state = state.copyWith(isAnalyzing: false);
+              return;
+            }
+            // 古い形式の解析は拍位置やミックス点などが欠けているので解析し直す
+            // それまでは保存済みの値を表示しておく
           }
 
-          final result = await AudioAnalysis.analyze(pathStr: item.id);
+          // 拍・調と、まだなければスタイルを 1 回のデコードでまとめて求める
+          final modelPath = cachedStyles == null
+              ? await _ensureStyleModel()
+              : null;
+          if (state.playingMediaItem?.id != item.id) return;
+
+          final track = await AudioAnalysis.analyzeTrack(
+            pathStr: item.id,
+            features: {
+              TrackFeature.tempoKey,
+              if (modelPath != null) TrackFeature.style,
+            },
+            modelPath: modelPath,
+          );
           if (state.playingMediaItem?.id != item.id) return;
+          final result = track?.analysis;
           if (result == null) {
             state = state.copyWith(isAnalyzing: false);
             return;
           }
 
-          state = state.copyWith(bpm: result.bpm, key: result.key);
+          state = state.copyWith(
+            bpm: result.bpm,
+            key: result.key,
+            styles: track!.styles,
+          );
 
           await dao.saveAnalysisResult(
             filePath: item.id,
@@ -60,10 +86,19 @@ class PlayerViewModel extends Notifier<PlayerState> {
             bpmConfidence: result.bpmConfidence,
             musicalKey: result.key,
             keyConfidence: result.keyConfidence,
+            beatTicks: result.beatTicksToBlob(),
+            mixPointsJson: MixPoint.listToJson(result.mixPoints),
+            energy: result.energy,
+            previewStart: result.previewStart,
           );
-          if (state.playingMediaItem?.id != item.id) return;
-
-          await _classifyStyle(item.id);
+          final styles = track.styles;
+          if (styles != null) {
+            await dao.saveStylePredictions(
+              filePath: item.id,
+              stylesJson: StylePrediction.listToJson(styles),
+            );
+          }
+          ref.invalidate(libraryIndexProvider);
           if (state.playingMediaItem?.id != item.id) return;
           state = state.copyWith(isAnalyzing: false);
         });
@@ -71,11 +106,21 @@ class PlayerViewModel extends Notifier<PlayerState> {
     return PlayerState(playingMediaItem: null);
   }
 
-  Future<void> _classifyStyle(String audioPath) async {
+  // モデルを用意できないときは null。スタイルなしで拍・調だけ解析する
+  Future<String?> _ensureStyleModel() async {
     try {
-      final modelPath = await ModelManager.ensureModel(
+      return await ModelManager.ensureModel(
         'models/discogs-effnet-bsdynamic-1.onnx',
       );
+    } catch (_) {
+      return null;
+    }
+  }
+
+  Future<void> _classifyStyle(String audioPath) async {
+    try {
+      final modelPath = await _ensureStyleModel();
+      if (modelPath == null) return;
       if (state.playingMediaItem?.id != audioPath) return;
 
       final styles = await AudioAnalysis.classifyStyle(
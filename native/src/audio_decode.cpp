@@ -1,5 +1,7 @@
 #include "audio_decode.h"
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 
 #ifdef __ANDROID__
@@ -14,6 +16,13 @@
 
 #include <essentia/algorithmfactory.h>
 
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
 using namespace essentia;
 using namespace essentia::standard;
 
@@ -49,3 +58,324 @@ int decode_audio(const char* path, std::vector<float>& out_samples, int target_s
 
   return is_cancelled(cancel_flag) ? 1 : 0;
 }
+
+// 1 回のデコードに必要な FFmpeg の状態。スコープを抜けると全て解放する
+struct RangeDecoder {
+  AVFormatContext* fmt = nullptr;
+  AVCodecContext* codec = nullptr;
+  SwrContext* swr = nullptr;
+  AVPacket* packet = nullptr;
+  AVFrame* frame = nullptr;
+  int stream_index = -1;
+  int swr_channels = 0;  // リサンプラの出力チャンネル数（1 または 2）
+
+  ~RangeDecoder() {
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    swr_free(&swr);
+    avcodec_free_context(&codec);
+    avformat_close_input(&fmt);
+  }
+};
+
+static int open_range_decoder(RangeDecoder& d, const char* path, int target_sr) {
+  if (avformat_open_input(&d.fmt, path, nullptr, nullptr) != 0) {
+    LOGE("Failed to open: %s", path);
+    return -1;
+  }
+  if (avformat_find_stream_info(d.fmt, nullptr) < 0) {
+    LOGE("Failed to read stream info: %s", path);
+    return -1;
+  }
+
+  const AVCodec* decoder = nullptr;
+  d.stream_index = av_find_best_stream(d.fmt, AVMEDIA_TYPE_AUDIO, -1, -1, &decoder, 0);
+  if (d.stream_index < 0 || !decoder) {
+    LOGE("No audio stream: %s", path);
+    return -1;
+  }
+
+  d.codec = avcodec_alloc_context3(decoder);
+  if (!d.codec ||
+      avcodec_parameters_to_context(d.codec, d.fmt->streams[d.stream_index]->codecpar) < 0 ||
+      avcodec_open2(d.codec, decoder, nullptr) < 0) {
+    LOGE("Failed to open decoder: %s", path);
+    return -1;
+  }
+
+  // ダウンミックスは MonoLoader と同じ (L + R) / 2 にするため、リサンプラは 2ch までに留める
+  d.swr_channels = d.codec->ch_layout.nb_channels >= 2 ? 2 : 1;
+  AVChannelLayout out_layout;
+  av_channel_layout_default(&out_layout, d.swr_channels);
+  int ret = swr_alloc_set_opts2(&d.swr, &out_layout, AV_SAMPLE_FMT_FLT, target_sr,
+                                &d.codec->ch_layout, d.codec->sample_fmt, d.codec->sample_rate, 0,
+                                nullptr);
+  av_channel_layout_uninit(&out_layout);
+  if (ret < 0 || swr_init(d.swr) < 0) {
+    LOGE("Failed to create resampler: %s", path);
+    return -1;
+  }
+
+  d.packet = av_packet_alloc();
+  d.frame = av_frame_alloc();
+  return (d.packet && d.frame) ? 0 : -1;
+}
+
+// リサンプラでフレームを変換し、出力したサンプル数を返す
+static int convert_samples(RangeDecoder& d, std::vector<float>& converted, const uint8_t** input,
+                           int input_samples) {
+  int capacity = swr_get_out_samples(d.swr, input_samples);
+  if (capacity <= 0) return 0;
+  converted.resize((size_t)capacity * d.swr_channels);
+  uint8_t* output = reinterpret_cast<uint8_t*>(converted.data());
+  return swr_convert(d.swr, &output, capacity, input, input_samples);
+}
+
+// 変換済みの 1 サンプルを channels に合わせて out に追加する
+static void append_sample(const RangeDecoder& d, const float* sample, int channels,
+                          std::vector<float>& out) {
+  if (channels == 1) {
+    out.push_back(d.swr_channels == 2 ? 0.5f * (sample[0] + sample[1]) : sample[0]);
+  } else {
+    out.push_back(sample[0]);
+    out.push_back(sample[d.swr_channels - 1]);
+  }
+}
+
+// 戻り値は decode_audio_range と同じ。-2 はシーク後の位置が分からないことを表す
+static int decode_range(const char* path, double start_sec, double duration_sec, int target_sr,
+                        int channels, bool allow_seek, std::vector<float>& out_samples,
+                        double* out_start_sec, EssentiaCancelFlag* cancel_flag) {
+  RangeDecoder d;
+  if (open_range_decoder(d, path, target_sr) != 0) return -1;
+  AVStream* stream = d.fmt->streams[d.stream_index];
+
+  bool seeked = false;
+  if (allow_seek && start_sec > 0) {
+    int64_t target = av_rescale_q((int64_t)(start_sec * AV_TIME_BASE), AV_TIME_BASE_Q,
+                                  stream->time_base);
+    if (stream->start_time != AV_NOPTS_VALUE) target += stream->start_time;
+    if (av_seek_frame(d.fmt, d.stream_index, target, AVSEEK_FLAG_BACKWARD) >= 0) {
+      avcodec_flush_buffers(d.codec);
+      seeked = true;
+    } else {
+      LOGI("Seek not supported, decoding from start: %s", path);
+    }
+  }
+
+  // 出力サンプルレートでの曲頭からの位置で管理し、開始位置より前は読み捨てる
+  const int64_t start_index = (int64_t)std::llround(start_sec * target_sr);
+  const size_t wanted = (size_t)std::llround(duration_sec * target_sr);
+  int64_t position = seeked ? -1 : 0;
+  int64_t first_kept = -1;
+  size_t kept = 0;
+
+  out_samples.clear();
+  out_samples.reserve(wanted * channels);
+  std::vector<float> converted;
+
+  // 変換済みのサンプルを範囲内だけ out_samples に移す。range を満たしたら true
+  auto emit = [&](int count) {
+    for (int i = 0; i < count && kept < wanted; i++, position++) {
+      if (position < start_index) continue;
+      if (first_kept < 0) first_kept = position;
+      append_sample(d, converted.data() + (size_t)i * d.swr_channels, channels, out_samples);
+      kept++;
+    }
+    return kept >= wanted;
+  };
+
+  bool done = false;
+  bool draining = false;
+  bool finished = false;  // デコーダが全フレームを出し終えた
+  int packets = 0;
+  while (!done) {
+    if (!draining) {
+      if (++packets % 64 == 0 && is_cancelled(cancel_flag)) return 1;
+
+      int read_ret = av_read_frame(d.fmt, d.packet);
+      if (read_ret < 0) {
+        avcodec_send_packet(d.codec, nullptr);
+        draining = true;
+      } else {
+        if (d.packet->stream_index == d.stream_index) avcodec_send_packet(d.codec, d.packet);
+        av_packet_unref(d.packet);
+      }
+    }
+
+    while (!done) {
+      int recv_ret = avcodec_receive_frame(d.codec, d.frame);
+      if (recv_ret == AVERROR(EAGAIN)) break;
+      if (recv_ret < 0) {
+        finished = true;
+        break;
+      }
+
+      // シーク直後は最初のフレームの時刻から出力位置を決める
+      if (position < 0) {
+        int64_t pts = d.frame->best_effort_timestamp;
+        if (pts == AV_NOPTS_VALUE) return -2;
+        if (stream->start_time != AV_NOPTS_VALUE) pts -= stream->start_time;
+        position = (int64_t)std::llround(pts * av_q2d(stream->time_base) * target_sr);
+      }
+
+      int count = convert_samples(d, converted,
+                                  const_cast<const uint8_t**>(d.frame->extended_data),
+                                  d.frame->nb_samples);
+      av_frame_unref(d.frame);
+      if (count > 0 && emit(count)) done = true;
+    }
+
+    // リサンプラに残ったサンプルを吐き出して終える
+    if (finished && !done) {
+      int count = convert_samples(d, converted, nullptr, 0);
+      if (count > 0) emit(count);
+      done = true;
+    }
+  }
+
+  if (out_samples.empty()) {
+    LOGE("No audio samples decoded in range %.1f+%.1f s", start_sec, duration_sec);
+    return -1;
+  }
+  if (out_start_sec) *out_start_sec = (double)first_kept / target_sr;
+
+  LOGI("Decoded range %.2f+%.2f s (%s, %zu samples)", (double)first_kept / target_sr,
+       (double)kept / target_sr, seeked ? "seek" : "discard", kept);
+  return is_cancelled(cancel_flag) ? 1 : 0;
+}
+
+int decode_audio_range(const char* path, double start_sec, double duration_sec, int target_sr,
+                       int channels, std::vector<float>& out_samples, double* out_start_sec,
+                       EssentiaCancelFlag* cancel_flag) {
+  if (is_cancelled(cancel_flag)) {
+    return 1;
+  }
+  if (start_sec < 0) start_sec = 0;
+  channels = channels == 2 ? 2 : 1;
+
+  int ret = decode_range(path, start_sec, duration_sec, target_sr, channels, true, out_samples,
+                         out_start_sec, cancel_flag);
+  if (ret == -2) {
+    // シーク先でタイムスタンプが得られない形式は先頭から読み捨てる
+    LOGI("No timestamp after seek, decoding from start: %s", path);
+    ret = decode_range(path, start_sec, duration_sec, target_sr, channels, false, out_samples,
+                       out_start_sec, cancel_flag);
+  }
+  return ret;
+}
+
+int decode_audio_stream(const char* path, int target_sr, int channels, double chunk_seconds,
+                        AudioChunkConsumer& consumer, EssentiaCancelFlag* cancel_flag) {
+  if (is_cancelled(cancel_flag)) {
+    return 1;
+  }
+  RangeDecoder d;
+  if (open_range_decoder(d, path, target_sr) != 0) return -1;
+  channels = channels == 0 ? d.swr_channels : (channels == 2 ? 2 : 1);
+  consumer.start(channels);
+
+  const size_t chunk_samples = (size_t)std::llround(chunk_seconds * target_sr) * channels;
+  std::vector<float> chunk, converted;
+  chunk.reserve(chunk_samples);
+  size_t total = 0;
+
+  // 変換済みのサンプルを chunk に詰め、満杯になるたびに渡す
+  auto emit = [&](int count) {
+    for (int i = 0; i < count; i++) {
+      append_sample(d, converted.data() + (size_t)i * d.swr_channels, channels, chunk);
+      if (chunk.size() >= chunk_samples) {
+        consumer.consume(chunk);
+        total += chunk.size();
+        chunk.clear();
+      }
+    }
+  };
+
+  bool draining = false;
+  int packets = 0;
+  for (;;) {
+    if (!draining) {
+      if (++packets % 64 == 0 && is_cancelled(cancel_flag)) return 1;
+
+      int read_ret = av_read_frame(d.fmt, d.packet);
+      if (read_ret == AVERROR_EOF) {
+        avcodec_send_packet(d.codec, nullptr);
+        draining = true;
+      } else if (read_ret < 0) {
+        LOGE("Read failed after %.1f s: %s", (double)total / channels / target_sr, path);
+        return -2;
+      } else {
+        if (d.packet->stream_index == d.stream_index) avcodec_send_packet(d.codec, d.packet);
+        av_packet_unref(d.packet);
+      }
+    }
+
+    int recv_ret;
+    while ((recv_ret = avcodec_receive_frame(d.codec, d.frame)) >= 0) {
+      int count = convert_samples(d, converted,
+                                  const_cast<const uint8_t**>(d.frame->extended_data),
+                                  d.frame->nb_samples);
+      av_frame_unref(d.frame);
+      if (count > 0) emit(count);
+    }
+    if (recv_ret == AVERROR_EOF) break;
+    if (recv_ret != AVERROR(EAGAIN)) {
+      LOGE("Decode failed after %.1f s: %s", (double)total / channels / target_sr, path);
+      return -2;
+    }
+  }
+
+  // リサンプラに残ったサンプルと端数のチャンクを渡して終える
+  int count = convert_samples(d, converted, nullptr, 0);
+  if (count > 0) emit(count);
+  if (!chunk.empty()) {
+    consumer.consume(chunk);
+    total += chunk.size();
+  }
+
+  if (total == 0) {
+    LOGE("No audio samples decoded: %s", path);
+    return -1;
+  }
+  LOGI("Decoded stream %.1f s in %.0f s chunks", (double)total / channels / target_sr,
+       chunk_seconds);
+  return is_cancelled(cancel_flag) ? 1 : 0;
+}
+
+double probe_audio_duration(const char* path) {
+  AVFormatContext* fmt = nullptr;
+  if (avformat_open_input(&fmt, path, nullptr, nullptr) != 0) {
+    LOGE("Failed to open for probing: %s", path);
+    return 0;
+  }
+
+  double duration = 0;
+  if (fmt->duration == AV_NOPTS_VALUE && avformat_find_stream_info(fmt, nullptr) < 0) {
+    LOGE("Failed to read stream info: %s", path);
+  } else if (fmt->duration != AV_NOPTS_VALUE) {
+    duration = (double)fmt->duration / AV_TIME_BASE;
+  }
+
+  avformat_close_input(&fmt);
+  return duration;
+}
+
+int probe_audio_channels(const char* path) {
+  AVFormatContext* fmt = nullptr;
+  if (avformat_open_input(&fmt, path, nullptr, nullptr) != 0) {
+    LOGE("Failed to open for probing: %s", path);
+    return 0;
+  }
+
+  int channels = 0;
+  if (avformat_find_stream_info(fmt, nullptr) < 0) {
+    LOGE("Failed to read stream info: %s", path);
+  } else {
+    int index = av_find_best_stream(fmt, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (index >= 0) channels = std::min(2, fmt->streams[index]->codecpar->ch_layout.nb_channels);
+  }
+
+  avformat_close_input(&fmt);
+  return channels;
+}
@@ -8,4 +8,38 @@
 int decode_audio(const char* path, std::vector<float>& out_samples, int target_sr,
                  EssentiaCancelFlag* cancel_flag);
 
+// [start_sec, start_sec + duration_sec) を target_sr で返す（channels=2 ならインターリーブ）
+// コンテナがシークできればキーフレームへ戻ってデコーダをフラッシュし、開始位置まで読み捨てる
+// シークできない形式は先頭からデコードして読み捨てる。out_start_sec には実際の開始位置を返す
+// 戻り値は decode_audio と同じ（0=成功, 1=キャンセル, 負=失敗）。Essentia のロックは不要
+int decode_audio_range(const char* path, double start_sec, double duration_sec, int target_sr,
+                       int channels, std::vector<float>& out_samples, double* out_start_sec,
+                       EssentiaCancelFlag* cancel_flag);
+
+// decode_audio_stream が区切ったサンプルを受け取る側
+class AudioChunkConsumer {
+ public:
+  virtual ~AudioChunkConsumer() {}
+
+  // 最初の consume より前に 1 度だけ、渡すサンプルのチャンネル数（1 か 2）を知らせる
+  virtual void start(int channels) = 0;
+
+  // samples は chunk_seconds 分（最後だけ短い）。2 チャンネルならインターリーブ
+  virtual void consume(const std::vector<float>& samples) = 0;
+};
+
+// 曲全体を先頭から 1 度だけ開いてデコードし、chunk_seconds ごとに consumer へ渡す
+// channels=0 なら元の音声に合わせる（モノラルは 1、2 チャンネル以上は 2）
+// シークしないためタイムスタンプのない形式でも曲長に比例した時間で済む
+// 戻り値は 0=成功, 1=キャンセル, -1=開けないか 1 サンプルも読めない,
+// -2=途中で読み込みかデコードに失敗（それまでの分は consumer に渡し済み）
+int decode_audio_stream(const char* path, int target_sr, int channels, double chunk_seconds,
+                        AudioChunkConsumer& consumer, EssentiaCancelFlag* cancel_flag);
+
+// コンテナのヘッダから曲長（秒）を読む。取得できなければ 0
+double probe_audio_duration(const char* path);
+
+// 音声ストリームのチャンネル数を 2 までに丸めて返す。取得できなければ 0
+int probe_audio_channels(const char* path);
+
 #endif  // AUDIO_DECODE_H
@@ -0,0 +1,79 @@
+#include "chroma_fingerprint.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Chromaprint と同じ A0 付近から A7 までの帯域をクロマに折り畳む
+static const float MIN_FREQUENCY = 28.0f;
+static const float MAX_FREQUENCY = 3520.0f;
+// 満振幅の正弦波に対して -70 dB 未満を無音とする
+static const float SILENCE_DB = -70.0f;
+
+ChromaFingerprinter::ChromaFingerprinter(int sample_rate)
+    : chroma_bins_(frame_size(sample_rate), sample_rate, MIN_FREQUENCY, MAX_FREQUENCY),
+      raw_(SMOOTHING * PITCH_CLASSES, 0.0f) {
+  const int frameSize = frame_size(sample_rate);
+  // 非正規化 Hann 窓では振幅 A の正弦波のピークが A * frameSize / 4 になる
+  const float amplitude = frameSize * 0.25f * powf(10.0f, SILENCE_DB / 20.0f);
+  silence_ = amplitude * amplitude;
+  std::fill(previous_, previous_ + PITCH_CLASSES, 0.0f);
+}
+
+int ChromaFingerprinter::frame_size(int sample_rate) {
+  // 時間長が最も近い 2 のべき
+  const double target = (double)FRAME_SIZE * sample_rate / SAMPLE_RATE;
+  int size = 1;
+  while (size * 2 <= target * M_SQRT2) size *= 2;
+  return size;
+}
+
+int ChromaFingerprinter::hop_size(int sample_rate) {
+  return std::max(1, (int)lround((double)HOP_SIZE * sample_rate / SAMPLE_RATE));
+}
+
+void ChromaFingerprinter::consume(const std::vector<float>& spectrum) {
+  float chroma[PITCH_CLASSES];
+  chroma_bins_.compute(spectrum, chroma);
+  float total = 0;
+  for (float c : chroma) total += c;
+  const bool silent = total < silence_;
+
+  // 音量に依らないよう L2 正規化してから、直近 SMOOTHING フレームで平均する
+  float* slot = &raw_[(frames_ % SMOOTHING) * PITCH_CLASSES];
+  float norm = 0;
+  for (float c : chroma) norm += c * c;
+  norm = silent ? 0.0f : 1.0f / sqrtf(norm);
+  for (int b = 0; b < PITCH_CLASSES; b++) slot[b] = chroma[b] * norm;
+  frames_++;
+
+  float smoothed[PITCH_CLASSES] = {};
+  const int rows = std::min(frames_, SMOOTHING);
+  for (int r = 0; r < rows; r++) {
+    for (int b = 0; b < PITCH_CLASSES; b++) smoothed[b] += raw_[r * PITCH_CLASSES + b] / rows;
+  }
+
+  energy_.push_back(10.0f * log10f(total + 1e-12f));
+  const size_t t = energy_.size() - 1;
+
+  uint32_t bits = 0;
+  if (!silent) {
+    for (int b = 0; b < PITCH_CLASSES; b++) {
+      const int next = (b + 1) % PITCH_CLASSES;
+      const float diff = smoothed[b] - smoothed[next];
+      if (diff > 0) bits |= 1u << b;
+      if (diff > previous_[b] - previous_[next]) bits |= 1u << (12 + b);
+    }
+    for (int b = 0; b < 6; b++) {
+      float near = 0, far = 0;
+      for (int i = 0; i < 3; i++) {
+        near += smoothed[(b + i) % PITCH_CLASSES];
+        far += smoothed[(b + i + 6) % PITCH_CLASSES];
+      }
+      if (near > far) bits |= 1u << (24 + b);
+    }
+    if (t >= 1 && energy_[t] > energy_[t - 1]) bits |= 1u << 30;
+    if (t >= 3 && energy_[t] > energy_[t - 3]) bits |= 1u << 31;
+  }
+  std::copy(smoothed, smoothed + PITCH_CLASSES, previous_);
+  fingerprint_.push_back(bits);
+}
@@ -0,0 +1,52 @@
+#ifndef CHROMA_FINGERPRINT_H
+#define CHROMA_FINGERPRINT_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "frame_engine.h"
+#include "spectrum_bands.h"
+
+// Chromaprint と同じく 11025 Hz・4096 サンプル・2/3 重なりの時間解像度でクロマを求め、
+// フレームごとに 32 ビットのサブフィンガープリントを作る
+// 他のレートでも同じ時間長のフレームになるよう frame_size / hop_size を使って登録する
+// Essentia のアルゴリズムは使わないのでグローバルロックは不要
+//
+// ビット 0-11  : クロマの形（ビン b がビン b+1 より強い）
+// ビット 12-23 : 形の時間変化（隣接ビンの差が前フレームより増えた）
+// ビット 24-29 : 3 半音の塊とその三全音反対側の比較
+// ビット 30-31 : フレームのエネルギーが 1 / 3 フレーム前より大きい
+// 無音のフレームは 0 とし、照合では使わない
+class ChromaFingerprinter : public FrameConsumer {
+ public:
+  static const int SAMPLE_RATE = 11025;
+  static const int FRAME_SIZE = 4096;
+  static const int HOP_SIZE = 1365;
+  // 形と塊のビットだけを取り出すマスク。コーデックの違いで変わりにくく、索引のキーに使う
+  static const uint32_t KEY_MASK = 0x3F000FFFu;
+
+  explicit ChromaFingerprinter(int sample_rate);
+
+  // sample_rate で 11025 Hz のフレーム・ホップと同じ時間長になるサンプル数
+  static int frame_size(int sample_rate);
+  static int hop_size(int sample_rate);
+
+  void consume(const std::vector<float>& spectrum) override;
+
+  const std::vector<uint32_t>& fingerprint() const { return fingerprint_; }
+
+ private:
+  static const int PITCH_CLASSES = ChromaBins::PITCH_CLASSES;
+  static const int SMOOTHING = 3;
+
+  ChromaBins chroma_bins_;
+  float silence_;              // これ未満のクロマの合計は無音とみなす
+  std::vector<float> raw_;     // 直近 SMOOTHING フレームの正規化済みクロマ
+  std::vector<float> energy_;  // フレームのエネルギー（dB）の履歴
+  float previous_[PITCH_CLASSES];
+  int frames_ = 0;
+  std::vector<uint32_t> fingerprint_;
+};
+
+#endif  // CHROMA_FINGERPRINT_H
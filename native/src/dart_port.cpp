@@ -0,0 +1,36 @@
+#include "dart_port.h"
+
+#include <atomic>
+#include <vector>
+
+#include "essentia_bridge.h"
+
+static std::atomic<EssentiaDartPostCObject> postCObject{nullptr};
+
+bool post_dart_int64_array(int64_t port, const int64_t* values, int count) {
+  EssentiaDartPostCObject post = postCObject.load(std::memory_order_acquire);
+  if (!post) return false;
+
+  std::vector<DartCObject> elements(count);
+  std::vector<DartCObject*> pointers(count);
+  for (int i = 0; i < count; i++) {
+    elements[i].type = DART_COBJECT_INT64;
+    elements[i].value.as_int64 = values[i];
+    pointers[i] = &elements[i];
+  }
+  DartCObject array;
+  array.type = DART_COBJECT_ARRAY;
+  array.value.as_array.length = count;
+  array.value.as_array.values = pointers.data();
+  return post(port, &array) != 0;
+}
+
+bool dart_post_available() { return postCObject.load(std::memory_order_acquire) != nullptr; }
+
+extern "C" {
+
+void essentia_set_dart_post_cobject(EssentiaDartPostCObject post) {
+  postCObject.store(post, std::memory_order_release);
+}
+
+}  // extern "C"
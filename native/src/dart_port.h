@@ -0,0 +1,36 @@
+#ifndef DART_PORT_H
+#define DART_PORT_H
+
+#include <stdint.h>
+
+// Dart の ReceivePort へブリッジのスレッドから結果を送る。Dart SDK のヘッダ（dart_api_dl）は
+// 持たず、Dart 側が NativeApi.postCObject で渡す Dart_PostCObject を
+// essentia_set_dart_post_cobject で受け取って使う
+// メッセージは int64 の配列だけなので、Dart_CObject もその分だけ定義する
+
+// dart_native_api.h の Dart_CObject_Type のうち使うもの
+static const int32_t DART_COBJECT_INT64 = 3;
+static const int32_t DART_COBJECT_ARRAY = 6;
+
+// dart_native_api.h の Dart_CObject と同じ並び。使わない共用体のメンバは省く
+// （Dart 側は type に応じたメンバしか読まないため、省いても各メンバの位置は変わらない）
+struct DartCObject {
+  int32_t type;  // Dart_CObject_Type（C の enum なので int 幅）
+  union {
+    int64_t as_int64;
+    struct {
+      intptr_t length;
+      DartCObject** values;
+    } as_array;
+  } value;
+};
+
+// Dart 側で List<int> として受け取れる配列を送る。Dart_PostCObject は呼び出し中に内容を
+// コピーするので、values は戻った後に解放してよい
+// post 関数が未設定か、ポートが閉じていれば false
+bool post_dart_int64_array(int64_t port, const int64_t* values, int count);
+
+// essentia_set_dart_post_cobject が呼ばれていれば true
+bool dart_post_available();
+
+#endif  // DART_PORT_H
@@ -1,12 +1,22 @@
 #include "essentia_bridge.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cstdlib>
 #include <memory>
-#include <string>
 #include <vector>
 
 #include "audio_decode.h"
 #include "essentia_lock.h"
+#include "excerpt.h"
+#include "frame_engine.h"
+#include "key_detector.h"
+#include "log_timer.h"
+#include "mix_points.h"
+#include "preview_detector.h"
+#include "tempo_estimator.h"
+#include "thread_budget.h"
+#include "track_audio.h"
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -33,137 +43,357 @@ static bool is_cancelled(EssentiaCancelFlag* flag) {
 }
 
 static const int TARGET_SAMPLE_RATE = 44100;
+// 種類ごとに返すミックスポイントの最大数
+static const int MAX_MIX_POINTS_PER_KIND = 3;
+// プレビュー区間の長さ（4/4 で 8 小節）
+static const int PREVIEW_BEATS = 32;
+
+static const EssentiaAnalysisOptions DEFAULT_OPTIONS = {
+    ESSENTIA_TEMPO_PRECISE, ESSENTIA_KEY_PROFILE_BGATE, 0, (float)DEFAULT_EXCERPT_SECONDS, 1.5f,
+    0.5f, 0.28f};
+
+// 解析対象の音声区間。全曲なら start_sec = 0 の 1 区間（TrackAudio の共有バッファを指す）
+struct AudioSegment {
+  double start_sec;
+  const std::vector<float>* audio;
+};
 
-extern "C" {
+// EssentiaResult に入らない解析結果
+struct AnalysisDetail {
+  std::vector<Real> ticks;      // 拍位置（曲頭からの秒）
+  std::vector<Real> estimates;  // BPM 候補
+  EssentiaKeyEstimate profile_keys[ESSENTIA_KEY_PROFILE_COUNT];
+  std::vector<EssentiaMixPoint> mix_points;
+  float energy = -1;
+  float preview_start_sec = -1;
+  float preview_end_sec = -1;
+  float preview_score = 0;
+  double analyzed_seconds = 0;
+  bool escalated = false;
+};
 
-EssentiaCancelFlag* essentia_cancel_flag_create(void) { return new EssentiaCancelFlag(); }
+// 戻り値は EssentiaResult::error_code と同じ体系
+static int estimate_tempo(const std::vector<float>& audio, int tempo_mode, TempoEstimate& out,
+                          EssentiaCancelFlag* cancel_flag) {
+  if (tempo_mode == ESSENTIA_TEMPO_FAST) {
+    return estimate_tempo_fast(audio, TARGET_SAMPLE_RATE, out, cancel_flag) != 0 ? 1 : 0;
+  }
 
-void essentia_cancel_flag_set(EssentiaCancelFlag* flag) {
-  if (flag) {
-    flag->cancelled.store(true, std::memory_order_release);
+  try {
+    std::vector<Real> bpmIntervals;
+
+    std::unique_ptr<Algorithm> rhythm(
+        AlgorithmFactory::instance().create("RhythmExtractor2013"));
+    rhythm->input("signal").set(audio);
+    rhythm->output("bpm").set(out.bpm);
+    rhythm->output("ticks").set(out.ticks);
+    rhythm->output("confidence").set(out.confidence);
+    rhythm->output("estimates").set(out.estimates);
+    rhythm->output("bpmIntervals").set(bpmIntervals);
+    rhythm->compute();
+  } catch (const std::exception& e) {
+    LOGE("Rhythm analysis error: %s", e.what());
+    return 3;
   }
+  return 0;
 }
 
-int essentia_cancel_flag_is_set(EssentiaCancelFlag* flag) { return is_cancelled(flag) ? 1 : 0; }
+// テンポは区間ごとに求めて最も信頼度の高い区間の値を採用し、拍は全区間分を曲の時刻で返す
+// 調は全区間のフレームから HPCP を 1 回だけ累積し、全プロファイルで採点する
+// ミックスポイントは調と同じフレームから求め、全曲を 1 区間で解析したときだけ返す
+static EssentiaResult analyze_segments(const std::vector<AudioSegment>& segments,
+                                       const EssentiaAnalysisOptions& options,
+                                       AnalysisDetail& detail, EssentiaCancelFlag* cancel_flag) {
+  EssentiaResult result = {};
+  result.key_note = -1;
+  result.key_scale = -1;
 
-void essentia_cancel_flag_destroy(EssentiaCancelFlag* flag) { delete flag; }
+  detail.ticks.clear();
+  detail.estimates.clear();
+  detail.mix_points.clear();
+  detail.analyzed_seconds = 0;
+
+  LogTimer tempo_timer;
+  result.bpm_confidence = -1;
+  for (const AudioSegment& segment : segments) {
+    TempoEstimate tempo;
+    int tempo_ret = estimate_tempo(*segment.audio, options.tempo_mode, tempo, cancel_flag);
+    if (tempo_ret != 0) {
+      result.error_code = tempo_ret;
+      return result;
+    }
+    if (tempo.confidence > result.bpm_confidence) {
+      result.bpm = tempo.bpm;
+      result.bpm_confidence = tempo.confidence;
+      detail.estimates.assign(tempo.estimates.begin(), tempo.estimates.end());
+    }
+    for (float tick : tempo.ticks) {
+      detail.ticks.push_back((Real)(segment.start_sec + tick));
+    }
+    detail.analyzed_seconds += (double)segment.audio->size() / TARGET_SAMPLE_RATE;
 
-void essentia_init(void) {
-  std::lock_guard<std::mutex> essentiaGuard(essentiaGlobalMutex());
-  essentia::init();
-}
+    if (is_cancelled(cancel_flag)) {
+      result.error_code = 1;
+      return result;
+    }
+  }
+  LOGI("BPM: %.1f (confidence: %.2f, %zu beats, %s, %.0f ms)", result.bpm,
+       result.bpm_confidence, detail.ticks.size(),
+       options.tempo_mode == ESSENTIA_TEMPO_FAST ? "fast" : "precise", tempo_timer.elapsed_ms());
 
-void essentia_shutdown(void) {
-  std::lock_guard<std::mutex> essentiaGuard(essentiaGlobalMutex());
-  essentia::shutdown();
-}
+  LogTimer key_timer;
+  try {
+    KeyDetector keyDetector(TARGET_SAMPLE_RATE);
+    MixPointDetector mixDetector(TARGET_SAMPLE_RATE);
+    PreviewDetector previewDetector(TARGET_SAMPLE_RATE);
+    FrameEngine engine(TARGET_SAMPLE_RATE);
+    engine.add_consumer(KeyDetector::FRAME_SIZE, KeyDetector::HOP_SIZE, &keyDetector);
+    engine.add_consumer(MixPointDetector::FRAME_SIZE, MixPointDetector::HOP_SIZE, &mixDetector);
+    engine.add_consumer(PreviewDetector::FRAME_SIZE, PreviewDetector::HOP_SIZE, &previewDetector);
+    for (const AudioSegment& segment : segments) {
+      if (engine.run(*segment.audio, cancel_flag) != 0) {
+        result.error_code = 1;
+        return result;
+      }
+    }
 
-EssentiaResult essentia_analyze(const char* path, EssentiaCancelFlag* cancel_flag) {
-  std::lock_guard<std::mutex> essentiaGuard(essentiaGlobalMutex());
+    keyDetector.estimate(detail.profile_keys);
 
-  EssentiaResult result = {};
-  result.key_note = -1;
-  result.key_scale = -1;
+    detail.energy = mixDetector.energy();
+    if (segments.size() == 1 && segments[0].start_sec == 0) {
+      mixDetector.detect(detail.ticks, MAX_MIX_POINTS_PER_KIND, detail.mix_points);
+      previewDetector.detect(detail.ticks, PREVIEW_BEATS, &detail.preview_start_sec,
+                             &detail.preview_end_sec, &detail.preview_score);
+    }
 
-  LOGI("Loading: %s", path);
-  std::vector<float> audio;
-  int decode_ret = decode_audio(path, audio, TARGET_SAMPLE_RATE, cancel_flag);
-  if (decode_ret < 0) {
-    result.error_code = 2;
+    int profile = options.key_profile;
+    if (profile < 0 || profile >= ESSENTIA_KEY_PROFILE_COUNT) profile = ESSENTIA_KEY_PROFILE_BGATE;
+    result.key_note = detail.profile_keys[profile].key_note;
+    result.key_scale = detail.profile_keys[profile].key_scale;
+    result.key_confidence = detail.profile_keys[profile].strength;
+  } catch (const std::exception& e) {
+    LOGE("Key analysis error: %s", e.what());
+    result.error_code = 3;
     return result;
   }
-  if (decode_ret == 1 || is_cancelled(cancel_flag)) {
+  LOGI("Key: note=%d scale=%d (strength: %.2f, profile %d, %.0f ms), energy %.2f, %zu mix points, "
+       "preview %.1f s (%.2f)",
+       result.key_note, result.key_scale, result.key_confidence, options.key_profile,
+       key_timer.elapsed_ms(), detail.energy, detail.mix_points.size(), detail.preview_start_sec,
+       detail.preview_score);
+
+  if (is_cancelled(cancel_flag)) {
     result.error_code = 1;
     return result;
   }
-  LOGI("Decoded %zu samples (%.1f seconds)", audio.size(),
-       (float)audio.size() / TARGET_SAMPLE_RATE);
 
-  if (audio.empty()) {
-    LOGE("No audio samples decoded");
-    result.error_code = 2;
-    return result;
+  result.error_code = 0;
+  return result;
+}
+
+// 抜粋区間の音声。segments は buffers を指す
+struct ExcerptAudio {
+  std::vector<std::vector<float> > buffers;
+  std::vector<AudioSegment> segments;
+};
+
+// 抜粋区間を選んでデコードする。FFmpeg だけで済むため Essentia のロックは取らない
+// 0 = 成功、1 = キャンセル、-1 = 抜粋できない曲か区間の復号に失敗（全曲を解析する）
+static int decode_excerpt(const char* path, const EssentiaAnalysisOptions& options,
+                          ExcerptAudio& excerpt, EssentiaCancelFlag* cancel_flag) {
+  double excerpt_seconds =
+      options.excerpt_seconds > 0 ? options.excerpt_seconds : DEFAULT_EXCERPT_SECONDS;
+  std::vector<ExcerptWindow> windows = select_excerpt_windows(path, excerpt_seconds, cancel_flag);
+  if (is_cancelled(cancel_flag)) return 1;
+  if (windows.empty()) return -1;
+
+  excerpt.buffers.resize(windows.size());
+  excerpt.segments.resize(windows.size());
+  for (size_t w = 0; w < windows.size(); w++) {
+    int decode_ret = decode_audio_range(path, windows[w].start_sec, windows[w].duration_sec,
+                                        TARGET_SAMPLE_RATE, 1, excerpt.buffers[w],
+                                        &excerpt.segments[w].start_sec, cancel_flag);
+    if (decode_ret == 1) return 1;
+    if (decode_ret < 0) return -1;
+    excerpt.segments[w].audio = &excerpt.buffers[w];
+  }
+  return 0;
+}
+
+// デコード済みの抜粋区間を解析し、信頼度が閾値を満たせばその結果を返す
+// 閾値に届かなければ false を返し、呼び出し側が全曲を解析する
+static bool run_excerpt_analysis(const ExcerptAudio& excerpt,
+                                 const EssentiaAnalysisOptions& options, AnalysisDetail& detail,
+                                 EssentiaResult& result, EssentiaCancelFlag* cancel_flag) {
+  result = analyze_segments(excerpt.segments, options, detail, cancel_flag);
+  if (result.error_code != 0) return true;
+
+  const float min_bpm_confidence = options.tempo_mode == ESSENTIA_TEMPO_FAST
+                                       ? options.min_fast_bpm_confidence
+                                       : options.min_bpm_confidence;
+  if (result.bpm_confidence >= min_bpm_confidence &&
+      result.key_confidence >= options.min_key_confidence) {
+    return true;
   }
 
-  AlgorithmFactory& factory = AlgorithmFactory::instance();
+  LOGI("Excerpt below thresholds (bpm %.2f, key %.2f), analyzing full track",
+       result.bpm_confidence, result.key_confidence);
+  detail.escalated = true;
+  return false;
+}
 
-  if (is_cancelled(cancel_flag)) {
+static EssentiaResult run_analysis(TrackAudio& audio, const EssentiaAnalysisOptions& options,
+                                   AnalysisDetail& detail, EssentiaCancelFlag* cancel_flag) {
+  ThreadBudgetGuard budgetGuard(1);
+
+  EssentiaResult result = {};
+  result.key_note = -1;
+  result.key_scale = -1;
+
+  LOGI("Loading: %s", audio.path());
+  ExcerptAudio excerpt;
+  int excerpt_ret =
+      options.excerpt_mode ? decode_excerpt(audio.path(), options, excerpt, cancel_flag) : -1;
+  if (excerpt_ret == 1) {
     result.error_code = 1;
     return result;
   }
 
-  try {
-    Real bpm = 0;
-    std::vector<Real> ticks;
-    Real confidence = 0;
-    std::vector<Real> estimates;
-    std::vector<Real> bpmIntervals;
-
-    std::unique_ptr<Algorithm> rhythm(factory.create("RhythmExtractor2013"));
-    rhythm->input("signal").set(audio);
-    rhythm->output("bpm").set(bpm);
-    rhythm->output("ticks").set(ticks);
-    rhythm->output("confidence").set(confidence);
-    rhythm->output("estimates").set(estimates);
-    rhythm->output("bpmIntervals").set(bpmIntervals);
-    rhythm->compute();
-
-    result.bpm = bpm;
-    result.bpm_confidence = confidence;
-    LOGI("BPM: %.1f (confidence: %.2f)", bpm, confidence);
-  } catch (const std::exception& e) {
-    LOGE("Rhythm analysis error: %s", e.what());
-    result.error_code = 3;
+  std::lock_guard<std::mutex> essentiaGuard(essentiaGlobalMutex());
+  if (excerpt_ret == 0 && run_excerpt_analysis(excerpt, options, detail, result, cancel_flag)) {
     return result;
   }
 
-  if (is_cancelled(cancel_flag)) {
-    result.error_code = 1;
+  std::vector<AudioSegment> segments(1);
+  segments[0].start_sec = 0;
+  int decode_ret = audio.mono(TARGET_SAMPLE_RATE, &segments[0].audio);
+  if (decode_ret == 0 && is_cancelled(cancel_flag)) decode_ret = 1;
+  if (decode_ret != 0) {
+    result.error_code = decode_ret;
     return result;
   }
+  LOGI("Decoded %zu samples (%.1f seconds)", segments[0].audio->size(),
+       (float)segments[0].audio->size() / TARGET_SAMPLE_RATE);
 
-  try {
-    std::string key_str;
-    std::string scale_str;
-    Real strength = 0;
-
-    std::unique_ptr<Algorithm> keyExtractor(factory.create("KeyExtractor"));
-    keyExtractor->input("audio").set(audio);
-    keyExtractor->output("key").set(key_str);
-    keyExtractor->output("scale").set(scale_str);
-    keyExtractor->output("strength").set(strength);
-    keyExtractor->compute();
-
-    static const char* note_names[] = {"C",  "C#", "D",  "Eb", "E",  "F",
-                                       "F#", "G",  "Ab", "A",  "Bb", "B"};
-    static const char* note_names_alt[] = {"",   "Db", "",   "D#", "",   "",
-                                           "Gb", "",   "G#", "",   "A#", "Cb"};
-
-    result.key_note = -1;
-    for (int i = 0; i < 12; i++) {
-      if (key_str == note_names[i] ||
-          (note_names_alt[i][0] != '\0' && key_str == note_names_alt[i])) {
-        result.key_note = static_cast<int8_t>(i);
-        break;
-      }
+  return analyze_segments(segments, options, detail, cancel_flag);
+}
+
+EssentiaAnalysis* analyze_track_tempo_key(TrackAudio& audio, const EssentiaAnalysisOptions* options,
+                                          EssentiaCancelFlag* cancel_flag) {
+  EssentiaAnalysis* analysis = (EssentiaAnalysis*)malloc(sizeof(EssentiaAnalysis));
+  if (!analysis) return nullptr;
+
+  analysis->beat_ticks = nullptr;
+  analysis->num_beats = 0;
+  analysis->bpm_estimates = nullptr;
+  analysis->num_bpm_estimates = 0;
+  analysis->analyzed_seconds = 0;
+  analysis->escalated = 0;
+  analysis->mix_points = nullptr;
+  analysis->num_mix_points = 0;
+  analysis->energy = -1;
+  analysis->preview_start_sec = -1;
+  analysis->preview_end_sec = -1;
+  analysis->preview_score = 0;
+
+  AnalysisDetail detail;
+  for (EssentiaKeyEstimate& key : detail.profile_keys) {
+    key.key_note = -1;
+    key.key_scale = 0;
+    key.strength = 0;
+  }
+  analysis->result =
+      run_analysis(audio, options ? *options : DEFAULT_OPTIONS, detail, cancel_flag);
+  std::copy(detail.profile_keys, detail.profile_keys + ESSENTIA_KEY_PROFILE_COUNT,
+            analysis->profile_keys);
+  analysis->analyzed_seconds = (float)detail.analyzed_seconds;
+  analysis->escalated = detail.escalated ? 1 : 0;
+  analysis->energy = detail.energy;
+  analysis->preview_start_sec = detail.preview_start_sec;
+  analysis->preview_end_sec = detail.preview_end_sec;
+  analysis->preview_score = detail.preview_score;
+  if (analysis->result.error_code != 0) return analysis;
+
+  const std::vector<Real>& ticks = detail.ticks;
+  const std::vector<Real>& estimates = detail.estimates;
+  if (!ticks.empty()) {
+    analysis->beat_ticks = (float*)malloc(sizeof(float) * ticks.size());
+    if (!analysis->beat_ticks) {
+      analysis->result.error_code = 3;
+      return analysis;
     }
+    std::copy(ticks.begin(), ticks.end(), analysis->beat_ticks);
+    analysis->num_beats = (int32_t)ticks.size();
+  }
 
-    result.key_scale = (scale_str == "minor") ? 1 : 0;
-    result.key_confidence = strength;
-    LOGI("Key: %s %s (strength: %.2f)", key_str.c_str(), scale_str.c_str(), strength);
-  } catch (const std::exception& e) {
-    LOGE("Key analysis error: %s", e.what());
-    result.error_code = 3;
-    return result;
+  if (!estimates.empty()) {
+    analysis->bpm_estimates = (float*)malloc(sizeof(float) * estimates.size());
+    if (!analysis->bpm_estimates) {
+      analysis->result.error_code = 3;
+      return analysis;
+    }
+    std::copy(estimates.begin(), estimates.end(), analysis->bpm_estimates);
+    analysis->num_bpm_estimates = (int32_t)estimates.size();
   }
 
-  if (is_cancelled(cancel_flag)) {
-    result.error_code = 1;
-    return result;
+  const std::vector<EssentiaMixPoint>& mixPoints = detail.mix_points;
+  if (!mixPoints.empty()) {
+    analysis->mix_points = (EssentiaMixPoint*)malloc(sizeof(EssentiaMixPoint) * mixPoints.size());
+    if (!analysis->mix_points) {
+      analysis->result.error_code = 3;
+      return analysis;
+    }
+    std::copy(mixPoints.begin(), mixPoints.end(), analysis->mix_points);
+    analysis->num_mix_points = (int32_t)mixPoints.size();
   }
 
-  result.error_code = 0;
-  return result;
+  return analysis;
+}
+
+extern "C" {
+
+EssentiaCancelFlag* essentia_cancel_flag_create(void) { return new EssentiaCancelFlag(); }
+
+void essentia_cancel_flag_set(EssentiaCancelFlag* flag) {
+  if (flag) {
+    flag->cancelled.store(true, std::memory_order_release);
+  }
+}
+
+int essentia_cancel_flag_is_set(EssentiaCancelFlag* flag) { return is_cancelled(flag) ? 1 : 0; }
+
+void essentia_cancel_flag_destroy(EssentiaCancelFlag* flag) { delete flag; }
+
+void essentia_init(void) {
+  std::lock_guard<std::mutex> essentiaGuard(essentiaGlobalMutex());
+  essentia::init();
+}
+
+void essentia_shutdown(void) {
+  std::lock_guard<std::mutex> essentiaGuard(essentiaGlobalMutex());
+  essentia::shutdown();
+}
+
+EssentiaResult essentia_analyze(const char* path, EssentiaCancelFlag* cancel_flag) {
+  TrackAudio audio(path, cancel_flag);
+  AnalysisDetail detail;
+  return run_analysis(audio, DEFAULT_OPTIONS, detail, cancel_flag);
+}
+
+EssentiaAnalysis* essentia_analyze_detailed(const char* path,
+                                            const EssentiaAnalysisOptions* options,
+                                            EssentiaCancelFlag* cancel_flag) {
+  TrackAudio audio(path, cancel_flag);
+  return analyze_track_tempo_key(audio, options, cancel_flag);
+}
+
+void essentia_free_analysis(EssentiaAnalysis* analysis) {
+  if (analysis) {
+    free(analysis->beat_ticks);
+    free(analysis->bpm_estimates);
+    free(analysis->mix_points);
+    free(analysis);
+  }
 }
 
 }  // extern "C"
@@ -9,13 +9,73 @@ extern "C" {
 
 typedef struct {
   float bpm;
-  float bpm_confidence;
+  float bpm_confidence;  // precise: RhythmExtractor2013's 0..5.32, fast: 0..1 (see tempo_mode)
   int8_t key_note;   // 0-11 (C=0...B=11), -1 = unknown
   int8_t key_scale;  // 0=major, 1=minor
   float key_confidence;
   int32_t error_code;  // 0=success, 1=cancelled, 2=decode error, 3=analysis error
 } EssentiaResult;
 
+// Key profiles scored by the key detector, usable as EssentiaKeyEstimate array indices.
+#define ESSENTIA_KEY_PROFILE_BGATE 0
+#define ESSENTIA_KEY_PROFILE_EDMA 1
+#define ESSENTIA_KEY_PROFILE_TEMPERLEY 2
+#define ESSENTIA_KEY_PROFILE_COUNT 3
+
+typedef struct {
+  int8_t key_note;   // 0-11 (C=0...B=11), -1 = unknown
+  int8_t key_scale;  // 0=major, 1=minor
+  float strength;    // correlation with the profile, -1..1
+} EssentiaKeyEstimate;
+
+// kind values for EssentiaMixPoint.
+#define ESSENTIA_MIX_IN 0   // where to start the next track while the previous one plays out
+#define ESSENTIA_MIX_OUT 1  // where to start fading this track into the next one
+
+typedef struct {
+  float start_sec;       // phrase boundary on the beat grid
+  float end_sec;         // phrase_beats beats later
+  int32_t kind;          // ESSENTIA_MIX_*
+  int32_t phrase_beats;  // 16 or 32
+  float score;           // higher is better; comparable between points of one track
+} EssentiaMixPoint;
+
+typedef struct {
+  EssentiaResult result;
+  float* beat_ticks;  // numBeats beat positions in seconds (heap-allocated)
+  int32_t num_beats;
+  float* bpm_estimates;  // numBpmEstimates candidate tempos (heap-allocated)
+  int32_t num_bpm_estimates;
+  EssentiaKeyEstimate profile_keys[ESSENTIA_KEY_PROFILE_COUNT];  // every profile, one HPCP pass
+  float analyzed_seconds;  // audio actually analyzed (excerpt windows or the whole track)
+  int32_t escalated;       // 1 when the excerpt fell below the thresholds and the track was redone
+  // Ranked mix-in points followed by ranked mix-out points, aligned to 16-beat phrases. Only
+  // produced when the whole track was analyzed (none for an excerpt result).
+  EssentiaMixPoint* mix_points;  // numMixPoints entries (heap-allocated)
+  int32_t num_mix_points;
+  float energy;  // 0..1 relative intensity from spectral flux, -1 = unknown
+  // Most repeated loud section (chorus) to use as a preview, found from beat-synchronous
+  // chroma/timbre self-similarity. Only for whole-track analysis; -1 = none.
+  float preview_start_sec;
+  float preview_end_sec;
+  float preview_score;  // 0..1 repetition weighted by loudness, 0 = none
+} EssentiaAnalysis;
+
+// tempo_mode values for EssentiaAnalysisOptions.
+#define ESSENTIA_TEMPO_PRECISE 0  // RhythmExtractor2013 (multifeature) on 44.1 kHz audio
+#define ESSENTIA_TEMPO_FAST 1     // onset-envelope autocorrelation on ~11 kHz audio
+
+typedef struct {
+  int32_t tempo_mode;   // ESSENTIA_TEMPO_*
+  int32_t key_profile;  // ESSENTIA_KEY_PROFILE_* reported in EssentiaResult
+  int32_t excerpt_mode;      // 1 = analyze the middle and loudest windows instead of the track
+  float excerpt_seconds;     // total length of the excerpt windows (<= 0 = 45 s)
+  float min_bpm_confidence;  // escalate to the full track below this bpm_confidence (0..5.32)
+  float min_key_confidence;  // escalate to the full track below this key_confidence (-1..1)
+  // min_bpm_confidence for ESSENTIA_TEMPO_FAST, whose bpm_confidence is on a 0..1 scale
+  float min_fast_bpm_confidence;
+} EssentiaAnalysisOptions;
+
 typedef struct EssentiaCancelFlag EssentiaCancelFlag;
 
 EssentiaCancelFlag* essentia_cancel_flag_create(void);
@@ -23,11 +83,30 @@ void essentia_cancel_flag_set(EssentiaCancelFlag* flag);
 int essentia_cancel_flag_is_set(EssentiaCancelFlag* flag);
 void essentia_cancel_flag_destroy(EssentiaCancelFlag* flag);
 
+// Caps the threads the bridge runs at once (0 = number of cores). ORT uses one process-wide
+// intra-op pool of ort_intra_op_threads (0 = max_threads - 1); set before the first style call.
+void essentia_set_thread_budget(int32_t max_threads, int32_t ort_intra_op_threads,
+                                int32_t ort_inter_op_threads);
+
+// Dart_PostCObject, passed from Dart as NativeApi.postCObject. Lets the *_async functions post
+// results to a Dart ReceivePort from bridge threads without building against the Dart SDK.
+typedef int8_t (*EssentiaDartPostCObject)(int64_t port, void* message);
+
+void essentia_set_dart_post_cobject(EssentiaDartPostCObject post);
+
 void essentia_init(void);
 void essentia_shutdown(void);
 
 EssentiaResult essentia_analyze(const char* path, EssentiaCancelFlag* cancel_flag);
 
+// Same analysis as essentia_analyze, additionally returning the beat grid.
+// options may be NULL for the defaults (precise tempo, bgate key profile, full track).
+EssentiaAnalysis* essentia_analyze_detailed(const char* path,
+                                            const EssentiaAnalysisOptions* options,
+                                            EssentiaCancelFlag* cancel_flag);
+
+void essentia_free_analysis(EssentiaAnalysis* analysis);
+
 #ifdef __cplusplus
 }
 #endif
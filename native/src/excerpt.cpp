@@ -0,0 +1,73 @@
+#include "excerpt.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "audio_decode.h"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "Excerpt"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGI(...)
+#endif
+
+static const int EXCERPT_WINDOWS = 3;
+static const double PROBE_SECONDS = 3.0;
+static const int PROBE_SR = 11025;
+
+// 中央（0.5）以外の候補位置。イントロとアウトロは避ける
+static const double CANDIDATE_POSITIONS[] = {0.2, 0.35, 0.65, 0.8};
+
+std::vector<ExcerptWindow> select_excerpt_windows(const char* path, double excerpt_seconds,
+                                                  EssentiaCancelFlag* cancel_flag) {
+  std::vector<ExcerptWindow> windows;
+
+  double total = probe_audio_duration(path);
+  if (total <= 0 || total < excerpt_seconds * 2) return windows;
+
+  const double length = excerpt_seconds / EXCERPT_WINDOWS;
+  auto window_at = [total, length](double position) {
+    double start = std::max(0.0, std::min(total - length, position * total - length * 0.5));
+    return ExcerptWindow{start, length};
+  };
+
+  std::vector<std::pair<float, double> > energies;
+  for (double position : CANDIDATE_POSITIONS) {
+    if (essentia_cancel_flag_is_set(cancel_flag)) return std::vector<ExcerptWindow>();
+
+    std::vector<float> probe;
+    double probe_start = position * total - PROBE_SECONDS * 0.5;
+    if (decode_audio_range(path, probe_start, PROBE_SECONDS, PROBE_SR, 1, probe, nullptr,
+                           cancel_flag) != 0 ||
+        probe.empty()) {
+      continue;
+    }
+    double sum = 0;
+    for (float s : probe) sum += (double)s * s;
+    energies.push_back(std::make_pair((float)std::sqrt(sum / probe.size()), position));
+  }
+  std::sort(energies.begin(), energies.end(),
+            [](const std::pair<float, double>& a, const std::pair<float, double>& b) {
+              return a.first > b.first;
+            });
+
+  // 短い曲では候補どうしが重なるため、選んだ区間と重なる候補は飛ばす
+  // （重なったまま解析すると同じ拍が二重に、順序が前後して並ぶ）
+  windows.push_back(window_at(0.5));
+  for (size_t i = 0; i < energies.size() && (int)windows.size() < EXCERPT_WINDOWS; i++) {
+    ExcerptWindow candidate = window_at(energies[i].second);
+    bool overlaps = std::any_of(windows.begin(), windows.end(), [&](const ExcerptWindow& w) {
+      return candidate.start_sec < w.start_sec + w.duration_sec &&
+             w.start_sec < candidate.start_sec + candidate.duration_sec;
+    });
+    if (!overlaps) windows.push_back(candidate);
+  }
+  std::sort(windows.begin(), windows.end(), [](const ExcerptWindow& a, const ExcerptWindow& b) {
+    return a.start_sec < b.start_sec;
+  });
+
+  LOGI("Excerpt: %zu windows of %.1f s from %.1f s track", windows.size(), length, total);
+  return windows;
+}
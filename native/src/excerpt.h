@@ -0,0 +1,21 @@
+#ifndef EXCERPT_H
+#define EXCERPT_H
+
+#include <vector>
+
+#include "essentia_bridge.h"
+
+static const double DEFAULT_EXCERPT_SECONDS = 45.0;
+
+struct ExcerptWindow {
+  double start_sec;
+  double duration_sec;
+};
+
+// 全曲の代わりに解析する区間を合計 excerpt_seconds 分まで選ぶ（開始位置順で互いに重ならない）
+// 中央の区間を必ず含め、残りは短いプローブで RMS が大きかった候補位置から選ぶ
+// 曲が短く抜粋しても得がない場合や曲長が取れない場合は空を返す（全曲を解析する）
+std::vector<ExcerptWindow> select_excerpt_windows(const char* path, double excerpt_seconds,
+                                                  EssentiaCancelFlag* cancel_flag);
+
+#endif  // EXCERPT_H
@@ -0,0 +1,154 @@
+#include "fingerprint_index.h"
+
+#include <algorithm>
+#include <functional>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include "chroma_fingerprint.h"
+
+// この数未満の票しか集まらなかった位置ずれは照合しない
+static const int MIN_VOTES = 3;
+// 照合する候補の上限（票の多い順）
+static const size_t MAX_VERIFY = 256;
+// 多くの曲に現れるキーは手掛かりにならないため、これを超える投稿リストは読まない
+static const size_t MIN_STOP_POSTINGS = 256;
+// 重なりが短い方の半分未満、またはこのフレーム数未満の一致は採らない
+static const int MIN_OVERLAP_FRAMES = 8;
+
+struct Posting {
+  int32_t slot;
+  int32_t position;
+};
+
+struct EssentiaFingerprintIndex {
+  std::unordered_map<uint32_t, std::vector<Posting> > postings;
+  std::vector<int32_t> ids;
+  std::vector<std::vector<uint32_t> > fingerprints;
+};
+
+// 位置ずれ offset（格納側 = クエリ側 + offset）で重なるフレームのビット一致率
+// 無音のフレームは数えない。重なりが足りなければ負を返す
+static float aligned_similarity(const uint32_t* query, int query_length,
+                                const std::vector<uint32_t>& stored, int offset) {
+  const int storedLength = (int)stored.size();
+  const int begin = std::max(0, -offset);
+  const int end = std::min(query_length, storedLength - offset);
+  const int minOverlap =
+      std::max(MIN_OVERLAP_FRAMES, std::min(query_length, storedLength) / 2);
+
+  int frames = 0, differing = 0;
+  for (int q = begin; q < end; q++) {
+    const uint32_t a = query[q], b = stored[q + offset];
+    if (a == 0 || b == 0) continue;
+    differing += __builtin_popcount(a ^ b);
+    frames++;
+  }
+  if (frames < minOverlap) return -1.0f;
+  return 1.0f - (float)differing / (32.0f * frames);
+}
+
+extern "C" {
+
+EssentiaFingerprintIndex* essentia_fingerprint_index_create(void) {
+  return new (std::nothrow) EssentiaFingerprintIndex();
+}
+
+int32_t essentia_fingerprint_index_add(EssentiaFingerprintIndex* index, int32_t id,
+                                       const uint32_t* fingerprint, int32_t length) {
+  if (!index || (!fingerprint && length > 0)) return 3;
+  const size_t n = length > 0 ? (size_t)length : 0;
+  try {
+    const int32_t slot = (int32_t)index->ids.size();
+    index->fingerprints.emplace_back(fingerprint, fingerprint + n);
+    index->ids.push_back(id);
+
+    // 伸ばした音では同じキーが続くため、直前のフレームと同じキーは登録しない
+    uint32_t previous = 0;
+    for (size_t p = 0; p < n; p++) {
+      if (fingerprint[p] == 0) continue;
+      const uint32_t key = fingerprint[p] & ChromaFingerprinter::KEY_MASK;
+      if (key == previous) continue;
+      previous = key;
+      index->postings[key].push_back(Posting{slot, (int32_t)p});
+    }
+  } catch (const std::bad_alloc&) {
+    return 3;
+  }
+  return 0;
+}
+
+int32_t essentia_fingerprint_index_query(const EssentiaFingerprintIndex* index,
+                                         const uint32_t* fingerprint, int32_t length,
+                                         float min_similarity, EssentiaFingerprintMatch* out,
+                                         int32_t max_results) {
+  if (!index || !fingerprint || length <= 0 || !out || max_results <= 0) return 0;
+
+  const size_t stopPostings = std::max(MIN_STOP_POSTINGS, index->ids.size() / 4);
+  std::unordered_map<uint64_t, int> votes;
+  uint32_t previous = 0;
+  for (int32_t q = 0; q < length; q++) {
+    if (fingerprint[q] == 0) continue;
+    const uint32_t key = fingerprint[q] & ChromaFingerprinter::KEY_MASK;
+    if (key == previous) continue;
+    previous = key;
+    auto it = index->postings.find(key);
+    if (it == index->postings.end() || it->second.size() > stopPostings) continue;
+    for (const Posting& posting : it->second) {
+      const uint32_t offset = (uint32_t)(posting.position - q);
+      votes[((uint64_t)posting.slot << 32) | offset]++;
+    }
+  }
+
+  // 曲ごとに最も票の多い位置ずれだけを残す
+  std::unordered_map<int32_t, std::pair<int, int32_t> > best;
+  for (const auto& entry : votes) {
+    if (entry.second < MIN_VOTES) continue;
+    const int32_t slot = (int32_t)(entry.first >> 32);
+    const int32_t offset = (int32_t)(uint32_t)entry.first;
+    auto it = best.find(slot);
+    if (it == best.end() || entry.second > it->second.first) {
+      best[slot] = std::make_pair(entry.second, offset);
+    }
+  }
+
+  std::vector<std::pair<int, int32_t> > candidates;  // (票, slot)
+  for (const auto& entry : best) {
+    candidates.push_back(std::make_pair(entry.second.first, entry.first));
+  }
+  std::sort(candidates.begin(), candidates.end(), std::greater<std::pair<int, int32_t> >());
+  if (candidates.size() > MAX_VERIFY) candidates.resize(MAX_VERIFY);
+
+  // 票はキーの一致だけなので全ビットで照合し直す。ホップ未満のずれに備えて前後 1 フレームも試す
+  std::vector<EssentiaFingerprintMatch> matches;
+  for (const auto& candidate : candidates) {
+    const int32_t slot = candidate.second;
+    const int32_t offset = best[slot].second;
+    float similarity = -1.0f;
+    int32_t bestOffset = offset;
+    for (int d = -1; d <= 1; d++) {
+      const float s =
+          aligned_similarity(fingerprint, length, index->fingerprints[slot], offset + d);
+      if (s > similarity) {
+        similarity = s;
+        bestOffset = offset + d;
+      }
+    }
+    if (similarity < min_similarity) continue;
+    matches.push_back(EssentiaFingerprintMatch{index->ids[slot], similarity,
+                                               bestOffset * ESSENTIA_FINGERPRINT_STEP_SEC});
+  }
+
+  std::sort(matches.begin(), matches.end(),
+            [](const EssentiaFingerprintMatch& a, const EssentiaFingerprintMatch& b) {
+              return a.similarity > b.similarity || (a.similarity == b.similarity && a.id < b.id);
+            });
+  const int32_t written = std::min<int32_t>(max_results, (int32_t)matches.size());
+  std::copy(matches.begin(), matches.begin() + written, out);
+  return written;
+}
+
+void essentia_fingerprint_index_destroy(EssentiaFingerprintIndex* index) { delete index; }
+
+}  // extern "C"
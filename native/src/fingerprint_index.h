@@ -0,0 +1,44 @@
+#ifndef FINGERPRINT_INDEX_H
+#define FINGERPRINT_INDEX_H
+
+#include "essentia_bridge.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Duration of one sub-fingerprint step (1365 samples at 11025 Hz).
+#define ESSENTIA_FINGERPRINT_STEP_SEC (1365.0f / 11025.0f)
+
+typedef struct EssentiaFingerprintIndex EssentiaFingerprintIndex;
+
+typedef struct {
+  int32_t id;        // id passed to essentia_fingerprint_index_add
+  float similarity;  // share of matching bits over the aligned overlap, 0.5 = unrelated
+  float offset_sec;  // query time t lines up with time t + offset_sec of the match
+} EssentiaFingerprintMatch;
+
+// Inverted index over chroma fingerprints (as produced by essentia_analyze_gain_batch) for
+// finding the same recording under different files. Each stable part of a sub-fingerprint
+// is a key; a query only visits the postings of its own keys, votes for (id, time offset)
+// pairs and verifies the best-voted alignments bit by bit. Not synchronized.
+EssentiaFingerprintIndex* essentia_fingerprint_index_create(void);
+
+// Adds a fingerprint of length sub-fingerprints under id. Returns 0, or 3 when out of memory.
+int32_t essentia_fingerprint_index_add(EssentiaFingerprintIndex* index, int32_t id,
+                                       const uint32_t* fingerprint, int32_t length);
+
+// Writes up to max_results matches with similarity >= min_similarity to out, most similar
+// first, and returns how many were written. A query that was added itself matches its own id.
+int32_t essentia_fingerprint_index_query(const EssentiaFingerprintIndex* index,
+                                         const uint32_t* fingerprint, int32_t length,
+                                         float min_similarity, EssentiaFingerprintMatch* out,
+                                         int32_t max_results);
+
+void essentia_fingerprint_index_destroy(EssentiaFingerprintIndex* index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FINGERPRINT_INDEX_H
@@ -0,0 +1,114 @@
+#include "frame_engine.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <unsupported/Eigen/FFT>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "FrameEngine"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGI(...)
+#endif
+
+struct FrameEngine::Resolution {
+  int frame_size;
+  int hop_size = 0;  // 登録されたホップの最大公約数
+  std::vector<Subscription> subscriptions;
+  std::vector<float> window;
+  std::vector<float> frame;
+  std::vector<std::complex<float> > bins;
+  std::vector<float> spectrum;
+  Eigen::FFT<float> fft;
+
+  explicit Resolution(int size) : frame_size(size) {
+    // Essentia の Windowing（type=hann, normalized=false）と同じ対称 Hann 窓
+    window.resize(size);
+    for (int i = 0; i < size; i++) {
+      window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (float)(size - 1));
+    }
+    frame.resize(size);
+    spectrum.resize(size / 2 + 1);
+    fft.SetFlag(Eigen::FFT<float>::HalfSpectrum);
+  }
+};
+
+static int gcd(int a, int b) {
+  while (b != 0) {
+    int t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+FrameEngine::FrameEngine(int sample_rate) : sample_rate_(sample_rate) {}
+
+FrameEngine::~FrameEngine() {}
+
+int FrameEngine::frame_count(size_t num_samples, int hop_size) {
+  return (int)((num_samples + hop_size - 1) / hop_size);
+}
+
+void FrameEngine::add_consumer(int frame_size, int hop_size, FrameConsumer* consumer) {
+  Resolution* resolution = nullptr;
+  for (const std::unique_ptr<Resolution>& r : resolutions_) {
+    if (r->frame_size == frame_size) resolution = r.get();
+  }
+  if (!resolution) {
+    resolutions_.emplace_back(new Resolution(frame_size));
+    resolution = resolutions_.back().get();
+  }
+  resolution->hop_size =
+      resolution->hop_size == 0 ? hop_size : gcd(resolution->hop_size, hop_size);
+  resolution->subscriptions.push_back(Subscription{consumer, hop_size});
+}
+
+int FrameEngine::run(const std::vector<float>& signal, EssentiaCancelFlag* cancel_flag) {
+  return run(signal, 0, (int)signal.size(), cancel_flag);
+}
+
+int FrameEngine::run(const std::vector<float>& signal, int begin, int end,
+                     EssentiaCancelFlag* cancel_flag) {
+  const int n = (int)signal.size();
+
+  for (const std::unique_ptr<Resolution>& r : resolutions_) {
+    const int size = r->frame_size;
+    const int half = size / 2;
+    const int num_frames = end > begin ? frame_count(end - begin, r->hop_size) : 0;
+    LOGI("FFT %d/%d at %d Hz: %d frames for %zu consumers", size, r->hop_size, sample_rate_,
+         num_frames, r->subscriptions.size());
+
+    for (int f = 0; f < num_frames; f++) {
+      if (f % 1000 == 0 && essentia_cancel_flag_is_set(cancel_flag)) return 1;
+
+      // このフレームを必要とする解析器がいなければ FFT を省略
+      const int offset = f * r->hop_size;
+      bool needed = false;
+      for (const Subscription& s : r->subscriptions) {
+        if (offset % s.hop_size == 0) needed = true;
+      }
+      if (!needed) continue;
+
+      const int start = begin + offset - half;
+      for (int i = 0; i < size; i++) {
+        int idx = start + i;
+        float sample = (idx >= 0 && idx < n) ? signal[idx] : 0.0f;
+        r->frame[i] = sample * r->window[i];
+      }
+
+      r->fft.fwd(r->bins, r->frame);
+      for (int k = 0; k <= half; k++) {
+        r->spectrum[k] = std::abs(r->bins[k]);
+      }
+
+      for (const Subscription& s : r->subscriptions) {
+        if (offset % s.hop_size == 0) s.consumer->consume(r->spectrum);
+      }
+    }
+  }
+
+  return 0;
+}
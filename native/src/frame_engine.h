@@ -0,0 +1,59 @@
+#ifndef FRAME_ENGINE_H
+#define FRAME_ENGINE_H
+
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include "essentia_bridge.h"
+
+// FrameEngine が計算した振幅スペクトルを受け取る解析器
+class FrameConsumer {
+ public:
+  virtual ~FrameConsumer() {}
+
+  // spectrum は frameSize / 2 + 1 個の振幅値（Hann 窓・非正規化、Essentia の Spectrum と同じ尺度）
+  virtual void consume(const std::vector<float>& spectrum) = 0;
+};
+
+// 1 つのサンプルレートの信号を解像度ごとに 1 回だけ FFT し、登録された解析器へ配る
+// 同じフレーム長の解析器はホップの最大公約数で 1 組のフレームを共有し、
+// 各自のホップで間引いて受け取る
+// フレーム i の中心はサンプル i * hop（Essentia の FrameCutter startFromZero=false と同じ配置）
+// FFT は Eigen（kissfft）で行うため Essentia のグローバルロックを必要としない
+class FrameEngine {
+ public:
+  explicit FrameEngine(int sample_rate);
+  ~FrameEngine();
+
+  FrameEngine(const FrameEngine&) = delete;
+  FrameEngine& operator=(const FrameEngine&) = delete;
+
+  int sample_rate() const { return sample_rate_; }
+
+  void add_consumer(int frame_size, int hop_size, FrameConsumer* consumer);
+
+  // 戻り値は 0=成功, 1=キャンセル
+  int run(const std::vector<float>& signal, EssentiaCancelFlag* cancel_flag);
+
+  // 中心が [begin, end) に入るフレームだけを処理する（begin から hop ごと）
+  // 部分的にデコードした区間の前後を窓の文脈として使い、
+  // 区間をまたいでも全体処理と同じフレームを得る
+  int run(const std::vector<float>& signal, int begin, int end, EssentiaCancelFlag* cancel_flag);
+
+  // 信号長 num_samples に対して hop_size ごとに生成されるフレーム数
+  static int frame_count(size_t num_samples, int hop_size);
+
+ private:
+  struct Subscription {
+    FrameConsumer* consumer;
+    int hop_size;
+  };
+
+  struct Resolution;
+
+  int sample_rate_;
+  std::vector<std::unique_ptr<Resolution> > resolutions_;
+};
+
+#endif  // FRAME_ENGINE_H
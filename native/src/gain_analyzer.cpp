@@ -0,0 +1,256 @@
+#include "gain_analyzer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "audio_decode.h"
+#include "chroma_fingerprint.h"
+#include "frame_engine.h"
+#include "log_timer.h"
+#include "loudness.h"
+#include "thread_budget.h"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "GainAnalyzer"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGI(...)
+#define LOGE(...)
+#endif
+
+static const int FULL_SR = 44100;
+// K 特性の重みは 11 kHz 以上でほとんど効かないため、高速モードは半分のレートで測る
+static const int FAST_SR = 22050;
+static const double CHUNK_SECONDS = 30.0;
+static const int EXCERPT_COUNT = 8;
+static const double EXCERPT_SECONDS = 5.0;
+static const double WARMUP_SECONDS = 0.5;
+static const double FINGERPRINT_SECONDS = 30.0;
+
+static bool is_cancelled(EssentiaCancelFlag* flag) {
+  return essentia_cancel_flag_is_set(flag) != 0;
+}
+
+// インターリーブされた信号（channels は 1 か 2）を左右に分けてラウドネス計へ渡し、ピークも更新する
+// モノラルは right にも同じ値を入れる。1 チャンネルの計器は right を読まないので二重に数えない
+static void measure(const std::vector<float>& interleaved, int channels, size_t skip_frames,
+                    LoudnessMeter& meter, std::vector<float>& left, std::vector<float>& right,
+                    float& peak) {
+  const size_t frames = interleaved.size() / channels;
+  left.resize(frames);
+  right.resize(frames);
+  for (size_t i = 0; i < frames; i++) {
+    left[i] = interleaved[channels * i];
+    right[i] = interleaved[channels * i + channels - 1];
+    if (i >= skip_frames) {
+      peak = std::max(peak, std::max(std::abs(left[i]), std::abs(right[i])));
+    }
+  }
+  meter.add(left.data(), right.data(), (int)frames);
+}
+
+// モノラルの信号からフィンガープリントを作って result に持たせる。失敗しても計測結果は残す
+static void fingerprint(const std::vector<float>& mono, int sample_rate, EssentiaGainResult& result,
+                        EssentiaCancelFlag* cancel_flag) {
+  if (mono.empty()) return;
+  ChromaFingerprinter fingerprinter(sample_rate);
+  FrameEngine engine(sample_rate);
+  engine.add_consumer(ChromaFingerprinter::frame_size(sample_rate),
+                      ChromaFingerprinter::hop_size(sample_rate), &fingerprinter);
+  if (engine.run(mono, cancel_flag) != 0) return;
+
+  const std::vector<uint32_t>& bits = fingerprinter.fingerprint();
+  if (bits.empty()) return;
+  result.fingerprint = (uint32_t*)malloc(sizeof(uint32_t) * bits.size());
+  if (!result.fingerprint) return;
+  std::copy(bits.begin(), bits.end(), result.fingerprint);
+  result.fingerprint_length = (int32_t)bits.size();
+}
+
+static void finish_result(const LoudnessMeter& meter, EssentiaGainResult& result) {
+  result.integrated_lufs = meter.integrated();
+  result.gain_db = ESSENTIA_GAIN_REFERENCE_LUFS - result.integrated_lufs;
+}
+
+// 区切って届く音声をラウドネス計へ流し、曲頭はフィンガープリント用にモノラルで取っておく
+// 計器は元の音声のチャンネル数で作る（スペクトルのピーク計測と同じくモノラルは 1 チャンネル）
+class FullMeasurement : public AudioChunkConsumer {
+ public:
+  FullMeasurement(int sample_rate, EssentiaGainResult& result)
+      : sample_rate_(sample_rate),
+        fingerprint_frames_((size_t)(FINGERPRINT_SECONDS * sample_rate)),
+        result_(result) {}
+
+  void start(int channels) override {
+    channels_ = channels;
+    meter_.reset(new LoudnessMeter(sample_rate_, channels));
+  }
+
+  void consume(const std::vector<float>& samples) override {
+    measure(samples, channels_, 0, *meter_, left_, right_, result_.peak);
+    result_.analyzed_seconds += (float)(samples.size() / channels_) / sample_rate_;
+    for (size_t i = 0; i < left_.size() && mono_.size() < fingerprint_frames_; i++) {
+      mono_.push_back(0.5f * (left_[i] + right_[i]));
+    }
+  }
+
+  const LoudnessMeter& meter() const { return *meter_; }
+  const std::vector<float>& mono() const { return mono_; }
+
+ private:
+  const int sample_rate_;
+  const size_t fingerprint_frames_;
+  int channels_ = 2;
+  std::unique_ptr<LoudnessMeter> meter_;
+  EssentiaGainResult& result_;
+  std::vector<float> left_, right_, mono_;
+};
+
+// 先頭から 1 度だけデコードして全体を測る（曲長が取れない形式にも使える）
+// 途中で読めなくなった曲は一部だけの値を返さず、デコード失敗とする
+static void analyze_full(const char* path, int sample_rate, EssentiaGainResult& result,
+                         EssentiaCancelFlag* cancel_flag) {
+  FullMeasurement measurement(sample_rate, result);
+  int ret = decode_audio_stream(path, sample_rate, 0, CHUNK_SECONDS, measurement, cancel_flag);
+  if (ret != 0) {
+    result.error_code = ret == 1 ? 1 : 2;
+    return;
+  }
+
+  finish_result(measurement.meter(), result);
+  fingerprint(measurement.mono(), sample_rate, result, cancel_flag);
+}
+
+// 等間隔の抜粋だけを測る。区間ごとのラウドネスのばらつきから推定誤差を出す
+static void analyze_excerpts(const char* path, double duration, EssentiaGainResult& result,
+                             EssentiaCancelFlag* cancel_flag) {
+  const int channels = probe_audio_channels(path) == 1 ? 1 : 2;
+  LoudnessMeter meter(FAST_SR, channels);
+  std::vector<float> chunk, left, right;
+  std::vector<double> window_lufs;
+
+  for (int w = 0; w < EXCERPT_COUNT; w++) {
+    const double center = duration * (w + 0.5) / EXCERPT_COUNT;
+    const double start = std::max(0.0, center - EXCERPT_SECONDS / 2 - WARMUP_SECONDS);
+    double actual_start = 0;
+    int ret = decode_audio_range(path, start, EXCERPT_SECONDS + WARMUP_SECONDS, FAST_SR,
+                                 channels, chunk, &actual_start, cancel_flag);
+    if (ret == 1) {
+      result.error_code = 1;
+      return;
+    }
+    if (ret < 0) continue;
+
+    const int warmup = (int)(WARMUP_SECONDS * FAST_SR);
+    const size_t blocks_before = meter.momentary_blocks().size();
+    meter.restart(warmup);
+    measure(chunk, channels, warmup, meter, left, right, result.peak);
+    result.analyzed_seconds +=
+        (float)std::max<double>(0, (double)(chunk.size() / channels) - warmup) / FAST_SR;
+
+    const std::vector<double>& blocks = meter.momentary_blocks();
+    if (blocks.size() > blocks_before) {
+      double sum = 0;
+      for (size_t i = blocks_before; i < blocks.size(); i++) sum += blocks[i];
+      double energy = sum / (blocks.size() - blocks_before);
+      window_lufs.push_back(energy > 0 ? -0.691 + 10.0 * log10(energy) : -100.0);
+    }
+  }
+
+  if (window_lufs.empty()) {
+    result.error_code = 2;
+    return;
+  }
+  finish_result(meter, result);
+
+  // 抜粋は曲頭を含まないため、フィンガープリント用に曲頭だけを低いレートで別にデコードする
+  std::vector<float> mono;
+  double actual_start = 0;
+  if (decode_audio_range(path, 0, FINGERPRINT_SECONDS, ChromaFingerprinter::SAMPLE_RATE, 1, mono,
+                         &actual_start, cancel_flag) == 0) {
+    fingerprint(mono, ChromaFingerprinter::SAMPLE_RATE, result, cancel_flag);
+  }
+
+  // 標本平均の標準誤差に有限母集団補正を掛けた値を推定誤差とする
+  const size_t k = window_lufs.size();
+  if (k >= 2) {
+    double mean = 0;
+    for (double l : window_lufs) mean += l;
+    mean /= k;
+    double var = 0;
+    for (double l : window_lufs) var += (l - mean) * (l - mean);
+    var /= (k - 1);
+    double coverage = std::min(1.0, result.analyzed_seconds / duration);
+    result.uncertainty_lu = (float)(sqrt(var / k) * sqrt(1.0 - coverage));
+  }
+}
+
+static void analyze_track(const char* path, bool fast, EssentiaGainResult& result,
+                          EssentiaCancelFlag* cancel_flag) {
+  result.integrated_lufs = -100.0f;
+  result.peak = 0.0f;
+  result.gain_db = 0.0f;
+  result.uncertainty_lu = 0.0f;
+  result.analyzed_seconds = 0.0f;
+  result.error_code = 0;
+  result.fingerprint = nullptr;
+  result.fingerprint_length = 0;
+
+  const double duration = fast ? probe_audio_duration(path) : 0.0;
+  if (fast && duration >= 2.0 * EXCERPT_COUNT * EXCERPT_SECONDS) {
+    analyze_excerpts(path, duration, result, cancel_flag);
+  } else {
+    analyze_full(path, fast ? FAST_SR : FULL_SR, result, cancel_flag);
+  }
+}
+
+extern "C" {
+
+void essentia_analyze_gain_batch(const char* const* paths, int32_t count, int32_t fast,
+                                 EssentiaGainResult* results, EssentiaCancelFlag* cancel_flag) {
+  if (!paths || !results || count <= 0) return;
+
+  LogTimer timer;
+  std::atomic<int> next(0);
+
+  // 各ワーカーは 1 曲ごとに予算のスロットを 1 つ確保する
+  auto worker = [&]() {
+    for (;;) {
+      const int i = next.fetch_add(1);
+      if (i >= count) return;
+      if (is_cancelled(cancel_flag)) {
+        results[i] = EssentiaGainResult{-100.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1, nullptr, 0};
+        continue;
+      }
+      ThreadBudgetGuard budgetGuard(1);
+      analyze_track(paths[i], fast != 0, results[i], cancel_flag);
+    }
+  };
+
+  const int num_workers = std::max(1, std::min<int>(count, ThreadBudget::instance().max_threads()));
+  std::vector<std::thread> threads;
+  for (int w = 1; w < num_workers; w++) threads.emplace_back(worker);
+  worker();
+  for (std::thread& t : threads) t.join();
+
+  LOGI("Gain batch: %d tracks, %d workers, fast=%d, %.0f ms", count, num_workers, fast,
+       timer.elapsed_ms());
+}
+
+void essentia_free_gain_fingerprints(EssentiaGainResult* results, int32_t count) {
+  if (!results) return;
+  for (int32_t i = 0; i < count; i++) {
+    free(results[i].fingerprint);
+    results[i].fingerprint = nullptr;
+    results[i].fingerprint_length = 0;
+  }
+}
+
+}  // extern "C"
@@ -0,0 +1,40 @@
+#ifndef GAIN_ANALYZER_H
+#define GAIN_ANALYZER_H
+
+#include "essentia_bridge.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ReplayGain 2.0 reference level
+#define ESSENTIA_GAIN_REFERENCE_LUFS (-18.0f)
+
+typedef struct {
+  float integrated_lufs;   // BS.1770 gated loudness, -100 if silent
+  float peak;              // sample peak (linear); a lower bound when excerpts were measured
+  float gain_db;           // ESSENTIA_GAIN_REFERENCE_LUFS - integrated_lufs
+  float uncertainty_lu;    // estimated error of integrated_lufs from excerpt sampling, 0 = full
+  float analyzed_seconds;  // audio actually measured
+  int32_t error_code;      // 0=success, 1=cancelled, 2=decode error, 3=analysis error
+  // Chroma fingerprint of the first 30 s for essentia_fingerprint_index_* (heap-allocated,
+  // NULL when the track could not be fingerprinted).
+  uint32_t* fingerprint;
+  int32_t fingerprint_length;
+} EssentiaGainResult;
+
+// Measures scan-time track gain for count files in parallel (one worker per thread budget slot)
+// and writes results[i] for paths[i]. fast != 0 decodes at 22.05 kHz and, for tracks longer than
+// 80 s, measures eight evenly spaced 5 s excerpts instead of the whole file. The fingerprint
+// reuses the decoded audio when the whole file is measured; excerpt runs decode the first 30 s
+// separately at 11025 Hz mono. Release the fingerprints with essentia_free_gain_fingerprints.
+void essentia_analyze_gain_batch(const char* const* paths, int32_t count, int32_t fast,
+                                 EssentiaGainResult* results, EssentiaCancelFlag* cancel_flag);
+
+void essentia_free_gain_fingerprints(EssentiaGainResult* results, int32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // GAIN_ANALYZER_H
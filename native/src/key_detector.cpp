@@ -0,0 +1,145 @@
+#include "key_detector.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Core>
+
+#include <essentia/algorithmfactory.h>
+
+using namespace essentia;
+using namespace essentia::standard;
+
+static const int PCP_SIZE = 12;
+static const float MIN_FREQUENCY = 25.0f;
+static const float MAX_FREQUENCY = 3500.0f;
+
+// Essentia の Key と同じ長調・短調プロファイル（ESSENTIA_KEY_PROFILE_* の順、先頭は主音）
+static const float PROFILES[ESSENTIA_KEY_PROFILE_COUNT][2][PCP_SIZE] = {
+    // bgate
+    {{1.00f, 0.00f, 0.42f, 0.00f, 0.53f, 0.37f, 0.00f, 0.77f, 0.00f, 0.38f, 0.21f, 0.30f},
+     {1.00f, 0.00f, 0.36f, 0.39f, 0.00f, 0.38f, 0.00f, 0.74f, 0.27f, 0.00f, 0.42f, 0.23f}},
+    // edma
+    {{0.16519551f, 0.04749026f, 0.08293076f, 0.06687112f, 0.09994645f, 0.09274123f, 0.05294487f,
+      0.13159476f, 0.05218986f, 0.07443653f, 0.06940723f, 0.06425150f},
+     {0.17235348f, 0.04000000f, 0.07610090f, 0.12040866f, 0.05621325f, 0.08527149f, 0.04974540f,
+      0.14605515f, 0.07878255f, 0.04447679f, 0.05770005f, 0.07146441f}},
+    // temperley
+    {{5.0f, 2.0f, 3.5f, 2.0f, 4.5f, 4.0f, 2.0f, 4.5f, 2.0f, 3.5f, 1.5f, 4.0f},
+     {5.0f, 2.0f, 3.5f, 4.5f, 2.0f, 4.0f, 2.0f, 4.5f, 3.5f, 2.0f, 1.5f, 4.0f}},
+};
+
+// 行 = プロファイル × 調性 × 主音（HPCP のビン 0 は A）、各行は平均 0・ノルム 1 に正規化済み
+typedef Eigen::Matrix<float, ESSENTIA_KEY_PROFILE_COUNT * 2 * PCP_SIZE, PCP_SIZE, Eigen::RowMajor>
+    ProfileMatrix;
+
+static const ProfileMatrix& profile_matrix() {
+  static const ProfileMatrix matrix = []() {
+    ProfileMatrix m;
+    for (int p = 0; p < ESSENTIA_KEY_PROFILE_COUNT; p++) {
+      for (int scale = 0; scale < 2; scale++) {
+        for (int tonic = 0; tonic < PCP_SIZE; tonic++) {
+          int row = (p * 2 + scale) * PCP_SIZE + tonic;
+          for (int i = 0; i < PCP_SIZE; i++) {
+            m(row, i) = PROFILES[p][scale][(i - tonic + PCP_SIZE) % PCP_SIZE];
+          }
+          m.row(row).array() -= m.row(row).mean();
+          m.row(row).normalize();
+        }
+      }
+    }
+    return m;
+  }();
+  return matrix;
+}
+
+struct KeyDetector::Algorithms {
+  std::unique_ptr<Algorithm> peaks;
+  std::unique_ptr<Algorithm> whitening;
+  std::unique_ptr<Algorithm> hpcp;
+  std::vector<Real> spectrum;
+  std::vector<Real> frequencies;
+  std::vector<Real> magnitudes;
+  std::vector<Real> whitened;
+  std::vector<Real> pcp;
+};
+
+KeyDetector::KeyDetector(int sample_rate)
+    : algorithms_(new Algorithms()), hpcp_sum_(PCP_SIZE, 0.0f) {
+  AlgorithmFactory& factory = AlgorithmFactory::instance();
+  Algorithms& a = *algorithms_;
+
+  // パラメータは KeyExtractor の既定値に合わせる
+  a.peaks.reset(factory.create("SpectralPeaks", "orderBy", "magnitude", "magnitudeThreshold",
+                               0.0001, "minFrequency", MIN_FREQUENCY, "maxFrequency",
+                               MAX_FREQUENCY, "maxPeaks", 60, "sampleRate", sample_rate));
+  a.whitening.reset(factory.create("SpectralWhitening", "maxFrequency", MAX_FREQUENCY,
+                                   "sampleRate", sample_rate));
+  a.hpcp.reset(factory.create("HPCP", "size", PCP_SIZE, "referenceFrequency", 440.0,
+                              "harmonics", 4, "bandPreset", true, "minFrequency", MIN_FREQUENCY,
+                              "maxFrequency", MAX_FREQUENCY, "weightType", "cosine",
+                              "nonLinear", false, "windowSize", 1.0, "sampleRate", sample_rate));
+
+  a.peaks->input("spectrum").set(a.spectrum);
+  a.peaks->output("frequencies").set(a.frequencies);
+  a.peaks->output("magnitudes").set(a.magnitudes);
+
+  a.whitening->input("spectrum").set(a.spectrum);
+  a.whitening->input("frequencies").set(a.frequencies);
+  a.whitening->input("magnitudes").set(a.magnitudes);
+  a.whitening->output("magnitudes").set(a.whitened);
+
+  a.hpcp->input("frequencies").set(a.frequencies);
+  a.hpcp->input("magnitudes").set(a.whitened);
+  a.hpcp->output("hpcp").set(a.pcp);
+}
+
+KeyDetector::~KeyDetector() {}
+
+void KeyDetector::consume(const std::vector<float>& spectrum) {
+  Algorithms& a = *algorithms_;
+
+  // Windowing（normalized=true）相当の尺度に揃える：対称 Hann 窓の面積は (N - 1) / 2
+  const float scale = 4.0f / (float)(2 * (spectrum.size() - 1) - 1);
+  a.spectrum.resize(spectrum.size());
+  Eigen::Map<Eigen::VectorXf>(a.spectrum.data(), a.spectrum.size()) =
+      Eigen::Map<const Eigen::VectorXf>(spectrum.data(), spectrum.size()) * scale;
+
+  a.peaks->compute();
+  a.whitening->compute();
+  a.hpcp->compute();
+
+  Eigen::Map<Eigen::VectorXf>(hpcp_sum_.data(), PCP_SIZE) +=
+      Eigen::Map<const Eigen::VectorXf>(a.pcp.data(), PCP_SIZE);
+  frames_++;
+}
+
+void KeyDetector::estimate(EssentiaKeyEstimate out[ESSENTIA_KEY_PROFILE_COUNT]) const {
+  for (int p = 0; p < ESSENTIA_KEY_PROFILE_COUNT; p++) {
+    out[p].key_note = -1;
+    out[p].key_scale = 0;
+    out[p].strength = 0;
+  }
+  if (frames_ == 0) return;
+
+  Eigen::Matrix<float, PCP_SIZE, 1> hpcp =
+      Eigen::Map<const Eigen::Matrix<float, PCP_SIZE, 1> >(hpcp_sum_.data());
+  hpcp.array() -= hpcp.mean();
+  float norm = hpcp.norm();
+  if (norm <= 0) return;
+  hpcp /= norm;
+
+  // 全プロファイル・全調のピアソン相関を 1 回の行列ベクトル積で求める
+  Eigen::Matrix<float, ESSENTIA_KEY_PROFILE_COUNT * 2 * PCP_SIZE, 1> correlations =
+      profile_matrix() * hpcp;
+
+  for (int p = 0; p < ESSENTIA_KEY_PROFILE_COUNT; p++) {
+    Eigen::Index best;
+    float strength = correlations.segment(p * 2 * PCP_SIZE, 2 * PCP_SIZE).maxCoeff(&best);
+    int tonic = (int)best % PCP_SIZE;
+    // HPCP のビン 0 は A なので C=0 の番号に直す
+    out[p].key_note = static_cast<int8_t>((tonic + 9) % PCP_SIZE);
+    out[p].key_scale = static_cast<int8_t>(best / PCP_SIZE);
+    out[p].strength = strength;
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef KEY_DETECTOR_H
+#define KEY_DETECTOR_H
+
+#include <memory>
+#include <vector>
+
+#include "essentia_bridge.h"
+#include "frame_engine.h"
+
+// KeyExtractor と同じ 4096 サンプルのフレームを FrameEngine から受け取り、
+// HPCP を平均して調を推定する
+// 1 回の HPCP 累積から ESSENTIA_KEY_PROFILE_* の全プロファイルをまとめて採点する
+// Essentia の SpectralPeaks / SpectralWhitening / HPCP を使うため、生成から estimate まで
+// 呼び出し側が Essentia のグローバルロックを保持すること
+class KeyDetector : public FrameConsumer {
+ public:
+  static const int FRAME_SIZE = 4096;
+  static const int HOP_SIZE = 4096;
+
+  explicit KeyDetector(int sample_rate);
+  ~KeyDetector() override;
+
+  KeyDetector(const KeyDetector&) = delete;
+  KeyDetector& operator=(const KeyDetector&) = delete;
+
+  void consume(const std::vector<float>& spectrum) override;
+
+  // out はプロファイル番号で引く。フレームがなければ key_note = -1
+  void estimate(EssentiaKeyEstimate out[ESSENTIA_KEY_PROFILE_COUNT]) const;
+
+ private:
+  struct Algorithms;
+
+  std::unique_ptr<Algorithms> algorithms_;
+  std::vector<float> hpcp_sum_;
+  int frames_ = 0;
+};
+
+#endif  // KEY_DETECTOR_H
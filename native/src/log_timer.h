@@ -0,0 +1,29 @@
+#ifndef LOG_TIMER_H
+#define LOG_TIMER_H
+
+#ifdef __ANDROID__
+#include <chrono>
+#endif
+
+// LOGI に出す経過時間を測る。LOGI が空になる Android 以外では何も測らず 0 を返す
+// （時刻の変数を直接置くと、ログを出さないビルドで未使用の警告になる）
+class LogTimer {
+ public:
+#ifdef __ANDROID__
+  LogTimer() : start_(std::chrono::steady_clock::now()) {}
+
+  double elapsed_ms() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_)
+        .count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+#else
+  LogTimer() {}
+
+  double elapsed_ms() const { return 0; }
+#endif
+};
+
+#endif  // LOG_TIMER_H
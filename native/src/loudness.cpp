@@ -0,0 +1,185 @@
+#include "loudness.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const double ABSOLUTE_GATE = -70.0;
+static const double INTEGRATED_RELATIVE_GATE = -10.0;
+static const double LRA_RELATIVE_GATE = -20.0;
+static const int MOMENTARY_SUB_BLOCKS = 4;    // 400 ms
+static const int SHORT_TERM_SUB_BLOCKS = 30;  // 3 s
+
+static double energy_to_lufs(double energy) {
+  return energy > 0 ? -0.691 + 10.0 * log10(energy) : -HUGE_VAL;
+}
+
+static float to_display(double lufs) { return lufs > -100.0 ? (float)lufs : -100.0f; }
+
+LoudnessMeter::LoudnessMeter(int sample_rate, int channels)
+    : channels_(channels), sub_block_size_(std::max(1, sample_rate / 10)) {
+  // BS.1770 の K 特性を任意のサンプルレートで再設計（48 kHz の規定係数と一致する）
+  const double fs = sample_rate;
+
+  double f0 = 1681.974450955533;
+  double gain_db = 3.999843853973347;
+  double q = 0.7071752369554196;
+  double k = tan(M_PI * f0 / fs);
+  double vh = pow(10.0, gain_db / 20.0);
+  double vb = pow(vh, 0.4996667741545416);
+  double a0 = 1.0 + k / q + k * k;
+  stages_[0].b0 = (vh + vb * k / q + k * k) / a0;
+  stages_[0].b1 = 2.0 * (k * k - vh) / a0;
+  stages_[0].b2 = (vh - vb * k / q + k * k) / a0;
+  stages_[0].a1 = 2.0 * (k * k - 1.0) / a0;
+  stages_[0].a2 = (1.0 - k / q + k * k) / a0;
+
+  f0 = 38.13547087602444;
+  q = 0.5003270373238773;
+  k = tan(M_PI * f0 / fs);
+  a0 = 1.0 + k / q + k * k;
+  stages_[1].b0 = 1.0;
+  stages_[1].b1 = -2.0;
+  stages_[1].b2 = 1.0;
+  stages_[1].a1 = 2.0 * (k * k - 1.0) / a0;
+  stages_[1].a2 = (1.0 - k / q + k * k) / a0;
+}
+
+void LoudnessMeter::add(const float* left, const float* right, int count) {
+  for (int i = 0; i < count; i++) {
+    double energy = 0;
+    for (int c = 0; c < channels_; c++) {
+      double x = c == 0 ? left[i] : right[i];
+      ChannelFilter& f = filters_[c];
+      for (int s = 0; s < 2; s++) {
+        const Biquad& b = stages_[s];
+        double y = b.b0 * x + f.z1[s];
+        f.z1[s] = b.b1 * x - b.a1 * y + f.z2[s];
+        f.z2[s] = b.b2 * x - b.a2 * y;
+        x = y;
+      }
+      energy += x * x;
+    }
+    if (warmup_ > 0) {
+      warmup_--;
+      continue;
+    }
+    sub_block_energy_ += energy;
+    if (++sub_block_fill_ == sub_block_size_) end_sub_block();
+  }
+}
+
+void LoudnessMeter::restart(int warmup_samples) {
+  for (ChannelFilter& f : filters_) f = ChannelFilter();
+  sub_blocks_.clear();
+  sub_block_energy_ = 0;
+  sub_block_fill_ = 0;
+  warmup_ = warmup_samples;
+  momentary_ = -100.0f;
+  short_term_ = -100.0f;
+}
+
+void LoudnessMeter::end_sub_block() {
+  sub_blocks_.push_back(sub_block_energy_ / sub_block_size_);
+  sub_block_energy_ = 0;
+  sub_block_fill_ = 0;
+
+  // 100 ms ずつずらした窓（400 ms は 75%、3 s は 96.7% のオーバーラップ）
+  const size_t n = sub_blocks_.size();
+  if (n >= MOMENTARY_SUB_BLOCKS) {
+    double sum = 0;
+    for (size_t i = n - MOMENTARY_SUB_BLOCKS; i < n; i++) sum += sub_blocks_[i];
+    momentary_blocks_.push_back(sum / MOMENTARY_SUB_BLOCKS);
+    momentary_ = to_display(energy_to_lufs(momentary_blocks_.back()));
+  }
+  if (n >= SHORT_TERM_SUB_BLOCKS) {
+    double sum = 0;
+    for (size_t i = n - SHORT_TERM_SUB_BLOCKS; i < n; i++) sum += sub_blocks_[i];
+    short_term_blocks_.push_back(sum / SHORT_TERM_SUB_BLOCKS);
+    short_term_ = to_display(energy_to_lufs(short_term_blocks_.back()));
+  }
+}
+
+// 絶対ゲートを通ったブロックの平均から相対ゲートを決め、両方を通ったブロックだけを残す
+static std::vector<double> gate_blocks(const std::vector<double>& blocks, double relative_gate) {
+  double sum = 0;
+  size_t count = 0;
+  for (double e : blocks) {
+    if (energy_to_lufs(e) > ABSOLUTE_GATE) {
+      sum += e;
+      count++;
+    }
+  }
+  std::vector<double> gated;
+  if (count == 0) return gated;
+
+  const double threshold = energy_to_lufs(sum / count) + relative_gate;
+  for (double e : blocks) {
+    double lufs = energy_to_lufs(e);
+    if (lufs > ABSOLUTE_GATE && lufs > threshold) gated.push_back(e);
+  }
+  return gated;
+}
+
+float LoudnessMeter::integrated() const {
+  std::vector<double> gated = gate_blocks(momentary_blocks_, INTEGRATED_RELATIVE_GATE);
+  if (gated.empty()) return -100.0f;
+
+  double sum = 0;
+  for (double e : gated) sum += e;
+  return to_display(energy_to_lufs(sum / gated.size()));
+}
+
+// EBU Tech 3342: ゲート後の short-term 値の 10〜95 パーセンタイル幅
+float LoudnessMeter::loudness_range() const {
+  std::vector<double> gated = gate_blocks(short_term_blocks_, LRA_RELATIVE_GATE);
+  if (gated.size() < 2) return 0.0f;
+
+  std::sort(gated.begin(), gated.end());
+  const size_t last = gated.size() - 1;
+  const double low = energy_to_lufs(gated[(size_t)std::lround(0.10 * last)]);
+  const double high = energy_to_lufs(gated[(size_t)std::lround(0.95 * last)]);
+  return (float)(high - low);
+}
+
+TruePeakMeter::TruePeakMeter() : buffer_(kTaps - 1, 0.0f) {
+  // 遮断 = 元のナイキスト周波数の窓付き sinc（Blackman 窓）。各相の DC 利得を 1 に揃える
+  const int length = kPhases * kTaps;
+  const double center = (length - 1) / 2.0;
+  double h[kPhases * kTaps];
+  for (int n = 0; n < length; n++) {
+    double t = (n - center) / kPhases;
+    double sinc = t == 0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+    double w = 0.42 - 0.5 * cos(2.0 * M_PI * n / (length - 1)) +
+               0.08 * cos(4.0 * M_PI * n / (length - 1));
+    h[n] = sinc * w;
+  }
+  for (int p = 0; p < kPhases; p++) {
+    double sum = 0;
+    for (int t = 0; t < kTaps; t++) sum += h[p + t * kPhases];
+    for (int t = 0; t < kTaps; t++) {
+      coeffs_[p][kTaps - 1 - t] = (float)(h[p + t * kPhases] / sum);
+    }
+  }
+}
+
+float TruePeakMeter::process(const float* samples, int count) {
+  const int history = kTaps - 1;
+  buffer_.resize(history + count);
+  std::copy(samples, samples + count, buffer_.begin() + history);
+
+  float peak = 0;
+  const float* x = buffer_.data();
+  for (int m = 0; m < count; m++) {
+    for (int p = 0; p < kPhases; p++) {
+      const float* c = coeffs_[p];
+      float y = 0;
+      for (int t = 0; t < kTaps; t++) y += c[t] * x[m + t];
+      peak = std::max(peak, std::abs(y));
+    }
+  }
+
+  // 次の区間のために末尾を履歴として残す
+  std::copy(buffer_.end() - history, buffer_.end(), buffer_.begin());
+  buffer_.resize(history);
+  return peak;
+}
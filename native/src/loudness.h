@@ -0,0 +1,73 @@
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <vector>
+
+// ITU-R BS.1770 / EBU R128 のラウドネス計（K 特性、100 ms ごとに更新）
+// momentary は 400 ms、short-term は 3 s の窓。integrated と LRA は最後にゲートを掛けて求める
+// 値はすべて LUFS / LU。まだ窓が埋まっていない・無音のときは -100
+class LoudnessMeter {
+ public:
+  // channels は 1 か 2（各チャンネルの重みは 1.0）
+  LoudnessMeter(int sample_rate, int channels);
+
+  // right は channels == 2 のときだけ読む
+  void add(const float* left, const float* right, int count);
+
+  // 不連続な区間を続けて測るときに区間の頭で呼ぶ。窓とフィルタ状態を捨て、
+  // 続く warmup_samples サンプルはフィルタを落ち着かせるだけで計測しない
+  // ゲート用のブロックは残るため integrated と LRA は全区間をまとめた値になる
+  void restart(int warmup_samples);
+
+  float momentary() const { return momentary_; }
+  float short_term() const { return short_term_; }
+
+  float integrated() const;
+  float loudness_range() const;
+
+  // ゲート前の 400 ms ブロック（平均二乗）。区間ごとのばらつきを見るのに使う
+  const std::vector<double>& momentary_blocks() const { return momentary_blocks_; }
+
+ private:
+  struct Biquad {
+    double b0, b1, b2, a1, a2;
+  };
+
+  struct ChannelFilter {
+    double z1[2] = {0, 0};  // 段ごとの転置直接形 II の状態
+    double z2[2] = {0, 0};
+  };
+
+  void end_sub_block();
+
+  int channels_;
+  int sub_block_size_;  // 100 ms
+  Biquad stages_[2];    // 高域シェルフ + RLB ハイパス
+  ChannelFilter filters_[2];
+  double sub_block_energy_ = 0;
+  int sub_block_fill_ = 0;
+  int warmup_ = 0;
+  std::vector<double> sub_blocks_;  // 100 ms ごとの平均二乗（全チャンネル和）
+  std::vector<double> momentary_blocks_;   // ゲート用 400 ms ブロック（平均二乗）
+  std::vector<double> short_term_blocks_;  // LRA 用 3 s ブロック（平均二乗）
+  float momentary_ = -100.0f;
+  float short_term_ = -100.0f;
+};
+
+// 4 倍オーバーサンプリング（12 タップ × 4 相のポリフェーズ FIR）で求めるトゥルーピーク
+class TruePeakMeter {
+ public:
+  TruePeakMeter();
+
+  // count サンプルを処理し、この区間のトゥルーピーク（線形振幅）を返す
+  float process(const float* samples, int count);
+
+ private:
+  static const int kPhases = 4;
+  static const int kTaps = 12;
+
+  float coeffs_[kPhases][kTaps];  // 畳み込みを連続アクセスにするため逆順に格納
+  std::vector<float> buffer_;     // 直前の kTaps - 1 サンプル + 今回の区間
+};
+
+#endif  // LOUDNESS_H
@@ -0,0 +1,51 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "MappedFile"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGE(...)
+#endif
+
+MappedFile::~MappedFile() {
+  if (data_) munmap(data_, size_);
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const char* path) {
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOGE("open failed: %s (%s)", path, strerror(errno));
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    LOGE("fstat failed or empty file: %s", path);
+    close(fd);
+    return nullptr;
+  }
+
+  void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // マッピングはファイルディスクリプタを閉じても有効
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOGE("mmap failed: %s (%s)", path, strerror(errno));
+    return nullptr;
+  }
+
+  std::shared_ptr<MappedFile> file(new MappedFile());
+  file->path_ = path;
+  file->data_ = data;
+  file->size_ = (size_t)st.st_size;
+  file->mtime_ = (int64_t)st.st_mtime;
+  return file;
+}
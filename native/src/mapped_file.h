@@ -0,0 +1,34 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+// 読み取り専用でメモリマップしたファイル。ページキャッシュを共有し、メモリ逼迫時は OS が回収できる
+class MappedFile {
+ public:
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  static std::shared_ptr<MappedFile> open(const char* path);
+
+  const void* data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::string& path() const { return path_; }
+  int64_t mtime() const { return mtime_; }
+
+ private:
+  MappedFile() = default;
+
+  std::string path_;
+  void* data_ = nullptr;
+  size_t size_ = 0;
+  int64_t mtime_ = 0;
+};
+
+#endif  // MAPPED_FILE_H
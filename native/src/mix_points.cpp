@@ -0,0 +1,161 @@
+#include "mix_points.h"
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+static const int NUM_BANDS = 24;
+static const float FLOOR_DB = -80.0f;
+static const int PHRASE_BEATS = 16;
+static const int LONG_PHRASE_BEATS = 32;
+// 境界の前後で平均エネルギーを比べる拍数
+static const int CONTRAST_BEATS = 8;
+// 候補を探す曲頭・曲末の範囲（曲長に対する割合と上限秒）
+static const float SEARCH_FRACTION = 0.35f;
+static const float SEARCH_MAX_SEC = 90.0f;
+// energy() でフラックスの平均がこの値のとき 0.5 になる
+static const float FLUX_REF_DB = 2.0f;
+
+MixPointDetector::MixPointDetector(int sample_rate)
+    : sample_rate_(sample_rate),
+      bands_(NUM_BANDS, FRAME_SIZE, sample_rate),
+      current_(NUM_BANDS),
+      previous_(NUM_BANDS, FLOOR_DB) {}
+
+void MixPointDetector::consume(const std::vector<float>& spectrum) {
+  bands_.compute(spectrum, current_.data());
+
+  float power = 0, flux = 0;
+  for (int b = 0; b < NUM_BANDS; b++) {
+    float db = std::max(current_[b], FLOOR_DB);
+    power += powf(10.0f, db / 10.0f);
+    flux += std::max(0.0f, db - previous_[b]);
+    previous_[b] = db;
+  }
+  frame_db_.push_back(10.0f * log10f(power / NUM_BANDS));
+  frame_flux_.push_back(frame_flux_.empty() ? 0.0f : flux / NUM_BANDS);
+}
+
+float MixPointDetector::energy() const {
+  if (frame_flux_.empty()) return -1.0f;
+
+  // 無音部分で平均が下がらないよう、床に張り付いたフレームは除く
+  double sum = 0;
+  int count = 0;
+  for (size_t i = 0; i < frame_flux_.size(); i++) {
+    if (frame_db_[i] <= FLOOR_DB + 10.0f) continue;
+    sum += frame_flux_[i];
+    count++;
+  }
+  if (count == 0) return 0.0f;
+  float mean = (float)(sum / count);
+  return mean / (mean + FLUX_REF_DB);
+}
+
+void MixPointDetector::detect(const std::vector<float>& ticks, int max_per_kind,
+                              std::vector<EssentiaMixPoint>& out) const {
+  const int numBeats = (int)ticks.size();
+  const int numFrames = (int)frame_db_.size();
+  if (numBeats < PHRASE_BEATS * 2 || numFrames == 0 || max_per_kind <= 0) return;
+
+  // 拍ごとにフレームをまとめる。拍 i は [ticks[i], ticks[i+1]) で、最後の拍は 1 拍分の長さとする
+  const float frameSec = (float)HOP_SIZE / sample_rate_;
+  std::vector<float> beatDb(numBeats), beatFlux(numBeats);
+  for (int i = 0; i < numBeats; i++) {
+    float begin = ticks[i];
+    float end = i + 1 < numBeats ? ticks[i + 1] : begin + (ticks[i] - ticks[i - 1]);
+    int f0 = std::min((int)lroundf(begin / frameSec), numFrames - 1);
+    int f1 = std::min(std::max((int)lroundf(end / frameSec), f0 + 1), numFrames);
+    double power = 0, flux = 0;
+    for (int f = f0; f < f1; f++) {
+      power += pow(10.0, frame_db_[f] / 10.0);
+      flux += frame_flux_[f];
+    }
+    beatDb[i] = 10.0f * log10f((float)(power / (f1 - f0)));
+    beatFlux[i] = (float)(flux / (f1 - f0));
+  }
+
+  double fluxSum = 0;
+  for (float flux : beatFlux) fluxSum += flux;
+  const float meanFlux = std::max((float)(fluxSum / numBeats), 1e-3f);
+
+  // 境界らしさ = 前後 CONTRAST_BEATS 拍の平均エネルギーの差（6 dB で 1）+ 拍頭のフラックス
+  std::vector<float> strength(numBeats, 0.0f);
+  for (int b = CONTRAST_BEATS; b + CONTRAST_BEATS <= numBeats; b++) {
+    float before = 0, after = 0;
+    for (int k = 0; k < CONTRAST_BEATS; k++) {
+      before += beatDb[b - 1 - k];
+      after += beatDb[b + k];
+    }
+    strength[b] = std::abs(after - before) / CONTRAST_BEATS / 6.0f + beatFlux[b] / meanFlux;
+  }
+
+  // フレーズの位相は、16 拍ごとの境界らしさの合計が最大になるずれを採用する
+  int phase = 0;
+  float bestPhase = -1;
+  for (int o = 0; o < PHRASE_BEATS; o++) {
+    float sum = 0;
+    for (int b = o; b < numBeats; b += PHRASE_BEATS) sum += strength[b];
+    if (sum > bestPhase) {
+      bestPhase = sum;
+      phase = o;
+    }
+  }
+
+  float maxStrength = 1e-3f;
+  for (float s : strength) maxStrength = std::max(maxStrength, s);
+
+  std::vector<float> sortedDb(beatDb);
+  std::nth_element(sortedDb.begin(), sortedDb.begin() + numBeats / 2, sortedDb.end());
+  const float medianDb = sortedDb[numBeats / 2];
+
+  const float duration = ticks.back();
+  const float window = std::min(duration * SEARCH_FRACTION, SEARCH_MAX_SEC);
+
+  auto regionDb = [&](int begin, int end) {
+    double power = 0;
+    for (int i = begin; i < end; i++) power += pow(10.0, beatDb[i] / 10.0);
+    return 10.0f * log10f((float)(power / (end - begin)));
+  };
+
+  // 区間が静かなほど重ねやすい。中央値との差を ±1 に収める
+  auto sparseness = [&](int begin, int end) {
+    return std::min(1.0f, std::max(-1.0f, (medianDb - regionDb(begin, end)) / 6.0f));
+  };
+
+  std::vector<EssentiaMixPoint> ins, outs;
+  for (int b = phase; b < numBeats; b += PHRASE_BEATS) {
+    int beats = b + LONG_PHRASE_BEATS < numBeats ? LONG_PHRASE_BEATS : PHRASE_BEATS;
+    int end = b + beats;
+    if (end >= numBeats) break;
+
+    EssentiaMixPoint point;
+    point.start_sec = ticks[b];
+    point.end_sec = ticks[end];
+    point.phrase_beats = beats;
+
+    // ミックスイン: 曲頭寄りで、静かなイントロが終わって本編に切り替わる区間
+    if (ticks[b] <= window) {
+      point.kind = ESSENTIA_MIX_IN;
+      point.score = sparseness(b, end) + strength[end] / maxStrength +
+                    0.5f * (1.0f - ticks[b] / window);
+      ins.push_back(point);
+    }
+    // ミックスアウト: 曲末寄りで、展開が切り替わってアウトロに入る区間
+    if (ticks[b] >= duration - window) {
+      point.kind = ESSENTIA_MIX_OUT;
+      point.score = sparseness(b, end) + strength[b] / maxStrength +
+                    0.5f * (ticks[b] - (duration - window)) / window;
+      outs.push_back(point);
+    }
+  }
+
+  auto byScore = [](const EssentiaMixPoint& a, const EssentiaMixPoint& b) {
+    return a.score > b.score;
+  };
+  for (std::vector<EssentiaMixPoint>* points : {&ins, &outs}) {
+    std::sort(points->begin(), points->end(), byScore);
+    if ((int)points->size() > max_per_kind) points->resize(max_per_kind);
+    out.insert(out.end(), points->begin(), points->end());
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef MIX_POINTS_H
+#define MIX_POINTS_H
+
+#include <vector>
+
+#include "essentia_bridge.h"
+#include "frame_engine.h"
+#include "spectrum_bands.h"
+
+// 調の推定と同じ 4096 サンプルのフレームを FrameEngine から受け取り、
+// フレームごとのエネルギー（dB）とスペクトルフラックスを記録する
+// FFT は KeyDetector と共有されるため、追加の計算はバンド化と差分だけ
+// Essentia のアルゴリズムは使わないのでグローバルロックは不要
+class MixPointDetector : public FrameConsumer {
+ public:
+  static const int FRAME_SIZE = 4096;
+  static const int HOP_SIZE = 4096;
+
+  explicit MixPointDetector(int sample_rate);
+
+  void consume(const std::vector<float>& spectrum) override;
+
+  // 曲全体の勢い（0..1）。フラックスの平均を飽和させた相対値で、曲どうしの比較に使う
+  // フレームがなければ -1
+  float energy() const;
+
+  // 拍位置 ticks（曲頭からの秒）を 16 拍のフレーズに区切り、曲頭付近のミックスイン候補と
+  // 曲末付近のミックスアウト候補をそれぞれ max_per_kind 個まで、スコアの高い順に out へ追加する
+  // 全曲を 1 区間として consume した場合にだけ呼ぶこと（フレームの時刻を曲頭から数えるため）
+  void detect(const std::vector<float>& ticks, int max_per_kind,
+              std::vector<EssentiaMixPoint>& out) const;
+
+ private:
+  int sample_rate_;
+  SpectrumBands bands_;
+  std::vector<float> current_;
+  std::vector<float> previous_;
+  std::vector<float> frame_db_;    // フレームのパワー（dB）
+  std::vector<float> frame_flux_;  // 前フレームからの正の変化量（dB、バンド平均）
+};
+
+#endif  // MIX_POINTS_H
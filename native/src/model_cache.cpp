@@ -0,0 +1,98 @@
+#include "model_cache.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <mutex>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "ModelCache"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGI(...)
+#endif
+
+static std::mutex& cacheMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+static std::string& cacheDir() {
+  static std::string dir;
+  return dir;
+}
+
+static std::string base_name(const std::string& path) {
+  size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// FNV-1a (64 bit)。マップ済みのモデル全体を一度だけ走査する
+static uint64_t content_hash(const MappedFile& model) {
+  static std::mutex mutex;
+  static std::string cached_path;
+  static size_t cached_size = 0;
+  static int64_t cached_mtime = 0;
+  static uint64_t cached_hash = 0;
+
+  std::lock_guard<std::mutex> guard(mutex);
+  if (cached_path == model.path() && cached_size == model.size() &&
+      cached_mtime == model.mtime()) {
+    return cached_hash;
+  }
+
+  uint64_t hash = 1469598103934665603ULL;
+  const unsigned char* bytes = (const unsigned char*)model.data();
+  for (size_t i = 0; i < model.size(); i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+
+  cached_path = model.path();
+  cached_size = model.size();
+  cached_mtime = model.mtime();
+  cached_hash = hash;
+  return hash;
+}
+
+void model_cache_set_dir(const char* dir) {
+  std::lock_guard<std::mutex> guard(cacheMutex());
+  cacheDir() = dir ? dir : "";
+}
+
+std::string optimized_model_path(const MappedFile& model, const char* ort_version) {
+  std::string dir;
+  {
+    std::lock_guard<std::mutex> guard(cacheMutex());
+    dir = cacheDir();
+  }
+  if (dir.empty()) return std::string();
+
+  char suffix[64];
+  snprintf(suffix, sizeof(suffix), ".%016llx.ort%s.ort", (unsigned long long)content_hash(model),
+           ort_version);
+  return dir + "/" + base_name(model.path()) + suffix;
+}
+
+void remove_stale_optimized_models(const MappedFile& model, const std::string& current_path) {
+  size_t slash = current_path.find_last_of('/');
+  if (slash == std::string::npos) return;
+  std::string dir = current_path.substr(0, slash);
+  std::string prefix = base_name(model.path()) + ".";
+  std::string current = current_path.substr(slash + 1);
+
+  DIR* d = opendir(dir.c_str());
+  if (!d) return;
+  while (struct dirent* entry = readdir(d)) {
+    std::string name = entry->d_name;
+    if (name == current || name.compare(0, prefix.size(), prefix) != 0) continue;
+    if (name.size() < 4 || name.compare(name.size() - 4, 4, ".ort") != 0) continue;
+    std::string stale = dir + "/" + name;
+    if (unlink(stale.c_str()) == 0) {
+      LOGI("Removed stale optimized model: %s", stale.c_str());
+    }
+  }
+  closedir(d);
+}
@@ -0,0 +1,17 @@
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include <string>
+
+#include "mapped_file.h"
+
+void model_cache_set_dir(const char* dir);
+
+// ORT で最適化したモデルの保存先を返す。キャッシュディレクトリ未設定時は空文字列
+// ファイル名に元モデルの内容ハッシュと ORT のバージョンを含め、どちらかが変われば別ファイルになる
+std::string optimized_model_path(const MappedFile& model, const char* ort_version);
+
+// current_path と同じモデル由来で、ハッシュやバージョンが異なる古い成果物を削除する
+void remove_stale_optimized_models(const MappedFile& model, const std::string& current_path);
+
+#endif  // MODEL_CACHE_H
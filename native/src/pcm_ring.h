@@ -0,0 +1,79 @@
+#ifndef PCM_RING_H
+#define PCM_RING_H
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+// 再生スレッド（書き込み側）と解析スレッド（読み出し側）が 1 つずつの前提のロックフリーなリング
+// バッファ。位置は単調増加のカウンタで持ち、容量を 2 のべき乗にしてマスクで添字に変換する
+class PcmRing {
+ public:
+  // capacity はサンプル数（インターリーブ済みなら全チャンネル分）。2 のべき乗に切り上げる
+  explicit PcmRing(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    buffer_.resize(size);
+    mask_ = size - 1;
+  }
+
+  PcmRing(const PcmRing&) = delete;
+  PcmRing& operator=(const PcmRing&) = delete;
+
+  size_t capacity() const { return buffer_.size(); }
+
+  // 書き込み側のみ。今すぐ書き込めるサンプル数
+  size_t writable() const {
+    return buffer_.size() -
+           (head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire));
+  }
+
+  // 書き込み側のみ。空きが足りない分は書き込まず、戻り値は書き込んだサンプル数
+  size_t write(const float* samples, size_t count) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    count = std::min(count, buffer_.size() - (head - tail));
+    copy_in(head, samples, count);
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  // 読み出し側のみ。戻り値は読み出したサンプル数
+  size_t read(float* out, size_t count) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t head = head_.load(std::memory_order_acquire);
+    count = std::min(count, head - tail);
+    copy_out(tail, out, count);
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  // 読み出し側のみ。溜まっているサンプルをすべて捨てる（シーク時など）
+  void clear() { tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release); }
+
+ private:
+  void copy_in(size_t pos, const float* samples, size_t count) {
+    const size_t index = pos & mask_;
+    const size_t first = std::min(count, buffer_.size() - index);
+    memcpy(buffer_.data() + index, samples, sizeof(float) * first);
+    memcpy(buffer_.data(), samples + first, sizeof(float) * (count - first));
+  }
+
+  void copy_out(size_t pos, float* out, size_t count) const {
+    const size_t index = pos & mask_;
+    const size_t first = std::min(count, buffer_.size() - index);
+    memcpy(out, buffer_.data() + index, sizeof(float) * first);
+    memcpy(out + first, buffer_.data(), sizeof(float) * (count - first));
+  }
+
+  std::vector<float> buffer_;
+  size_t mask_;
+  // 書き込み側と読み出し側が別のキャッシュラインを更新するよう離しておく
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+#endif  // PCM_RING_H
@@ -0,0 +1,458 @@
+#include "playlist_solver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <initializer_list>
+#include <mutex>
+#include <new>
+#include <random>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "log_timer.h"
+#include "thread_budget.h"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "PlaylistSolver"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGI(...)
+#endif
+
+static const EssentiaSequenceOptions DEFAULT_OPTIONS = {
+    1.0f, 1.0f, 0.5f, 1.0f, ESSENTIA_ENERGY_SMOOTH, -1, 8, 0};
+
+// log(1.06)。テンポ差がこの比のとき距離 1
+static const float TEMPO_UNIT = 0.0583f;
+static const float LN2 = 0.6931472f;
+// 半分・倍のテンポでつなぐときに足す距離（テンポの単位）
+static const float HALF_DOUBLE_PENALTY = 0.1f / TEMPO_UNIT;
+static const float MAX_TEMPO_DISTANCE = 4.0f;
+// テンポが不明な曲を候補探しで並べる位置（120 BPM）
+static const float UNKNOWN_LOG_BPM = 4.7875f;
+static const int CAMELOT_CODES = 24;
+// 各曲の候補数と、テンポ順で前後に調べる曲数
+static const int NUM_CANDIDATES = 8;
+static const int CANDIDATE_WINDOW = 32;
+static const int FALLBACK_WINDOW = 16;
+static const int MAX_OR_OPT_LENGTH = 3;
+static const float IMPROVEMENT_EPSILON = 1e-4f;
+static const int MAX_PASSES = 50;
+
+static bool is_cancelled(EssentiaCancelFlag* flag) {
+  return essentia_cancel_flag_is_set(flag) != 0;
+}
+
+namespace {
+
+// 曲 a から曲 b へつなぐコスト。エネルギーの向きがあるため非対称
+class TransitionCost {
+ public:
+  TransitionCost(const float* bpm, const int8_t* camelot, const float* energy,
+                 const float* embeddings, int dim, int n, const EssentiaSequenceOptions& options)
+      : camelot_(camelot), energy_(energy), dim_(dim), options_(options), log_bpm_(n) {
+    for (int i = 0; i < n; i++) log_bpm_[i] = bpm[i] > 0 ? logf(bpm[i]) : 0.0f;
+    known_bpm_.resize(n);
+    for (int i = 0; i < n; i++) known_bpm_[i] = bpm[i] > 0;
+
+    // 埋め込みは正規化しておき、内積をそのまま余弦類似度として使う。ゼロ行は不明扱い
+    if (embeddings && dim > 0) {
+      embeddings_.assign(embeddings, embeddings + (size_t)n * dim);
+      has_embedding_.assign(n, false);
+      for (int i = 0; i < n; i++) {
+        float* row = &embeddings_[(size_t)i * dim];
+        double norm = 0;
+        for (int d = 0; d < dim; d++) norm += (double)row[d] * row[d];
+        if (norm <= 1e-12) continue;
+        const float inv = (float)(1.0 / sqrt(norm));
+        for (int d = 0; d < dim; d++) row[d] *= inv;
+        has_embedding_[i] = true;
+      }
+    }
+  }
+
+  float sort_key(int i) const { return known_bpm_[i] ? log_bpm_[i] : UNKNOWN_LOG_BPM; }
+
+  float operator()(int a, int b) const {
+    float tempo = 1.0f;
+    if (known_bpm_[a] && known_bpm_[b]) {
+      const float r = std::abs(log_bpm_[b] - log_bpm_[a]);
+      tempo = std::min(r / TEMPO_UNIT, std::abs(r - LN2) / TEMPO_UNIT + HALF_DOUBLE_PENALTY);
+      tempo = std::min(tempo, MAX_TEMPO_DISTANCE);
+    }
+
+    float key = 0.5f;
+    const int ka = camelot_[a], kb = camelot_[b];
+    if (ka >= 0 && ka < CAMELOT_CODES && kb >= 0 && kb < CAMELOT_CODES) {
+      int dn = std::abs(ka / 2 - kb / 2);
+      dn = std::min(dn, 12 - dn);
+      const int steps = dn + (ka % 2 != kb % 2 ? 1 : 0);
+      key = steps == 0 ? 0.0f : std::min(1.0f, 0.25f + 0.25f * steps);
+    }
+
+    float embedding = 0.0f;
+    if (!embeddings_.empty()) {
+      embedding = 0.5f;
+      if (has_embedding_[a] && has_embedding_[b]) {
+        const float* ra = &embeddings_[(size_t)a * dim_];
+        const float* rb = &embeddings_[(size_t)b * dim_];
+        float dot = 0;
+        for (int d = 0; d < dim_; d++) dot += ra[d] * rb[d];
+        embedding = 1.0f - dot;
+      }
+    }
+
+    float flow = 0.0f;
+    if (energy_[a] >= 0 && energy_[b] >= 0) {
+      const float delta = energy_[b] - energy_[a];
+      flow = options_.energy_shape == ESSENTIA_ENERGY_RISING
+                 ? 0.5f * std::abs(delta) + 1.5f * std::max(0.0f, -delta)
+                 : std::abs(delta);
+    }
+
+    return options_.tempo_weight * tempo + options_.key_weight * key +
+           options_.embedding_weight * embedding + options_.energy_weight * flow;
+  }
+
+ private:
+  const int8_t* camelot_;
+  const float* energy_;
+  int dim_;
+  EssentiaSequenceOptions options_;
+  std::vector<float> log_bpm_;
+  std::vector<bool> known_bpm_;
+  std::vector<float> embeddings_;
+  std::vector<bool> has_embedding_;
+};
+
+// テンポ順（半分・倍を含む）で近い曲だけを評価し、コストの小さい NUM_CANDIDATES 曲を候補にする
+// 全組み合わせを見ないので 10k 曲でも O(n) 回程度のコスト評価で済む
+static std::vector<int> build_candidates(const TransitionCost& cost, int n, int* k_out) {
+  const int k = std::min(NUM_CANDIDATES, n - 1);
+  *k_out = k;
+  std::vector<int> candidates((size_t)n * k);
+  if (k <= 0) return candidates;
+
+  std::vector<std::pair<float, int> > sorted(n);
+  for (int i = 0; i < n; i++) sorted[i] = std::make_pair(cost.sort_key(i), i);
+  std::sort(sorted.begin(), sorted.end());
+
+  std::vector<std::pair<float, int> > scored;
+  std::vector<int> seen(n, -1);
+  for (int i = 0; i < n; i++) {
+    scored.clear();
+    const float key = cost.sort_key(i);
+    for (float target : {key, key - LN2, key + LN2}) {
+      const int center = (int)(std::lower_bound(sorted.begin(), sorted.end(),
+                                                std::make_pair(target, -1)) -
+                               sorted.begin());
+      const int lo = std::max(0, center - CANDIDATE_WINDOW);
+      const int hi = std::min(n, center + CANDIDATE_WINDOW);
+      for (int s = lo; s < hi; s++) {
+        const int j = sorted[s].second;
+        if (j == i || seen[j] == i) continue;
+        seen[j] = i;
+        scored.push_back(std::make_pair(cost(i, j), j));
+      }
+    }
+    const int take = std::min<int>(k, (int)scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + take, scored.end());
+    int* out = &candidates[(size_t)i * k];
+    for (int c = 0; c < k; c++) out[c] = c < take ? scored[c].second : scored[0].second;
+  }
+  return candidates;
+}
+
+class Solver {
+ public:
+  Solver(const TransitionCost& cost, const std::vector<int>& candidates, int k, int n,
+         int first_track)
+      : cost_(cost), candidates_(candidates), k_(k), n_(n), first_(first_track) {}
+
+  // 貪欲法で経路を作る。rng があれば 1 割の確率で 2 番目に近い曲を選び、再スタートごとに散らす
+  void construct(int start, std::mt19937* rng) {
+    order_.clear();
+    std::vector<bool> visited(n_, false);
+    std::set<std::pair<float, int> > remaining;
+    for (int i = 0; i < n_; i++) remaining.insert(std::make_pair(cost_.sort_key(i), i));
+
+    int current = start;
+    for (;;) {
+      order_.push_back(current);
+      visited[current] = true;
+      remaining.erase(std::make_pair(cost_.sort_key(current), current));
+      if (remaining.empty()) break;
+
+      int best = -1, second = -1;
+      float bestCost = HUGE_VALF, secondCost = HUGE_VALF;
+      auto offer = [&](int j) {
+        const float c = cost_(current, j);
+        if (c < bestCost) {
+          second = best;
+          secondCost = bestCost;
+          best = j;
+          bestCost = c;
+        } else if (c < secondCost && j != best) {
+          second = j;
+          secondCost = c;
+        }
+      };
+      for (int c = 0; c < k_; c++) {
+        const int j = candidates_[(size_t)current * k_ + c];
+        if (!visited[j]) offer(j);
+      }
+      // 候補が使い切られていれば、残りの曲からテンポの近いものを探す
+      if (best < 0) {
+        auto it = remaining.lower_bound(std::make_pair(cost_.sort_key(current), -1));
+        auto back = it;
+        for (int s = 0; s < FALLBACK_WINDOW && it != remaining.end(); s++, ++it) {
+          offer(it->second);
+        }
+        for (int s = 0; s < FALLBACK_WINDOW && back != remaining.begin(); s++) {
+          offer((--back)->second);
+        }
+      }
+      if (rng && second >= 0 && (*rng)() % 10 == 0) best = second;
+      current = best;
+    }
+  }
+
+  // 改善する手がなくなるか、期限か、キャンセルまで 2-opt と Or-opt を繰り返す
+  // 戻り値は 0=収束または期限, 1=キャンセル
+  int improve(std::chrono::steady_clock::time_point deadline, bool has_deadline,
+              EssentiaCancelFlag* cancel_flag) {
+    position_.assign(n_, 0);
+    for (int p = 0; p < n_; p++) position_[order_[p]] = p;
+    forward_.assign(std::max(n_ - 1, 0), 0.0f);
+    backward_.assign(forward_.size(), 0.0f);
+    for (int p = 0; p + 1 < n_; p++) update_edge(p);
+    update_prefix(0);
+
+    // 丸め誤差で同じ手を往復しないよう、周回数にも上限を設ける
+    for (int pass = 0; pass < MAX_PASSES; pass++) {
+      bool improved = false;
+      for (int i = 0; i < n_; i++) {
+        if (is_cancelled(cancel_flag)) return 1;
+        if (has_deadline && (i & 63) == 0 && std::chrono::steady_clock::now() >= deadline) {
+          return 0;
+        }
+        if (try_two_opt(i) || try_or_opt(i)) improved = true;
+      }
+      if (!improved) break;
+    }
+    return 0;
+  }
+
+  float total() const { return forward_prefix_.empty() ? 0.0f : (float)forward_prefix_.back(); }
+
+  const std::vector<int>& order() const { return order_; }
+
+ private:
+  void update_edge(int p) {
+    forward_[p] = cost_(order_[p], order_[p + 1]);
+    backward_[p] = cost_(order_[p + 1], order_[p]);
+  }
+
+  // 位置 from 以降の辺コストの累積を作り直す。加算だけなのでコスト評価よりずっと軽い
+  void update_prefix(int from) {
+    forward_prefix_.resize(n_);
+    backward_prefix_.resize(n_);
+    if (n_ == 0) return;
+    from = std::max(from, 0);
+    if (from == 0) forward_prefix_[0] = backward_prefix_[0] = 0.0;
+    for (int p = std::max(from, 1); p < n_; p++) {
+      forward_prefix_[p] = forward_prefix_[p - 1] + forward_[p - 1];
+      backward_prefix_[p] = backward_prefix_[p - 1] + backward_[p - 1];
+    }
+  }
+
+  // [first, last) の曲の位置を付け直す
+  void update_positions(int first, int last) {
+    for (int p = first; p < last; p++) position_[order_[p]] = p;
+  }
+
+  // 位置 i の曲の直後に候補を置くよう [i+1, j] を反転する。非対称なので反転区間の内側も差分に入れる
+  bool try_two_opt(int i) {
+    if (i >= n_ - 2) return false;
+    const int a = order_[i];
+    for (int c = 0; c < k_; c++) {
+      const int j = position_[candidates_[(size_t)a * k_ + c]];
+      if (j <= i + 1) continue;
+      const bool hasNext = j + 1 < n_;
+      const double before = forward_[i] + (hasNext ? forward_[j] : 0.0f) +
+                            (forward_prefix_[j] - forward_prefix_[i + 1]);
+      const double after = cost_(a, order_[j]) +
+                           (hasNext ? cost_(order_[i + 1], order_[j + 1]) : 0.0f) +
+                           (backward_prefix_[j] - backward_prefix_[i + 1]);
+      if (after < before - IMPROVEMENT_EPSILON) {
+        // 反転区間の内側の辺は向きが入れ替わるだけなので、評価し直すのは両端の 2 本
+        std::reverse(order_.begin() + i + 1, order_.begin() + j + 1);
+        std::reverse(forward_.begin() + i + 1, forward_.begin() + j);
+        std::reverse(backward_.begin() + i + 1, backward_.begin() + j);
+        std::swap_ranges(forward_.begin() + i + 1, forward_.begin() + j, backward_.begin() + i + 1);
+        update_edge(i);
+        if (hasNext) update_edge(j);
+        update_positions(i + 1, j + 1);
+        update_prefix(i + 1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // 位置 s から始まる 1〜3 曲を、末尾の曲の候補の直前へ向きを保ったまま移す
+  bool try_or_opt(int s) {
+    if (first_ >= 0 && s == 0) return false;
+    for (int len = 1; len <= MAX_OR_OPT_LENGTH; len++) {
+      const int e = s + len - 1;
+      if (e >= n_) break;
+      const int head = order_[s], tail = order_[e];
+      const int prev = s > 0 ? order_[s - 1] : -1;
+      const int next = e + 1 < n_ ? order_[e + 1] : -1;
+      const float removeGain = (prev >= 0 ? forward_[s - 1] : 0.0f) +
+                               (next >= 0 ? forward_[e] : 0.0f) -
+                               (prev >= 0 && next >= 0 ? cost_(prev, next) : 0.0f);
+
+      for (int c = 0; c < k_; c++) {
+        const int target = candidates_[(size_t)tail * k_ + c];
+        const int k = position_[target];
+        if (k >= s && k <= e + 1) continue;
+        if (first_ >= 0 && k == 0) continue;
+        const int before = k > 0 ? order_[k - 1] : -1;
+        const float insertCost =
+            (before >= 0 ? cost_(before, head) - forward_[k - 1] : 0.0f) + cost_(tail, target);
+        if (insertCost < removeGain - IMPROVEMENT_EPSILON) {
+          // 区間の入れ替えとして回転させる。各ブロック内の辺はそのまま動かせる
+          if (k > e) {
+            move_block(s, e + 1, k);
+          } else {
+            move_block(k, s, e + 1);
+          }
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // [first, middle) と [middle, last) を入れ替え、つなぎ目の 3 本の辺だけを評価し直す
+  void move_block(int first, int middle, int last) {
+    const int left = middle - first, right = last - middle;
+    std::rotate(order_.begin() + first, order_.begin() + middle, order_.begin() + last);
+    for (std::vector<float>* edges : {&forward_, &backward_}) {
+      scratch_.assign(edges->begin() + first, edges->begin() + last - 1);
+      // 旧 [first, middle-1) は左ブロック内、旧 [middle, last-1) は右ブロック内の辺
+      std::copy(scratch_.begin() + left, scratch_.end(), edges->begin() + first);
+      std::copy(scratch_.begin(), scratch_.begin() + left - 1,
+                edges->begin() + first + right);
+    }
+    if (first > 0) update_edge(first - 1);
+    update_edge(first + right - 1);
+    if (last < n_) update_edge(last - 1);
+    update_positions(first, last);
+    update_prefix(first);
+  }
+
+  const TransitionCost& cost_;
+  const std::vector<int>& candidates_;
+  const int k_;
+  const int n_;
+  const int first_;
+  std::vector<int> order_;
+  std::vector<int> position_;
+  // forward_[p] は order_[p] から order_[p+1] へ、backward_[p] はその逆向きの辺コスト
+  std::vector<float> forward_;
+  std::vector<float> backward_;
+  std::vector<double> forward_prefix_;
+  std::vector<double> backward_prefix_;
+  std::vector<float> scratch_;
+};
+
+}  // namespace
+
+extern "C" {
+
+int32_t essentia_sequence_tracks(const float* bpm, const int8_t* camelot, const float* energy,
+                                 const float* embeddings, int32_t embedding_dim, int32_t count,
+                                 const EssentiaSequenceOptions* options, int32_t* out_order,
+                                 float* out_cost, EssentiaCancelFlag* cancel_flag) {
+  if (!bpm || !camelot || !energy || !out_order || count <= 0) return 3;
+  const EssentiaSequenceOptions opts = options ? *options : DEFAULT_OPTIONS;
+  const int n = count;
+  const int first = opts.first_track >= 0 && opts.first_track < n ? opts.first_track : -1;
+  const int restarts = opts.restarts > 0 ? opts.restarts : DEFAULT_OPTIONS.restarts;
+
+  LogTimer timer;
+  try {
+    TransitionCost cost(bpm, camelot, energy, embeddings, embedding_dim, n, opts);
+    int k = 0;
+    const std::vector<int> candidates = build_candidates(cost, n, &k);
+    LogTimer search_timer;
+
+    // 固定しない場合、最初の試行はエネルギーの最も低い曲から始める
+    int lowest = 0;
+    for (int i = 1; i < n; i++) {
+      if (energy[i] >= 0 && (energy[lowest] < 0 || energy[i] < energy[lowest])) lowest = i;
+    }
+
+    std::mutex bestMutex;
+    std::vector<int> bestOrder;
+    float bestCost = HUGE_VALF;
+    std::atomic<int> next(0);
+    std::atomic<bool> cancelled(false);
+
+    // 各ワーカーは 1 試行ごとに予算のスロットを 1 つ確保する
+    auto worker = [&]() {
+      Solver solver(cost, candidates, k, n, first);
+      for (;;) {
+        const int r = next.fetch_add(1);
+        if (r >= restarts || cancelled.load()) return;
+        ThreadBudgetGuard budgetGuard(1);
+
+        std::mt19937 rng((uint32_t)r * 2654435761u + 1);
+        const int start = first >= 0 ? first : (r == 0 ? lowest : (int)(rng() % n));
+        solver.construct(start, r == 0 ? nullptr : &rng);
+
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(opts.time_limit_ms);
+        if (solver.improve(deadline, opts.time_limit_ms > 0, cancel_flag) != 0) {
+          cancelled.store(true);
+          return;
+        }
+
+        std::lock_guard<std::mutex> lock(bestMutex);
+        if (solver.total() < bestCost) {
+          bestCost = solver.total();
+          bestOrder = solver.order();
+        }
+      }
+    };
+
+    const int numWorkers =
+        std::max(1, std::min(restarts, ThreadBudget::instance().max_threads()));
+    std::vector<std::thread> threads;
+    for (int w = 1; w < numWorkers; w++) threads.emplace_back(worker);
+    worker();
+    for (std::thread& t : threads) t.join();
+
+    if (cancelled.load() || bestOrder.empty()) return 1;
+
+    std::copy(bestOrder.begin(), bestOrder.end(), out_order);
+    if (out_cost) *out_cost = bestCost;
+
+    LOGI("Sequenced %d tracks: cost %.2f, %d restarts on %d workers, candidates %.0f ms, "
+         "search %.0f ms",
+         n, bestCost, restarts, numWorkers, timer.elapsed_ms() - search_timer.elapsed_ms(),
+         search_timer.elapsed_ms());
+  } catch (const std::bad_alloc&) {
+    return 3;
+  }
+  return 0;
+}
+
+}  // extern "C"
@@ -0,0 +1,42 @@
+#ifndef PLAYLIST_SOLVER_H
+#define PLAYLIST_SOLVER_H
+
+#include "essentia_bridge.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// energy_shape values for EssentiaSequenceOptions.
+#define ESSENTIA_ENERGY_SMOOTH 0  // penalize energy jumps in either direction
+#define ESSENTIA_ENERGY_RISING 1  // additionally penalize drops, so the set builds up
+
+typedef struct {
+  float tempo_weight;      // cost per ~6 % tempo difference (half/double time allowed)
+  float key_weight;        // cost of a far Camelot key; adjacent/relative keys cost half
+  float embedding_weight;  // cost per unit of (1 - cosine similarity) of the embeddings
+  float energy_weight;     // cost per unit of energy change
+  int32_t energy_shape;    // ESSENTIA_ENERGY_*
+  int32_t first_track;     // index that must come first, -1 = free
+  int32_t restarts;        // independent construction + local search runs, <= 0 = 8
+  int32_t time_limit_ms;   // per run improvement budget, <= 0 = until no move improves (at
+                           // most 50 passes)
+} EssentiaSequenceOptions;
+
+// Orders count tracks so that the summed transition cost between neighbours is low: greedy
+// nearest-neighbour construction, then 2-opt and Or-opt moves restricted to each track's
+// cheapest candidates. Restarts run in parallel within the thread budget and the best order
+// wins. Inputs use the same conventions as essentia_track_index_load; embeddings holds
+// count * embedding_dim floats (NULL / 0 = no embedding term). options may be NULL for the
+// defaults. Writes a permutation of 0..count-1 to out_order and its cost to out_cost.
+// Returns 0=success, 1=cancelled, 3=invalid arguments or out of memory.
+int32_t essentia_sequence_tracks(const float* bpm, const int8_t* camelot, const float* energy,
+                                 const float* embeddings, int32_t embedding_dim, int32_t count,
+                                 const EssentiaSequenceOptions* options, int32_t* out_order,
+                                 float* out_cost, EssentiaCancelFlag* cancel_flag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PLAYLIST_SOLVER_H
@@ -0,0 +1,160 @@
+#include "preview_detector.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "simd.h"
+
+static const float MIN_FREQUENCY = 55.0f;
+static const float MAX_FREQUENCY = 3520.0f;
+static const float FLOOR_DB = -80.0f;
+// これより離れた繰り返しは探さない（128 BPM で約 4 分）。長いミックスでも計算量を抑える
+static const int MAX_LAG_BEATS = 512;
+// 対角線をまとめて求めるラグ数と拍数。1 ブロックの特徴量が L1 キャッシュに収まる大きさ
+static const int LAG_BLOCK = 8;
+static const int BEAT_BLOCK = 64;
+// スコアのうち区間の音量の順位で決まる割合
+static const float LOUDNESS_WEIGHT = 0.5f;
+// 最高スコアとの差がこの割合以内なら、曲頭に近い区間を選ぶ（繰り返すサビの 1 回目）
+static const float EARLIER_TOLERANCE = 0.02f;
+
+PreviewDetector::PreviewDetector(int sample_rate)
+    : sample_rate_(sample_rate),
+      chroma_bins_(FRAME_SIZE, sample_rate, MIN_FREQUENCY, MAX_FREQUENCY),
+      bands_(TIMBRE_BANDS, FRAME_SIZE, sample_rate) {}
+
+void PreviewDetector::consume(const std::vector<float>& spectrum) {
+  const size_t offset = frame_features_.size();
+  frame_features_.resize(offset + FEATURE_SIZE);
+  float* row = &frame_features_[offset];
+  chroma_bins_.compute(spectrum, row);
+  bands_.compute(spectrum, row + ChromaBins::PITCH_CLASSES);
+
+  float power = 0;
+  for (int b = 0; b < TIMBRE_BANDS; b++) {
+    power += powf(10.0f, std::max(row[ChromaBins::PITCH_CLASSES + b], FLOOR_DB) / 10.0f);
+  }
+  frame_db_.push_back(10.0f * log10f(power / TIMBRE_BANDS));
+}
+
+// v[0, n) を L2 正規化して scale を掛ける。ゼロベクトルはそのまま
+static void normalize(float* v, int n, float scale) {
+  float norm = 0;
+  for (int i = 0; i < n; i++) norm += v[i] * v[i];
+  if (norm <= 1e-20f) return;
+  const float inv = scale / sqrtf(norm);
+  for (int i = 0; i < n; i++) v[i] *= inv;
+}
+
+bool PreviewDetector::detect(const std::vector<float>& ticks, int segment_beats,
+                             float* start_sec, float* end_sec, float* score) const {
+  const int numBeats = (int)ticks.size();
+  const int numFrames = (int)frame_db_.size();
+  const int L = segment_beats;
+  if (L <= 0 || numBeats < 2 * L || numFrames == 0) return false;
+
+  // 拍ごとにフレームをまとめる（区間の取り方は MixPointDetector と同じ）
+  const float frameSec = (float)HOP_SIZE / sample_rate_;
+  std::vector<float> features((size_t)numBeats * FEATURE_SIZE, 0.0f);
+  std::vector<float> beatDb(numBeats);
+  for (int i = 0; i < numBeats; i++) {
+    float begin = ticks[i];
+    float end = i + 1 < numBeats ? ticks[i + 1] : begin + (ticks[i] - ticks[i - 1]);
+    int f0 = std::min((int)lroundf(begin / frameSec), numFrames - 1);
+    int f1 = std::min(std::max((int)lroundf(end / frameSec), f0 + 1), numFrames);
+    float* out = &features[(size_t)i * FEATURE_SIZE];
+    double power = 0;
+    for (int f = f0; f < f1; f++) {
+      const float* row = &frame_features_[(size_t)f * FEATURE_SIZE];
+      for (int d = 0; d < FEATURE_SIZE; d++) out[d] += row[d];
+      power += pow(10.0, frame_db_[f] / 10.0);
+    }
+    for (int d = 0; d < FEATURE_SIZE; d++) out[d] /= (f1 - f0);
+    beatDb[i] = 10.0f * log10f((float)(power / (f1 - f0)));
+  }
+
+  // 音色は曲全体の平均を引き、音量ではなく響きの違いだけを比べる
+  float timbreMean[TIMBRE_BANDS] = {};
+  for (int i = 0; i < numBeats; i++) {
+    const float* timbre = &features[(size_t)i * FEATURE_SIZE + ChromaBins::PITCH_CLASSES];
+    for (int b = 0; b < TIMBRE_BANDS; b++) timbreMean[b] += timbre[b] / numBeats;
+  }
+  // クロマと音色を別々に正規化して半分ずつの重みで並べ、内積が -1..1 の類似度になるようにする
+  const float half = sqrtf(0.5f);
+  for (int i = 0; i < numBeats; i++) {
+    float* row = &features[(size_t)i * FEATURE_SIZE];
+    float* timbre = row + ChromaBins::PITCH_CLASSES;
+    for (int b = 0; b < TIMBRE_BANDS; b++) timbre[b] -= timbreMean[b];
+    normalize(row, ChromaBins::PITCH_CLASSES, half);
+    normalize(timbre, TIMBRE_BANDS, half);
+  }
+
+  // repeat[i] は拍 i からの L 拍と、重ならない別の L 拍との平均類似度の最大値
+  // 類似度はラグごとの対角線として求め、N×N の行列は持たない
+  const int numStarts = numBeats - L + 1;
+  const int maxLag = std::min(numBeats - L, MAX_LAG_BEATS);
+  std::vector<float> repeat(numStarts, 0.0f);
+  std::vector<float> diagonal((size_t)LAG_BLOCK * numBeats);
+  for (int lag0 = L; lag0 <= maxLag; lag0 += LAG_BLOCK) {
+    const int lags = std::min(LAG_BLOCK, maxLag - lag0 + 1);
+
+    // 拍のブロックを固定して LAG_BLOCK 本の対角線を進め、同じ特徴量をキャッシュ上で使い回す
+    for (int k0 = 0; k0 + lag0 < numBeats; k0 += BEAT_BLOCK) {
+      for (int l = 0; l < lags; l++) {
+        const int lag = lag0 + l;
+        const int k1 = std::min(k0 + BEAT_BLOCK, numBeats - lag);
+        float* diag = &diagonal[(size_t)l * numBeats];
+        for (int k = k0; k < k1; k++) {
+          diag[k] = simd::dot(&features[(size_t)k * FEATURE_SIZE],
+                              &features[(size_t)(k + lag) * FEATURE_SIZE], FEATURE_SIZE);
+        }
+      }
+    }
+
+    // 長さ L の移動和で区間どうしの平均類似度にし、両方の区間の repeat を更新する
+    for (int l = 0; l < lags; l++) {
+      const int lag = lag0 + l;
+      const int length = numBeats - lag;
+      const float* diag = &diagonal[(size_t)l * numBeats];
+      float sum = 0;
+      for (int k = 0; k < L; k++) sum += diag[k];
+      for (int i = 0;; i++) {
+        const float mean = sum / L;
+        repeat[i] = std::max(repeat[i], mean);
+        repeat[i + lag] = std::max(repeat[i + lag], mean);
+        if (i + L >= length) break;
+        sum += diag[i + L] - diag[i];
+      }
+    }
+  }
+
+  // 区間の音量を順位（0..1）にして、繰り返しの強さに掛ける
+  std::vector<float> segmentDb(numStarts);
+  double sum = 0;
+  for (int k = 0; k < L; k++) sum += beatDb[k];
+  for (int i = 0; i < numStarts; i++) {
+    segmentDb[i] = (float)(sum / L);
+    if (i + L < numBeats) sum += beatDb[i + L] - beatDb[i];
+  }
+  std::vector<float> sortedDb(segmentDb);
+  std::sort(sortedDb.begin(), sortedDb.end());
+
+  std::vector<float> scores(numStarts);
+  float bestScore = 0.0f;
+  for (int i = 0; i < numStarts; i++) {
+    const int rank =
+        (int)(std::lower_bound(sortedDb.begin(), sortedDb.end(), segmentDb[i]) - sortedDb.begin());
+    const float loudness = numStarts > 1 ? (float)rank / (numStarts - 1) : 1.0f;
+    scores[i] =
+        std::max(0.0f, repeat[i]) * ((1.0f - LOUDNESS_WEIGHT) + LOUDNESS_WEIGHT * loudness);
+    bestScore = std::max(bestScore, scores[i]);
+  }
+  int best = 0;
+  while (scores[best] < bestScore * (1.0f - EARLIER_TOLERANCE)) best++;
+
+  *start_sec = ticks[best];
+  const float lastBeat = ticks[numBeats - 1] - ticks[numBeats - 2];
+  *end_sec = best + L < numBeats ? ticks[best + L] : ticks[numBeats - 1] + lastBeat;
+  *score = bestScore;
+  return true;
+}
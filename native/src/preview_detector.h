@@ -0,0 +1,39 @@
+#ifndef PREVIEW_DETECTOR_H
+#define PREVIEW_DETECTOR_H
+
+#include <vector>
+
+#include "frame_engine.h"
+#include "spectrum_bands.h"
+
+// 調の推定と同じ 4096 サンプルのフレームからクロマと音色（対数バンド）を記録し、
+// 拍ごとにまとめた特徴の自己相似から、曲中で最も繰り返され音量の大きい区間（サビ）を探す
+// 自己相似行列は作らず、ラグごとの対角線をブロック単位で求めるためメモリは拍数に比例する
+// Essentia のアルゴリズムは使わないのでグローバルロックは不要
+class PreviewDetector : public FrameConsumer {
+ public:
+  static const int FRAME_SIZE = 4096;
+  static const int HOP_SIZE = 4096;
+
+  explicit PreviewDetector(int sample_rate);
+
+  void consume(const std::vector<float>& spectrum) override;
+
+  // 拍位置 ticks（曲頭からの秒）から segment_beats 拍の区間を選び、先頭と末尾（秒）と
+  // 0..1 のスコアを書いて true を返す。拍が足りなければ false
+  // 全曲を 1 区間として consume した場合にだけ呼ぶこと（フレームの時刻を曲頭から数えるため）
+  bool detect(const std::vector<float>& ticks, int segment_beats, float* start_sec,
+              float* end_sec, float* score) const;
+
+ private:
+  static const int TIMBRE_BANDS = 12;
+  static const int FEATURE_SIZE = ChromaBins::PITCH_CLASSES + TIMBRE_BANDS;
+
+  int sample_rate_;
+  ChromaBins chroma_bins_;
+  SpectrumBands bands_;
+  std::vector<float> frame_features_;  // フレームごとにクロマのパワー 12 個と音色の dB 12 個
+  std::vector<float> frame_db_;        // フレームのパワー（dB）
+};
+
+#endif  // PREVIEW_DETECTOR_H
@@ -0,0 +1,162 @@
+#include "realtime_analyzer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <new>
+#include <vector>
+
+#include <unsupported/Eigen/FFT>
+
+#include "pcm_ring.h"
+#include "spectrum_bands.h"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "RealtimeAnalyzer"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGI(...)
+#endif
+
+// 1 回の poll で読み出すブロック（フレーム数）
+static const int READ_BLOCK_FRAMES = 1024;
+
+struct RealtimeAnalyzer {
+  int channels;
+  int frame_size;
+  PcmRing ring;
+  std::atomic<int32_t> dropped{0};
+
+  // 以下は読み出し側（poll）だけが触る
+  SpectrumBands bands;
+  std::vector<float> band_values;
+  std::vector<float> scratch;
+  std::vector<float> history;  // 直近 frame_size サンプルのモノラル信号（循環）
+  int history_pos = 0;
+  std::vector<float> window;
+  std::vector<float> frame;
+  std::vector<std::complex<float> > bins;
+  std::vector<float> spectrum;
+  Eigen::FFT<float> fft;
+
+  RealtimeAnalyzer(int sample_rate, int num_channels, int num_bands, int size,
+                   int capacity_frames)
+      : channels(num_channels),
+        frame_size(size),
+        ring((size_t)capacity_frames * num_channels),
+        bands(num_bands, size, sample_rate),
+        band_values(num_bands, -100.0f),
+        scratch(READ_BLOCK_FRAMES * num_channels),
+        history(size, 0.0f),
+        window(size),
+        frame(size),
+        spectrum(size / 2 + 1) {
+    // FrameEngine と同じ対称 Hann 窓（オフライン解析と同じ尺度の dB になる）
+    for (int i = 0; i < size; i++) {
+      window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (float)(size - 1));
+    }
+    fft.SetFlag(Eigen::FFT<float>::HalfSpectrum);
+  }
+};
+
+static float peak_db(float peak) { return peak > 1e-7f ? 20.0f * log10f(peak) : -100.0f; }
+
+extern "C" {
+
+RealtimeAnalyzer* essentia_realtime_create(int32_t sample_rate, int32_t channels,
+                                           int32_t num_bands, int32_t frame_size,
+                                           int32_t capacity_frames) {
+  if (sample_rate <= 0 || (channels != 1 && channels != 2) || num_bands <= 0 ||
+      frame_size < 2 || frame_size % 2 != 0) {
+    return nullptr;
+  }
+  if (capacity_frames <= 0) capacity_frames = sample_rate / 2;
+
+  RealtimeAnalyzer* analyzer = new (std::nothrow)
+      RealtimeAnalyzer(sample_rate, channels, num_bands, frame_size, capacity_frames);
+  if (analyzer) {
+    LOGI("Realtime analyzer: %d Hz, %d ch, %d bands, frame %d, ring %zu samples", sample_rate,
+         channels, num_bands, frame_size, analyzer->ring.capacity());
+  }
+  return analyzer;
+}
+
+int32_t essentia_realtime_push(RealtimeAnalyzer* analyzer, const float* interleaved,
+                               int32_t num_frames) {
+  if (!analyzer || !interleaved || num_frames <= 0) return 0;
+
+  // フレームの途中で切れないよう、空きをフレーム単位に切り捨てて書き込む
+  const int channels = analyzer->channels;
+  int32_t frames = (int32_t)std::min<size_t>(num_frames, analyzer->ring.writable() / channels);
+  analyzer->ring.write(interleaved, (size_t)frames * channels);
+  if (frames < num_frames) {
+    analyzer->dropped.fetch_add(num_frames - frames, std::memory_order_relaxed);
+  }
+  return frames;
+}
+
+int32_t essentia_realtime_poll(RealtimeAnalyzer* analyzer, RealtimeFrame* out) {
+  if (!analyzer || !out) return 0;
+
+  const int channels = analyzer->channels;
+  const int size = analyzer->frame_size;
+  // 書き込みが続いても poll が終わるよう、1 回で読むのはリング 1 周分まで
+  const size_t limit = analyzer->ring.capacity() / channels;
+
+  float maxL = 0, maxR = 0;
+  size_t consumed = 0;
+  while (consumed < limit) {
+    size_t frames = analyzer->ring.read(analyzer->scratch.data(), analyzer->scratch.size()) /
+                    channels;
+    if (frames == 0) break;
+
+    const float* samples = analyzer->scratch.data();
+    for (size_t i = 0; i < frames; i++) {
+      float left = samples[i * channels];
+      float right = channels == 2 ? samples[i * channels + 1] : left;
+      maxL = std::max(maxL, std::abs(left));
+      maxR = std::max(maxR, std::abs(right));
+
+      analyzer->history[analyzer->history_pos] = 0.5f * (left + right);
+      analyzer->history_pos = analyzer->history_pos + 1 == size ? 0 : analyzer->history_pos + 1;
+    }
+    consumed += frames;
+  }
+
+  if (consumed > 0) {
+    // 最新の frame_size サンプルを古い順に並べて窓を掛ける
+    for (int i = 0; i < size; i++) {
+      int idx = analyzer->history_pos + i;
+      if (idx >= size) idx -= size;
+      analyzer->frame[i] = analyzer->history[idx] * analyzer->window[i];
+    }
+    analyzer->fft.fwd(analyzer->bins, analyzer->frame);
+    for (int k = 0; k <= size / 2; k++) {
+      analyzer->spectrum[k] = std::abs(analyzer->bins[k]);
+    }
+    analyzer->bands.compute(analyzer->spectrum, analyzer->band_values.data());
+  }
+
+  out->bands = analyzer->band_values.data();
+  out->num_bands = analyzer->bands.num_bands();
+  out->left_peak = peak_db(maxL);
+  out->right_peak = peak_db(maxR);
+  out->clip_flags = (maxL >= 1.0f ? 1 : 0) | (maxR >= 1.0f ? 2 : 0);
+  out->frames_consumed = (int32_t)consumed;
+  out->frames_dropped = analyzer->dropped.exchange(0, std::memory_order_relaxed);
+  return consumed > 0 ? 1 : 0;
+}
+
+void essentia_realtime_reset(RealtimeAnalyzer* analyzer) {
+  if (!analyzer) return;
+  analyzer->ring.clear();
+  std::fill(analyzer->history.begin(), analyzer->history.end(), 0.0f);
+  std::fill(analyzer->band_values.begin(), analyzer->band_values.end(), -100.0f);
+  analyzer->history_pos = 0;
+}
+
+void essentia_realtime_destroy(RealtimeAnalyzer* analyzer) { delete analyzer; }
+
+}  // extern "C"
@@ -0,0 +1,48 @@
+#ifndef REALTIME_ANALYZER_H
+#define REALTIME_ANALYZER_H
+
+#include "essentia_bridge.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct RealtimeAnalyzer RealtimeAnalyzer;
+
+typedef struct {
+  const float* bands;  // num_bands dB values of the newest frame_size samples (owned, see poll)
+  int32_t num_bands;
+  float left_peak;         // dB over the samples consumed by this poll, -100 if none
+  float right_peak;        // dB, same as left_peak for mono input
+  uint8_t clip_flags;      // bit0=left clipped, bit1=right clipped
+  int32_t frames_consumed; // sample frames drained from the ring by this poll
+  int32_t frames_dropped;  // sample frames rejected by push since the previous poll (ring full)
+} RealtimeFrame;
+
+// Analyzes PCM as it is played instead of decoding the file up front. The player pushes
+// interleaved float samples into a lock-free single-producer/single-consumer ring; the display
+// polls once per frame. The bands match essentia_compute_spectrum for the same frame size when
+// sample_rate is 44100. capacity_frames bounds the latency (<= 0 = 0.5 s). Returns NULL for
+// unsupported arguments (channels must be 1 or 2).
+RealtimeAnalyzer* essentia_realtime_create(int32_t sample_rate, int32_t channels,
+                                           int32_t num_bands, int32_t frame_size,
+                                           int32_t capacity_frames);
+
+// Producer thread only; never blocks or allocates. Returns the number of frames accepted.
+int32_t essentia_realtime_push(RealtimeAnalyzer* analyzer, const float* interleaved,
+                               int32_t num_frames);
+
+// Consumer thread only. Drains the ring and fills out; out->bands stays valid until the next
+// poll or reset. Returns 1 if new samples were consumed, 0 if out repeats the previous bands.
+int32_t essentia_realtime_poll(RealtimeAnalyzer* analyzer, RealtimeFrame* out);
+
+// Consumer thread only. Drops pending samples and the analysis history, e.g. after a seek.
+void essentia_realtime_reset(RealtimeAnalyzer* analyzer);
+
+void essentia_realtime_destroy(RealtimeAnalyzer* analyzer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // REALTIME_ANALYZER_H
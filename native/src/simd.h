@@ -0,0 +1,176 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#endif
+
+// 特徴量配列向けの小さな SIMD ヘルパ。arm64 は NEON、x86 は SSE2、それ以外はスカラーで同じ値を返す
+namespace simd {
+
+// n > 0 のときだけ呼ぶこと
+inline void min_max(const float* in, size_t n, float* out_min, float* out_max) {
+  size_t i = 0;
+  float lo = in[0], hi = in[0];
+#if defined(SIMD_NEON)
+  if (n >= 4) {
+    float32x4_t vlo = vld1q_f32(in), vhi = vlo;
+    for (i = 4; i + 4 <= n; i += 4) {
+      float32x4_t v = vld1q_f32(in + i);
+      vlo = vminq_f32(vlo, v);
+      vhi = vmaxq_f32(vhi, v);
+    }
+    lo = vminvq_f32(vlo);
+    hi = vmaxvq_f32(vhi);
+  }
+#elif defined(SIMD_SSE2)
+  if (n >= 4) {
+    __m128 vlo = _mm_loadu_ps(in), vhi = vlo;
+    for (i = 4; i + 4 <= n; i += 4) {
+      __m128 v = _mm_loadu_ps(in + i);
+      vlo = _mm_min_ps(vlo, v);
+      vhi = _mm_max_ps(vhi, v);
+    }
+    float l[4], h[4];
+    _mm_storeu_ps(l, vlo);
+    _mm_storeu_ps(h, vhi);
+    lo = std::min(std::min(l[0], l[1]), std::min(l[2], l[3]));
+    hi = std::max(std::max(h[0], h[1]), std::max(h[2], h[3]));
+  }
+#endif
+  for (; i < n; i++) {
+    lo = std::min(lo, in[i]);
+    hi = std::max(hi, in[i]);
+  }
+  *out_min = lo;
+  *out_max = hi;
+}
+
+// out[i] = clamp(round((in[i] - offset) * inv_scale), 0, 255)
+inline void quantize_u8(const float* in, size_t n, float offset, float inv_scale, uint8_t* out) {
+  size_t i = 0;
+#if defined(SIMD_NEON)
+  const float32x4_t voff = vdupq_n_f32(offset), vinv = vdupq_n_f32(inv_scale);
+  const float32x4_t vhalf = vdupq_n_f32(0.5f), vzero = vdupq_n_f32(0.0f),
+                    vmax = vdupq_n_f32(255.0f);
+  for (; i + 8 <= n; i += 8) {
+    float32x4_t a = vmulq_f32(vsubq_f32(vld1q_f32(in + i), voff), vinv);
+    float32x4_t b = vmulq_f32(vsubq_f32(vld1q_f32(in + i + 4), voff), vinv);
+    a = vminq_f32(vmaxq_f32(vaddq_f32(a, vhalf), vzero), vmax);
+    b = vminq_f32(vmaxq_f32(vaddq_f32(b, vhalf), vzero), vmax);
+    uint16x8_t h = vcombine_u16(vmovn_u32(vcvtq_u32_f32(a)), vmovn_u32(vcvtq_u32_f32(b)));
+    vst1_u8(out + i, vmovn_u16(h));
+  }
+#elif defined(SIMD_SSE2)
+  const __m128 voff = _mm_set1_ps(offset), vinv = _mm_set1_ps(inv_scale);
+  const __m128 vhalf = _mm_set1_ps(0.5f), vzero = _mm_setzero_ps(), vmax = _mm_set1_ps(255.0f);
+  for (; i + 16 <= n; i += 16) {
+    __m128i q[4];
+    for (int j = 0; j < 4; j++) {
+      __m128 v = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(in + i + j * 4), voff), vinv);
+      v = _mm_min_ps(_mm_max_ps(_mm_add_ps(v, vhalf), vzero), vmax);
+      q[j] = _mm_cvttps_epi32(v);
+    }
+    __m128i lo = _mm_packs_epi32(q[0], q[1]);
+    __m128i hi = _mm_packs_epi32(q[2], q[3]);
+    _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < n; i++) {
+    float v = (in[i] - offset) * inv_scale + 0.5f;
+    v = std::min(std::max(v, 0.0f), 255.0f);
+    out[i] = (uint8_t)v;
+  }
+}
+
+// a と b の内積。n は 4 の倍数でなくてもよい
+inline float dot(const float* a, const float* b, size_t n) {
+  size_t i = 0;
+  float sum = 0;
+#if defined(SIMD_NEON)
+  float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+  for (; i + 8 <= n; i += 8) {
+    acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+  for (; i + 4 <= n; i += 4) acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+  sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#elif defined(SIMD_SSE2)
+  __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  for (; i + 4 <= n; i += 4) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+  sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+  for (; i < n; i++) sum += a[i] * b[i];
+  return sum;
+}
+
+// lo[r] <= in[i] <= hi[r] を満たす r が 1 つでもある i を out に昇順で書き、その個数を返す
+// out は n 個分の領域を持つこと。NaN はどの範囲にも入らない
+inline size_t range_scan(const float* in, size_t n, const float* lo, const float* hi,
+                         int num_ranges, uint32_t* out) {
+  size_t count = 0, i = 0;
+#if defined(SIMD_NEON)
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t v = vld1q_f32(in + i);
+    uint32x4_t hit = vdupq_n_u32(0);
+    for (int r = 0; r < num_ranges; r++) {
+      uint32x4_t inside = vandq_u32(vcgeq_f32(v, vdupq_n_f32(lo[r])),
+                                    vcleq_f32(v, vdupq_n_f32(hi[r])));
+      hit = vorrq_u32(hit, inside);
+    }
+    // 分岐の予測が外れないよう、該当しないレーンも書いてから個数だけ進める
+    uint32_t lanes[4];
+    vst1q_u32(lanes, hit);
+    for (int j = 0; j < 4; j++) {
+      out[count] = (uint32_t)(i + j);
+      count += lanes[j] & 1;
+    }
+  }
+#elif defined(SIMD_SSE2)
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(in + i);
+    __m128 hit = _mm_setzero_ps();
+    for (int r = 0; r < num_ranges; r++) {
+      __m128 inside = _mm_and_ps(_mm_cmpge_ps(v, _mm_set1_ps(lo[r])),
+                                 _mm_cmple_ps(v, _mm_set1_ps(hi[r])));
+      hit = _mm_or_ps(hit, inside);
+    }
+    // 分岐の予測が外れないよう、該当しないレーンも書いてから個数だけ進める
+    const int mask = _mm_movemask_ps(hit);
+    for (int j = 0; j < 4; j++) {
+      out[count] = (uint32_t)(i + j);
+      count += (mask >> j) & 1;
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    for (int r = 0; r < num_ranges; r++) {
+      if (in[i] >= lo[r] && in[i] <= hi[r]) {
+        out[count++] = (uint32_t)i;
+        break;
+      }
+    }
+  }
+  return count;
+}
+
+}  // namespace simd
+
+#endif  // SIMD_H
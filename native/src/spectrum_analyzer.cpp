@@ -4,11 +4,15 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
-#include <memory>
 #include <vector>
 
-#include "audio_decode.h"
 #include "essentia_lock.h"
+#include "frame_engine.h"
+#include "loudness.h"
+#include "simd.h"
+#include "spectrum_bands.h"
+#include "thread_budget.h"
+#include "track_audio.h"
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -20,185 +24,181 @@
 #define LOGE(...)
 #endif
 
-#include <essentia/algorithmfactory.h>
-#include <essentia/essentiamath.h>
-
-using namespace essentia;
-using namespace essentia::standard;
-
 static const int SPECTRUM_SR = 44100;
 
 static bool is_cancelled(EssentiaCancelFlag* flag) {
   return essentia_cancel_flag_is_set(flag) != 0;
 }
 
-extern "C" {
-
-SpectrumData* essentia_compute_spectrum(const char* path, int32_t num_bands, int32_t frame_size,
-                                        int32_t hop_size, EssentiaCancelFlag* cancel_flag) {
+// 戻り値は error_code（0=成功, 1=キャンセル, 2=デコード失敗）
+// Essentia のロックはデコード中だけ持つ。FFT は FrameEngine（Eigen）で行うため不要
+static int decode_spectrum_audio(TrackAudio& track, const std::vector<float>** audio,
+                                 EssentiaCancelFlag* cancel_flag) {
   std::lock_guard<std::mutex> essentiaGuard(essentiaGlobalMutex());
 
-  SpectrumData* data = (SpectrumData*)malloc(sizeof(SpectrumData));
-  if (!data) return nullptr;
+  int decode_ret = track.mono(SPECTRUM_SR, audio);
+  if (decode_ret != 0) return decode_ret;
+  if (is_cancelled(cancel_flag)) return 1;
 
-  data->bands = nullptr;
-  data->num_frames = 0;
-  data->num_bands = num_bands;
-  data->hop_duration = (float)hop_size / (float)SPECTRUM_SR;
-  data->error_code = 0;
+  LOGI("Decoded %zu samples (%.1f seconds)", (*audio)->size(),
+       (float)(*audio)->size() / SPECTRUM_SR);
+  return 0;
+}
 
-  LOGI("Computing spectrum: path=%s, bands=%d, frameSize=%d, hopSize=%d", path, num_bands,
-       frame_size, hop_size);
+// 無音フレームの -100 dB を下限とし、曲ごとの最小〜最大を 256 段に割り当てる
+static void quantize_bands(const float* bands, size_t count, uint8_t* out, float* db_offset,
+                           float* db_scale) {
+  float lo = -100.0f, hi = 0.0f;
+  if (count > 0) simd::min_max(bands, count, &lo, &hi);
+  lo = std::max(lo, -100.0f);
+  hi = std::max(hi, lo + 1.0f);
+
+  const float scale = (hi - lo) / 255.0f;
+  simd::quantize_u8(bands, count, lo, 1.0f / scale, out);
+  *db_offset = lo;
+  *db_scale = scale;
+}
 
-  std::vector<float> audio;
-  int decode_ret = decode_audio(path, audio, SPECTRUM_SR, cancel_flag);
-  if (decode_ret < 0) {
-    data->error_code = 2;
-    return data;
-  }
-  if (decode_ret == 1 || is_cancelled(cancel_flag)) {
-    data->error_code = 1;
-    return data;
-  }
+static inline bool is_audible(const std::vector<float>& left, const std::vector<float>& right,
+                              size_t i, float threshold) {
+  return std::abs(left[i]) >= threshold || std::abs(right[i]) >= threshold;
+}
 
-  if (audio.empty()) {
-    LOGE("No audio samples decoded");
-    data->error_code = 2;
-    return data;
+// 音のある区間 [start, end) をサンプル単位で求める
+// ホップのピーク（dB）でしきい値を越える最初と最後のホップを探し、その中だけを 1 サンプルずつ見る
+// ホップに満たない末尾はピーク配列に無いため、終端側は先に直接調べる
+static void find_content_bounds(const std::vector<float>& left, const std::vector<float>& right,
+                                const std::vector<float>& leftPeaks,
+                                const std::vector<float>& rightPeaks, int hop_size,
+                                float start_db, float end_db, size_t* start, size_t* end) {
+  const size_t n = left.size();
+  const int totalFrames = (int)leftPeaks.size();
+  const float startThreshold = powf(10.0f, start_db / 20.0f);
+  const float endThreshold = powf(10.0f, end_db / 20.0f);
+
+  *start = n;
+  for (int f = 0; f < totalFrames && *start == n; f++) {
+    if (std::max(leftPeaks[f], rightPeaks[f]) < start_db) continue;
+    const size_t hopEnd = (size_t)(f + 1) * hop_size;
+    for (size_t i = (size_t)f * hop_size; i < hopEnd; i++) {
+      if (is_audible(left, right, i, startThreshold)) {
+        *start = i;
+        break;
+      }
+    }
   }
 
-  LOGI("Decoded %zu samples (%.1f seconds)", audio.size(), (float)audio.size() / SPECTRUM_SR);
-
-  if (is_cancelled(cancel_flag)) {
-    data->error_code = 1;
-    return data;
+  *end = 0;
+  const size_t tail = (size_t)totalFrames * hop_size;
+  for (size_t i = n; i > tail; i--) {
+    if (is_audible(left, right, i - 1, endThreshold)) {
+      *end = i;
+      break;
+    }
   }
-
-  AlgorithmFactory& factory = AlgorithmFactory::instance();
-
-  // 対数等間隔のバンド境界を FFT ビンのインデックスに変換（20 Hz – 20 kHz）
-  int spectrum_size = frame_size / 2 + 1;
-  std::vector<float> bin_edges(num_bands + 1);
-  for (int i = 0; i <= num_bands; i++) {
-    float freq = 20.0f * powf(20000.0f / 20.0f, (float)i / num_bands);
-    bin_edges[i] = freq * frame_size / (float)SPECTRUM_SR;
+  for (int f = totalFrames - 1; f >= 0 && *end == 0; f--) {
+    if (std::max(leftPeaks[f], rightPeaks[f]) < end_db) continue;
+    const size_t hopBegin = (size_t)f * hop_size;
+    for (size_t i = hopBegin + hop_size; i > hopBegin; i--) {
+      if (is_audible(left, right, i - 1, endThreshold)) {
+        *end = i;
+        break;
+      }
+    }
   }
 
-  // コヒーレントゲイン（0.5）を正規化に反映
-  float norm_sq = (frame_size * 0.25f) * (frame_size * 0.25f);
-
-  // バンド補正：帯域幅正規化（1 kHz 基準）+ スロープ補正（dB/oct）
-  static constexpr float kSlopeDBoct = 4.5f;
-  float band_ratio = powf(20000.0f / 20.0f, 1.0f / num_bands);
-  float ref_bw = 1000.0f * (band_ratio - 1.0f) * frame_size / (float)SPECTRUM_SR;
-  std::vector<float> band_correction(num_bands);
-  for (int b = 0; b < num_bands; b++) {
-    float bw = bin_edges[b + 1] - bin_edges[b];
-    float center_freq = 20.0f * powf(1000.0f, ((float)b + 0.5f) / num_bands);
-    band_correction[b] = 10.0f * log10f(ref_bw / bw) + kSlopeDBoct * log2f(center_freq / 1000.0f);
+  // 全体が無音、またはしきい値の組み合わせで区間が空になる場合は切り詰めない
+  if (*start >= *end) {
+    *start = 0;
+    *end = n;
   }
+}
 
-  std::vector<std::vector<float> > all_frames;
-
-  try {
-    std::vector<float> current_frame;
-    std::vector<float> windowed_frame;
-    std::vector<float> spectrum_out;
-
-    std::unique_ptr<Algorithm> frameCutter(factory.create(
-        "FrameCutter", "frameSize", frame_size, "hopSize", hop_size, "startFromZero", false));
-    std::unique_ptr<Algorithm> windowing(
-        factory.create("Windowing", "type", "hann", "size", frame_size, "normalized", false));
-    std::unique_ptr<Algorithm> spec(factory.create("Spectrum", "size", frame_size));
-
-    frameCutter->input("signal").set(audio);
-    frameCutter->output("frame").set(current_frame);
-
-    windowing->input("frame").set(current_frame);
-    windowing->output("frame").set(windowed_frame);
-
-    spec->input("frame").set(windowed_frame);
-    spec->output("spectrum").set(spectrum_out);
+static SpectrumData* compute_spectrum(TrackAudio& track, int32_t num_bands, int32_t frame_size,
+                                      int32_t hop_size, EssentiaCancelFlag* cancel_flag) {
+  ThreadBudgetGuard budgetGuard(1);
 
-    int frame_count = 0;
-    while (true) {
-      frameCutter->compute();
-      if (current_frame.empty()) break;
+  SpectrumData* data = (SpectrumData*)malloc(sizeof(SpectrumData));
+  if (!data) return nullptr;
 
-      if (frame_count % 1000 == 0 && is_cancelled(cancel_flag)) {
-        data->error_code = 1;
-        return data;
-      }
+  data->bands = nullptr;
+  data->num_frames = 0;
+  data->num_bands = num_bands;
+  data->hop_duration = (float)hop_size / (float)SPECTRUM_SR;
+  data->error_code = 0;
 
-      windowing->compute();
-      spec->compute();
-
-      std::vector<float> bands(num_bands);
-      for (int b = 0; b < num_bands; b++) {
-        float sum = 0;
-        int k_start = (int)bin_edges[b];
-        int k_end = (int)std::ceil(bin_edges[b + 1]);
-        if (k_end > spectrum_size) k_end = spectrum_size;
-
-        for (int k = std::max(0, k_start); k < k_end; k++) {
-          float w_low = std::max((float)k, bin_edges[b]);
-          float w_high = std::min((float)(k + 1), bin_edges[b + 1]);
-          float weight = w_high - w_low;
-          if (weight > 0) {
-            sum += spectrum_out[k] * spectrum_out[k] * weight;
-          }
-        }
-
-        bands[b] = (sum > 1e-14f) ? 10.0f * log10f(sum / norm_sq) + band_correction[b] : -100.0f;
-      }
+  LOGI("Computing spectrum: path=%s, bands=%d, frameSize=%d, hopSize=%d", track.path(),
+       num_bands, frame_size, hop_size);
 
-      all_frames.push_back(bands);
-      frame_count++;
-    }
-  } catch (const std::exception& e) {
-    LOGE("Spectrum analysis error: %s", e.what());
-    data->error_code = 3;
-    return data;
-  }
+  const std::vector<float>* audio = nullptr;
+  data->error_code = decode_spectrum_audio(track, &audio, cancel_flag);
+  if (data->error_code != 0) return data;
 
-  if (all_frames.empty()) {
-    LOGE("No frames computed");
+  int total_frames = FrameEngine::frame_count(audio->size(), hop_size);
+  data->bands = (float*)malloc(sizeof(float) * total_frames * num_bands);
+  if (!data->bands) {
+    LOGE("Failed to allocate bands array");
     data->error_code = 3;
     return data;
   }
 
-  if (is_cancelled(cancel_flag)) {
+  FrameEngine engine(SPECTRUM_SR);
+  SpectrumBandWriter writer(num_bands, frame_size, SPECTRUM_SR, data->bands);
+  engine.add_consumer(frame_size, hop_size, &writer);
+  if (engine.run(*audio, cancel_flag) != 0) {
     data->error_code = 1;
     return data;
   }
 
-  int total_frames = (int)all_frames.size();
   data->num_frames = total_frames;
-  data->bands = (float*)malloc(sizeof(float) * total_frames * num_bands);
-  if (!data->bands) {
-    LOGE("Failed to allocate bands array");
+  LOGI("Spectrum computed: %d frames x %d bands", total_frames, num_bands);
+  return data;
+}
+
+SpectrumDataU8* compute_track_spectrum_u8(TrackAudio& audio, int32_t num_bands,
+                                          int32_t frame_size, int32_t hop_size,
+                                          EssentiaCancelFlag* cancel_flag) {
+  SpectrumDataU8* data = (SpectrumDataU8*)malloc(sizeof(SpectrumDataU8));
+  if (!data) return nullptr;
+
+  data->bands = nullptr;
+  data->num_frames = 0;
+  data->num_bands = num_bands;
+  data->hop_duration = (float)hop_size / (float)SPECTRUM_SR;
+  data->db_offset = -100.0f;
+  data->db_scale = 0.0f;
+  data->error_code = 0;
+
+  SpectrumData* source = compute_spectrum(audio, num_bands, frame_size, hop_size, cancel_flag);
+  if (!source) {
     data->error_code = 3;
     return data;
   }
-
-  for (int f = 0; f < total_frames; f++) {
-    memcpy(data->bands + f * num_bands, all_frames[f].data(), sizeof(float) * num_bands);
+  data->error_code = source->error_code;
+
+  if (source->error_code == 0) {
+    size_t count = (size_t)source->num_frames * num_bands;
+    data->bands = (uint8_t*)malloc(count > 0 ? count : 1);
+    if (data->bands) {
+      quantize_bands(source->bands, count, data->bands, &data->db_offset, &data->db_scale);
+      data->num_frames = source->num_frames;
+      LOGI("Spectrum quantized: %zu values, %.1f dB + n * %.3f dB", count, data->db_offset,
+           data->db_scale);
+    } else {
+      LOGE("Failed to allocate quantized bands array");
+      data->error_code = 3;
+    }
   }
 
-  LOGI("Spectrum computed: %d frames x %d bands", total_frames, num_bands);
+  essentia_free_spectrum(source);
   return data;
 }
 
-void essentia_free_spectrum(SpectrumData* data) {
-  if (data) {
-    free(data->bands);
-    free(data);
-  }
-}
-
-StereoPeakData* essentia_compute_stereo_peaks(const char* path, int32_t hop_size,
-                                              EssentiaCancelFlag* cancel_flag) {
-  std::lock_guard<std::mutex> essentiaGuard(essentiaGlobalMutex());
+StereoPeakData* compute_track_stereo_peaks(TrackAudio& audio, int32_t hop_size,
+                                           float silence_start_db, float silence_end_db,
+                                           EssentiaCancelFlag* cancel_flag) {
+  ThreadBudgetGuard budgetGuard(1);
+  std::unique_lock<std::mutex> essentiaGuard(essentiaGlobalMutex());
 
   StereoPeakData* data = (StereoPeakData*)malloc(sizeof(StereoPeakData));
   if (!data) return nullptr;
@@ -206,8 +206,16 @@ StereoPeakData* essentia_compute_stereo_peaks(const char* path, int32_t hop_size
   data->left_peaks = nullptr;
   data->right_peaks = nullptr;
   data->clip_flags = nullptr;
+  data->momentary = nullptr;
+  data->short_term = nullptr;
+  data->true_peaks = nullptr;
   data->num_frames = 0;
   data->hop_duration = (float)hop_size / (float)SPECTRUM_SR;
+  data->integrated_lufs = -100.0f;
+  data->loudness_range = 0.0f;
+  data->true_peak_max = -100.0f;
+  data->content_start_us = 0;
+  data->content_end_us = 0;
   data->error_code = 0;
 
   if (is_cancelled(cancel_flag)) {
@@ -215,86 +223,26 @@ StereoPeakData* essentia_compute_stereo_peaks(const char* path, int32_t hop_size
     return data;
   }
 
-  LOGI("Computing stereo peaks: path=%s, hopSize=%d", path, hop_size);
-
-  AlgorithmFactory& factory = AlgorithmFactory::instance();
-
-  std::vector<StereoSample> stereoAudio;
-  Real nativeSR;
-  int numChannels;
-  std::string md5, codec;
-  int bitRate;
-
-  try {
-    std::unique_ptr<Algorithm> loader(
-        factory.create("AudioLoader", "filename", std::string(path), "computeMD5", false));
-    loader->output("audio").set(stereoAudio);
-    loader->output("sampleRate").set(nativeSR);
-    loader->output("numberChannels").set(numChannels);
-    loader->output("md5").set(md5);
-    loader->output("codec").set(codec);
-    loader->output("bit_rate").set(bitRate);
-    loader->compute();
-  } catch (const std::exception& e) {
-    LOGE("AudioLoader failed: %s", e.what());
-    data->error_code = 2;
-    return data;
-  }
-
-  if (stereoAudio.empty()) {
-    LOGE("No stereo audio samples decoded");
-    data->error_code = 2;
-    return data;
-  }
-
-  LOGI("Loaded %zu stereo samples at %.0f Hz, %d channels", stereoAudio.size(), nativeSR,
-       numChannels);
+  LOGI("Computing stereo peaks: path=%s, hopSize=%d", audio.path(), hop_size);
 
-  if (is_cancelled(cancel_flag)) {
-    data->error_code = 1;
-    return data;
-  }
+  const std::vector<float>* leftAudio = nullptr;
+  const std::vector<float>* rightAudio = nullptr;
+  bool isStereo = false;
+  data->error_code = audio.stereo(&leftAudio, &rightAudio, &isStereo);
+  if (data->error_code != 0) return data;
+  const std::vector<float>& left = *leftAudio;
+  const std::vector<float>& right = *rightAudio;
+  const size_t n = left.size();
 
-  size_t n = stereoAudio.size();
-  std::vector<float> left(n), right(n);
-  bool isStereo = numChannels >= 2;
-  for (size_t i = 0; i < n; i++) {
-    left[i] = stereoAudio[i].left();
-    right[i] = isStereo ? stereoAudio[i].right() : stereoAudio[i].left();
-  }
-  stereoAudio.clear();
-
-  if (std::abs(nativeSR - (float)SPECTRUM_SR) > 1.0f) {
-    LOGI("Resampling from %.0f to %d Hz", nativeSR, SPECTRUM_SR);
-    try {
-      std::vector<float> resL, resR;
-      std::unique_ptr<Algorithm> rs(factory.create("Resample", "inputSampleRate", nativeSR,
-                                                   "outputSampleRate", (Real)SPECTRUM_SR, "quality",
-                                                   4));
-      rs->input("signal").set(left);
-      rs->output("signal").set(resL);
-      rs->compute();
-
-      rs->input("signal").set(right);
-      rs->output("signal").set(resR);
-      rs->compute();
-
-      left = std::move(resL);
-      right = std::move(resR);
-      n = left.size();
-    } catch (const std::exception& e) {
-      LOGE("Resample failed: %s", e.what());
-      data->error_code = 3;
-      return data;
-    }
-  }
+  // ここから先は Essentia を使わないためロックを解放
+  essentiaGuard.unlock();
 
   if (is_cancelled(cancel_flag)) {
     data->error_code = 1;
     return data;
   }
 
-  // 非オーバーラップのホップ単位でピーク検出
+  // 非オーバーラップのホップ単位でピーク検出。ラウドネスとトゥルーピークも同じ走査で求める
   int totalFrames = (int)n / hop_size;
   if (totalFrames <= 0) {
     LOGE("Not enough samples for peak computation");
@@ -305,6 +253,13 @@ StereoPeakData* essentia_compute_stereo_peaks(const char* path, int32_t hop_size
   std::vector<float> leftPeaks(totalFrames);
   std::vector<float> rightPeaks(totalFrames);
   std::vector<uint8_t> clipFlags(totalFrames, 0);
+  std::vector<float> momentary(totalFrames);
+  std::vector<float> shortTerm(totalFrames);
+  std::vector<float> truePeaks(totalFrames);
+
+  LoudnessMeter meter(SPECTRUM_SR, isStereo ? 2 : 1);
+  TruePeakMeter truePeakL, truePeakR;
+  float trackTruePeak = 0;
 
   for (int f = 0; f < totalFrames; f++) {
     if (f % 10000 == 0 && is_cancelled(cancel_flag)) {
@@ -326,23 +281,50 @@ StereoPeakData* essentia_compute_stereo_peaks(const char* path, int32_t hop_size
     leftPeaks[f] = maxL > 1e-7f ? 20.0f * log10f(maxL) : -100.0f;
     rightPeaks[f] = maxR > 1e-7f ? 20.0f * log10f(maxR) : -100.0f;
 
+    meter.add(&left[start], &right[start], end - start);
+    momentary[f] = meter.momentary();
+    shortTerm[f] = meter.short_term();
+
+    float trueL = truePeakL.process(&left[start], end - start);
+    float trueR = isStereo ? truePeakR.process(&right[start], end - start) : trueL;
+    float truePeak = std::max(trueL, trueR);
+    truePeaks[f] = truePeak > 1e-7f ? 20.0f * log10f(truePeak) : -100.0f;
+    trackTruePeak = std::max(trackTruePeak, truePeak);
+
     uint8_t flags = 0;
     if (maxL >= 1.0f) flags |= 1;
     if (maxR >= 1.0f) flags |= 2;
+    if (trueL > 1.0f) flags |= 4;
+    if (trueR > 1.0f) flags |= 8;
     clipFlags[f] = flags;
   }
 
+  // ホップに満たない末尾も曲全体のラウドネスには含める
+  const size_t tail = (size_t)totalFrames * hop_size;
+  if (tail < n) meter.add(&left[tail], &right[tail], (int)(n - tail));
+
   data->num_frames = totalFrames;
   data->left_peaks = (float*)malloc(sizeof(float) * totalFrames);
   data->right_peaks = (float*)malloc(sizeof(float) * totalFrames);
   data->clip_flags = (uint8_t*)malloc(sizeof(uint8_t) * totalFrames);
-  if (!data->left_peaks || !data->right_peaks || !data->clip_flags) {
+  data->momentary = (float*)malloc(sizeof(float) * totalFrames);
+  data->short_term = (float*)malloc(sizeof(float) * totalFrames);
+  data->true_peaks = (float*)malloc(sizeof(float) * totalFrames);
+  if (!data->left_peaks || !data->right_peaks || !data->clip_flags || !data->momentary ||
+      !data->short_term || !data->true_peaks) {
     free(data->left_peaks);
     free(data->right_peaks);
     free(data->clip_flags);
+    free(data->momentary);
+    free(data->short_term);
+    free(data->true_peaks);
     data->left_peaks = nullptr;
     data->right_peaks = nullptr;
     data->clip_flags = nullptr;
+    data->momentary = nullptr;
+    data->short_term = nullptr;
+    data->true_peaks = nullptr;
+    data->num_frames = 0;
     data->error_code = 3;
     return data;
   }
@@ -350,16 +332,152 @@ StereoPeakData* essentia_compute_stereo_peaks(const char* path, int32_t hop_size
   memcpy(data->left_peaks, leftPeaks.data(), sizeof(float) * totalFrames);
   memcpy(data->right_peaks, rightPeaks.data(), sizeof(float) * totalFrames);
   memcpy(data->clip_flags, clipFlags.data(), sizeof(uint8_t) * totalFrames);
-
-  LOGI("Stereo peaks computed: %d frames", totalFrames);
+  memcpy(data->momentary, momentary.data(), sizeof(float) * totalFrames);
+  memcpy(data->short_term, shortTerm.data(), sizeof(float) * totalFrames);
+  memcpy(data->true_peaks, truePeaks.data(), sizeof(float) * totalFrames);
+
+  data->integrated_lufs = meter.integrated();
+  data->loudness_range = meter.loudness_range();
+  data->true_peak_max = trackTruePeak > 1e-7f ? 20.0f * log10f(trackTruePeak) : -100.0f;
+
+  size_t contentStart, contentEnd;
+  find_content_bounds(left, right, leftPeaks, rightPeaks, hop_size, silence_start_db,
+                      silence_end_db, &contentStart, &contentEnd);
+  data->content_start_us = (int64_t)contentStart * 1000000 / SPECTRUM_SR;
+  data->content_end_us = ((int64_t)contentEnd * 1000000 + SPECTRUM_SR - 1) / SPECTRUM_SR;
+
+  LOGI("Stereo peaks computed: %d frames, %.1f LUFS, LRA %.1f LU, true peak %.1f dBTP, "
+       "content %.3f-%.3f s",
+       totalFrames, data->integrated_lufs, data->loudness_range, data->true_peak_max,
+       data->content_start_us / 1e6, data->content_end_us / 1e6);
   return data;
 }
 
+extern "C" {
+
+SpectrumData* essentia_compute_spectrum(const char* path, int32_t num_bands, int32_t frame_size,
+                                        int32_t hop_size, EssentiaCancelFlag* cancel_flag) {
+  TrackAudio audio(path, cancel_flag);
+  return compute_spectrum(audio, num_bands, frame_size, hop_size, cancel_flag);
+}
+
+void essentia_free_spectrum(SpectrumData* data) {
+  if (data) {
+    free(data->bands);
+    free(data);
+  }
+}
+
+SpectrumDataU8* essentia_compute_spectrum_u8(const char* path, int32_t num_bands,
+                                             int32_t frame_size, int32_t hop_size,
+                                             EssentiaCancelFlag* cancel_flag) {
+  TrackAudio audio(path, cancel_flag);
+  return compute_track_spectrum_u8(audio, num_bands, frame_size, hop_size, cancel_flag);
+}
+
+SpectrumPyramid* essentia_compute_spectrum_pyramid(const char* path, int32_t num_bands,
+                                                   int32_t frame_size, int32_t hop_size,
+                                                   int32_t reduce,
+                                                   EssentiaCancelFlag* cancel_flag) {
+  ThreadBudgetGuard budgetGuard(1);
+
+  SpectrumPyramid* pyramid = (SpectrumPyramid*)malloc(sizeof(SpectrumPyramid));
+  if (!pyramid) return nullptr;
+
+  pyramid->bands = nullptr;
+  pyramid->level_offset = nullptr;
+  pyramid->level_frames = nullptr;
+  pyramid->num_levels = 0;
+  pyramid->num_bands = num_bands;
+  pyramid->hop_duration = (float)hop_size / (float)SPECTRUM_SR;
+  pyramid->error_code = 0;
+
+  LOGI("Computing spectrum pyramid: path=%s, bands=%d, frameSize=%d, hopSize=%d, reduce=%s",
+       path, num_bands, frame_size, hop_size, reduce == SPECTRUM_PYRAMID_MEAN ? "mean" : "max");
+
+  TrackAudio track(path, cancel_flag);
+  const std::vector<float>* audio = nullptr;
+  pyramid->error_code = decode_spectrum_audio(track, &audio, cancel_flag);
+  if (pyramid->error_code != 0) return pyramid;
+
+  const int total_frames = FrameEngine::frame_count(audio->size(), hop_size);
+  const std::vector<int> frames = SpectrumPyramidWriter::level_frames(total_frames);
+  const int num_levels = (int)frames.size();
+
+  size_t total_values = 0;
+  for (int f : frames) total_values += (size_t)f * num_bands;
+
+  pyramid->bands = (float*)malloc(sizeof(float) * total_values);
+  pyramid->level_offset = (int32_t*)malloc(sizeof(int32_t) * num_levels);
+  pyramid->level_frames = (int32_t*)malloc(sizeof(int32_t) * num_levels);
+  if (!pyramid->bands || !pyramid->level_offset || !pyramid->level_frames) {
+    LOGE("Failed to allocate pyramid arrays");
+    pyramid->error_code = 3;
+    return pyramid;
+  }
+
+  size_t offset = 0;
+  for (int l = 0; l < num_levels; l++) {
+    pyramid->level_offset[l] = (int32_t)offset;
+    pyramid->level_frames[l] = frames[l];
+    offset += (size_t)frames[l] * num_bands;
+  }
+
+  // 上の段は基本段のフレームが書かれるたびに同じパスの中で埋まる
+  FrameEngine engine(SPECTRUM_SR);
+  SpectrumPyramidWriter writer(num_bands, frame_size, SPECTRUM_SR, total_frames,
+                               reduce != SPECTRUM_PYRAMID_MEAN);
+  writer.set_output(pyramid->bands);
+  engine.add_consumer(frame_size, hop_size, &writer);
+  if (engine.run(*audio, cancel_flag) != 0) {
+    pyramid->error_code = 1;
+    return pyramid;
+  }
+  writer.finish();
+
+  pyramid->num_levels = num_levels;
+  LOGI("Spectrum pyramid computed: %d levels, %zu values (base %d frames)", num_levels,
+       total_values, total_frames);
+  return pyramid;
+}
+
+void essentia_free_spectrum_pyramid(SpectrumPyramid* pyramid) {
+  if (pyramid) {
+    free(pyramid->bands);
+    free(pyramid->level_offset);
+    free(pyramid->level_frames);
+    free(pyramid);
+  }
+}
+
+void essentia_free_spectrum_u8(SpectrumDataU8* data) {
+  if (data) {
+    free(data->bands);
+    free(data);
+  }
+}
+
+void essentia_quantize_spectrum_bands(const float* bands, int32_t count, uint8_t* out,
+                                      float* db_offset, float* db_scale) {
+  quantize_bands(bands, count > 0 ? (size_t)count : 0, out, db_offset, db_scale);
+}
+
+StereoPeakData* essentia_compute_stereo_peaks(const char* path, int32_t hop_size,
+                                              float silence_start_db, float silence_end_db,
+                                              EssentiaCancelFlag* cancel_flag) {
+  TrackAudio audio(path, cancel_flag);
+  return compute_track_stereo_peaks(audio, hop_size, silence_start_db, silence_end_db,
+                                    cancel_flag);
+}
+
 void essentia_free_stereo_peaks(StereoPeakData* data) {
   if (data) {
     free(data->left_peaks);
     free(data->right_peaks);
     free(data->clip_flags);
+    free(data->momentary);
+    free(data->short_term);
+    free(data->true_peaks);
     free(data);
   }
 }
@@ -20,16 +20,78 @@ SpectrumData* essentia_compute_spectrum(const char* path, int32_t num_bands, int
 
 void essentia_free_spectrum(SpectrumData* data);
 
+// Compact form of SpectrumData for display and caching: dB = db_offset + value * db_scale.
+// The range is the track's own min..max (floored at -100 dB), about 0.5 dB per step.
+typedef struct {
+  uint8_t* bands;  // numFrames * numBands quantized values (heap-allocated)
+  int32_t num_frames;
+  int32_t num_bands;
+  float hop_duration;  // hop_size / sample_rate (seconds)
+  float db_offset;
+  float db_scale;
+  int32_t error_code;  // 0=success, 1=cancelled, 2=decode error, 3=analysis error
+} SpectrumDataU8;
+
+SpectrumDataU8* essentia_compute_spectrum_u8(const char* path, int32_t num_bands,
+                                             int32_t frame_size, int32_t hop_size,
+                                             EssentiaCancelFlag* cancel_flag);
+
+void essentia_free_spectrum_u8(SpectrumDataU8* data);
+
+// Quantizes count dB values with the same mapping as essentia_compute_spectrum_u8, e.g. for
+// bands produced by a spectrum stream.
+void essentia_quantize_spectrum_bands(const float* bands, int32_t count, uint8_t* out,
+                                      float* db_offset, float* db_scale);
+
+#define SPECTRUM_PYRAMID_MAX 0
+#define SPECTRUM_PYRAMID_MEAN 1
+
+// Level-of-detail spectrograms for zoomed-out views. Level 0 is the essentia_compute_spectrum
+// output; each further level merges pairs of frames of the previous one (max or mean per band),
+// down to a single frame, so a view can pick the level with about one frame per pixel.
+typedef struct {
+  float* bands;           // all levels back to back, level 0 first (heap-allocated)
+  int32_t* level_offset;  // numLevels offsets into bands, in values (heap-allocated)
+  int32_t* level_frames;  // numLevels frame counts (heap-allocated)
+  int32_t num_levels;
+  int32_t num_bands;
+  float hop_duration;  // level 0 hop in seconds; level l covers hop_duration * 2^l per frame
+  int32_t error_code;  // 0=success, 1=cancelled, 2=decode error, 3=analysis error
+} SpectrumPyramid;
+
+SpectrumPyramid* essentia_compute_spectrum_pyramid(const char* path, int32_t num_bands,
+                                                   int32_t frame_size, int32_t hop_size,
+                                                   int32_t reduce,
+                                                   EssentiaCancelFlag* cancel_flag);
+
+void essentia_free_spectrum_pyramid(SpectrumPyramid* pyramid);
+
+// Sample peaks plus EBU R128 loudness (K-weighted, BS.1770 gating) and 4x-oversampled true peak,
+// all from the same pass over the decoded samples. Loudness values are -100 while a window is
+// still filling or silent.
 typedef struct {
   float* left_peaks;    // numFrames dB values (heap-allocated)
   float* right_peaks;   // numFrames dB values (heap-allocated)
-  uint8_t* clip_flags;  // numFrames flags: bit0=left clipped, bit1=right clipped
+  uint8_t* clip_flags;  // numFrames flags: bit0=left clipped, bit1=right clipped,
+                        // bit2=left true peak over 0 dBTP, bit3=right true peak over 0 dBTP
+  float* momentary;     // numFrames LUFS over the last 400 ms, updated every 100 ms
+  float* short_term;    // numFrames LUFS over the last 3 s, updated every 100 ms
+  float* true_peaks;    // numFrames dBTP, louder channel
   int32_t num_frames;
-  float hop_duration;  // hop_size / sample_rate (seconds)
+  float hop_duration;     // hop_size / sample_rate (seconds)
+  float integrated_lufs;  // gated programme loudness of the whole track
+  float loudness_range;   // LU (EBU Tech 3342)
+  float true_peak_max;    // dBTP over the whole track
+  int64_t content_start_us;  // first sample at or above silence_start_db
+  int64_t content_end_us;    // just past the last sample at or above silence_end_db
   int32_t error_code;  // 0=success, 1=cancelled, 2=decode error, 3=analysis error
 } StereoPeakData;
 
+// Content bounds are found on the hop peaks first and then refined sample by sample inside the
+// boundary hops, at SPECTRUM_SR resolution. A track with nothing above the thresholds reports
+// the whole length as content.
 StereoPeakData* essentia_compute_stereo_peaks(const char* path, int32_t hop_size,
+                                              float silence_start_db, float silence_end_db,
                                               EssentiaCancelFlag* cancel_flag);
 
 void essentia_free_stereo_peaks(StereoPeakData* data);
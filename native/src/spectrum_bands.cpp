@@ -0,0 +1,117 @@
+#include "spectrum_bands.h"
+
+#include <algorithm>
+#include <cmath>
+
+SpectrumBands::SpectrumBands(int num_bands, int frame_size, int sample_rate)
+    : num_bands_(num_bands), spectrum_size_(frame_size / 2 + 1) {
+  // 対数等間隔のバンド境界を FFT ビンのインデックスに変換（20 Hz – 20 kHz）
+  bin_edges_.resize(num_bands + 1);
+  for (int i = 0; i <= num_bands; i++) {
+    float freq = 20.0f * powf(20000.0f / 20.0f, (float)i / num_bands);
+    bin_edges_[i] = freq * frame_size / (float)sample_rate;
+  }
+
+  // コヒーレントゲイン（0.5）を正規化に反映
+  norm_sq_ = (frame_size * 0.25f) * (frame_size * 0.25f);
+
+  // バンド補正：帯域幅正規化（1 kHz 基準）+ スロープ補正（dB/oct）
+  static constexpr float kSlopeDBoct = 4.5f;
+  float band_ratio = powf(20000.0f / 20.0f, 1.0f / num_bands);
+  float ref_bw = 1000.0f * (band_ratio - 1.0f) * frame_size / (float)sample_rate;
+  band_correction_.resize(num_bands);
+  for (int b = 0; b < num_bands; b++) {
+    float bw = bin_edges_[b + 1] - bin_edges_[b];
+    float center_freq = 20.0f * powf(1000.0f, ((float)b + 0.5f) / num_bands);
+    band_correction_[b] =
+        10.0f * log10f(ref_bw / bw) + kSlopeDBoct * log2f(center_freq / 1000.0f);
+  }
+}
+
+void SpectrumBands::compute(const std::vector<float>& spectrum, float* out) const {
+  for (int b = 0; b < num_bands_; b++) {
+    float sum = 0;
+    int k_start = (int)bin_edges_[b];
+    int k_end = (int)std::ceil(bin_edges_[b + 1]);
+    if (k_end > spectrum_size_) k_end = spectrum_size_;
+
+    for (int k = std::max(0, k_start); k < k_end; k++) {
+      float w_low = std::max((float)k, bin_edges_[b]);
+      float w_high = std::min((float)(k + 1), bin_edges_[b + 1]);
+      float weight = w_high - w_low;
+      if (weight > 0) {
+        sum += spectrum[k] * spectrum[k] * weight;
+      }
+    }
+
+    out[b] = (sum > 1e-14f) ? 10.0f * log10f(sum / norm_sq_) + band_correction_[b] : -100.0f;
+  }
+}
+
+ChromaBins::ChromaBins(int frame_size, int sample_rate, float min_freq, float max_freq)
+    : bin_class_(frame_size / 2 + 1, -1) {
+  for (size_t k = 1; k < bin_class_.size(); k++) {
+    const float freq = (float)k * sample_rate / frame_size;
+    if (freq < min_freq || freq > max_freq) continue;
+    // MIDI ノート番号の 12 の剰余
+    const long note = lroundf(12.0f * log2f(freq / 440.0f) + 69.0f);
+    bin_class_[k] = (int8_t)(note % PITCH_CLASSES);
+  }
+}
+
+void ChromaBins::compute(const std::vector<float>& spectrum, float* out) const {
+  std::fill(out, out + PITCH_CLASSES, 0.0f);
+  const size_t bins = std::min(spectrum.size(), bin_class_.size());
+  for (size_t k = 0; k < bins; k++) {
+    if (bin_class_[k] >= 0) out[bin_class_[k]] += spectrum[k] * spectrum[k];
+  }
+}
+
+std::vector<int> SpectrumPyramidWriter::level_frames(int num_frames) {
+  std::vector<int> frames(1, num_frames);
+  while (frames.back() > 1) frames.push_back((frames.back() + 1) / 2);
+  return frames;
+}
+
+SpectrumPyramidWriter::SpectrumPyramidWriter(int num_bands, int frame_size, int sample_rate,
+                                             int num_frames, bool use_max)
+    : bands_(num_bands, frame_size, sample_rate),
+      use_max_(use_max),
+      frames_(level_frames(num_frames)) {
+  size_t offset = 0;
+  for (int frames : frames_) {
+    offsets_.push_back(offset);
+    offset += (size_t)frames * num_bands;
+  }
+}
+
+void SpectrumPyramidWriter::consume(const std::vector<float>& spectrum) {
+  if (written_ >= frames_[0]) return;
+  bands_.compute(spectrum, out_ + (size_t)written_ * bands_.num_bands());
+  emit(0, written_++);
+}
+
+void SpectrumPyramidWriter::emit(size_t level, int index) {
+  // 奇数番目のフレームが揃った時点で対をまとめ、上の段も同じように繰り上げる
+  if (level + 1 >= frames_.size() || index % 2 == 0) return;
+
+  const int n = bands_.num_bands();
+  const float* a = out_ + offsets_[level] + (size_t)(index - 1) * n;
+  const float* b = a + n;
+  float* parent = out_ + offsets_[level + 1] + (size_t)(index / 2) * n;
+  for (int i = 0; i < n; i++) {
+    parent[i] = use_max_ ? std::max(a[i], b[i]) : 0.5f * (a[i] + b[i]);
+  }
+  emit(level + 1, index / 2);
+}
+
+void SpectrumPyramidWriter::finish() {
+  const int n = bands_.num_bands();
+  for (size_t level = 0; level + 1 < frames_.size(); level++) {
+    if (frames_[level] % 2 == 0) continue;
+    const int last = frames_[level] - 1;
+    const float* src = out_ + offsets_[level] + (size_t)last * n;
+    std::copy(src, src + n, out_ + offsets_[level + 1] + (size_t)(last / 2) * n);
+    emit(level + 1, last / 2);
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef SPECTRUM_BANDS_H
+#define SPECTRUM_BANDS_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "frame_engine.h"
+
+// 振幅スペクトルを 20 Hz – 20 kHz の対数等間隔バンド（dB）に変換する
+// 帯域幅正規化（1 kHz 基準）と 4.5 dB/oct のスロープ補正を含む表示用の値
+class SpectrumBands {
+ public:
+  SpectrumBands(int num_bands, int frame_size, int sample_rate);
+
+  int num_bands() const { return num_bands_; }
+
+  // out には num_bands 個の dB 値を書き込む（無音は -100 dB）
+  void compute(const std::vector<float>& spectrum, float* out) const;
+
+ private:
+  int num_bands_;
+  int spectrum_size_;
+  float norm_sq_;
+  std::vector<float> bin_edges_;
+  std::vector<float> band_correction_;
+};
+
+// 振幅スペクトルのパワーを [min_freq, max_freq] の範囲で音名ごとに足し合わせる
+class ChromaBins {
+ public:
+  static const int PITCH_CLASSES = 12;
+
+  ChromaBins(int frame_size, int sample_rate, float min_freq, float max_freq);
+
+  // out には C = 0 から順に 12 個のパワー（正規化前）を書き込む
+  void compute(const std::vector<float>& spectrum, float* out) const;
+
+ private:
+  std::vector<int8_t> bin_class_;  // スペクトルのビンごとの音名（範囲外は -1）
+};
+
+// 表示用バンドをフレーム順に出力配列へ書き込む
+class SpectrumBandWriter : public FrameConsumer {
+ public:
+  SpectrumBandWriter(int num_bands, int frame_size, int sample_rate, float* out)
+      : bands_(num_bands, frame_size, sample_rate), out_(out) {}
+
+  void consume(const std::vector<float>& spectrum) override {
+    bands_.compute(spectrum, out_);
+    out_ += bands_.num_bands();
+  }
+
+  void set_output(float* out) { out_ = out; }
+
+ private:
+  SpectrumBands bands_;
+  float* out_;
+};
+
+// 表示用バンドを書きながら、2 フレームずつ max / mean でまとめた粗い段を同時に積み上げる
+// 段 l は段 l-1 の 2 フレームを 1 フレームにしたもので、フレーム数が 1 になるまで続く
+// 全段を out に段 0 から順に連続して書く（各段の先頭は level_offset）
+class SpectrumPyramidWriter : public FrameConsumer {
+ public:
+  SpectrumPyramidWriter(int num_bands, int frame_size, int sample_rate, int num_frames,
+                        bool use_max);
+
+  // num_frames から決まる段ごとのフレーム数
+  static std::vector<int> level_frames(int num_frames);
+
+  void set_output(float* out) { out_ = out; }
+
+  void consume(const std::vector<float>& spectrum) override;
+
+  // 最後に対になる相手のいなかったフレームを上の段へ送る。全フレームを渡した後に 1 回呼ぶ
+  void finish();
+
+ private:
+  void emit(size_t level, int index);
+
+  SpectrumBands bands_;
+  bool use_max_;
+  std::vector<int> frames_;
+  std::vector<size_t> offsets_;  // 段ごとの先頭位置（値の個数）
+  int written_ = 0;
+  float* out_ = nullptr;
+};
+
+#endif  // SPECTRUM_BANDS_H
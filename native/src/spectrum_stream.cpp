@@ -0,0 +1,190 @@
+#include "spectrum_stream.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_decode.h"
+#include "frame_engine.h"
+#include "log_timer.h"
+#include "spectrum_bands.h"
+#include "thread_budget.h"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "SpectrumStream"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGI(...)
+#define LOGE(...)
+#endif
+
+static const int SPECTRUM_SR = 44100;
+static const double CHUNK_SECONDS = 5.0;
+// リサンプラの立ち上がりが窓に入らないよう、区間の前後に余分にデコードするサンプル数
+static const int RESAMPLE_MARGIN = 2048;
+
+struct StreamState {
+  SpectrumStreamInfo info;
+  std::vector<float> bands;
+  std::vector<uint8_t> chunk_ready;
+  std::string path;
+  int frame_size;
+  int hop_size;
+  std::atomic<int> focus_chunk{0};
+  EssentiaCancelFlag* cancel_flag = essentia_cancel_flag_create();
+
+  ~StreamState() { essentia_cancel_flag_destroy(cancel_flag); }
+};
+
+struct SpectrumStream {
+  std::shared_ptr<StreamState> state;
+};
+
+// focus に最も近い未処理チャンク。同距離なら再生が進む後ろ側を優先する
+static int next_chunk(const std::vector<bool>& processed, int focus) {
+  const int n = (int)processed.size();
+  for (int distance = 0; distance < n; distance++) {
+    if (focus + distance < n && !processed[focus + distance]) return focus + distance;
+    if (focus - distance >= 0 && !processed[focus - distance]) return focus - distance;
+  }
+  return -1;
+}
+
+static void run_stream(std::shared_ptr<StreamState> state) {
+  SpectrumStreamInfo& info = state->info;
+  const int hop = state->hop_size;
+  LogTimer timer;
+
+  FrameEngine engine(SPECTRUM_SR);
+  SpectrumBandWriter writer(info.num_bands, state->frame_size, SPECTRUM_SR, nullptr);
+  engine.add_consumer(state->frame_size, hop, &writer);
+
+  std::vector<bool> processed(info.num_chunks, false);
+  bool any_decoded = false;
+  int error_code = 0;
+
+  for (int remaining = info.num_chunks; remaining > 0; remaining--) {
+    if (essentia_cancel_flag_is_set(state->cancel_flag)) {
+      error_code = 1;
+      break;
+    }
+
+    const int chunk = next_chunk(processed, state->focus_chunk.load(std::memory_order_relaxed));
+    processed[chunk] = true;
+
+    const int first_frame = chunk * info.frames_per_chunk;
+    const int end_frame = std::min(info.num_frames, first_frame + info.frames_per_chunk);
+    const int64_t first_center = (int64_t)first_frame * hop;
+    const int64_t end_center = (int64_t)end_frame * hop;
+    const int64_t margin = state->frame_size / 2 + RESAMPLE_MARGIN;
+    const int64_t decode_start = std::max<int64_t>(0, first_center - margin);
+    const int64_t decode_end = end_center + margin;
+
+    ThreadBudgetGuard budgetGuard(1);
+
+    std::vector<float> audio;
+    double actual_start = 0;
+    int decode_ret = decode_audio_range(
+        state->path.c_str(), (double)decode_start / SPECTRUM_SR,
+        (double)(decode_end - decode_start) / SPECTRUM_SR, SPECTRUM_SR, 1, audio, &actual_start,
+        state->cancel_flag);
+    if (decode_ret == 1) {
+      error_code = 1;
+      break;
+    }
+
+    if (decode_ret == 0) {
+      any_decoded = true;
+      const int offset = (int)(first_center - std::llround(actual_start * SPECTRUM_SR));
+      writer.set_output(state->bands.data() + (size_t)first_frame * info.num_bands);
+      if (engine.run(audio, offset, offset + (end_frame - first_frame) * hop,
+                     state->cancel_flag) != 0) {
+        error_code = 1;
+        break;
+      }
+    } else if (!any_decoded && remaining == info.num_chunks) {
+      // 最初のチャンクから読めないファイルはそれ以上続けない
+      error_code = 2;
+      break;
+    } else {
+      // 曲長の見積もりが実際より長い場合の末尾などは無音のまま確定させる
+      LOGI("Chunk %d not decodable, leaving it silent", chunk);
+    }
+
+    __atomic_store_n(&state->chunk_ready[chunk], (uint8_t)1, __ATOMIC_RELEASE);
+
+    if (remaining == info.num_chunks) {
+      LOGI("First chunk %d ready in %.0f ms", chunk, timer.elapsed_ms());
+    }
+  }
+
+  LOGI("Spectrum stream finished: error=%d, %.0f ms", error_code, timer.elapsed_ms());
+  __atomic_store_n(&info.error_code, error_code, __ATOMIC_RELEASE);
+  __atomic_store_n(&info.done, 1, __ATOMIC_RELEASE);
+}
+
+extern "C" {
+
+SpectrumStream* essentia_spectrum_stream_start(const char* path, int32_t num_bands,
+                                               int32_t frame_size, int32_t hop_size,
+                                               float focus_sec) {
+  double duration = probe_audio_duration(path);
+  if (duration <= 0) {
+    LOGE("Unknown duration, cannot stream spectrum: %s", path);
+    return nullptr;
+  }
+
+  std::shared_ptr<StreamState> state = std::make_shared<StreamState>();
+  state->path = path;
+  state->frame_size = frame_size;
+  state->hop_size = hop_size;
+
+  SpectrumStreamInfo& info = state->info;
+  info.num_bands = num_bands;
+  info.num_frames = FrameEngine::frame_count((size_t)std::ceil(duration * SPECTRUM_SR), hop_size);
+  info.frames_per_chunk = std::max(1, (int)(CHUNK_SECONDS * SPECTRUM_SR / hop_size));
+  info.num_chunks = (info.num_frames + info.frames_per_chunk - 1) / info.frames_per_chunk;
+  info.hop_duration = (float)hop_size / (float)SPECTRUM_SR;
+  info.error_code = 0;
+  info.done = 0;
+
+  state->bands.assign((size_t)info.num_frames * num_bands, -100.0f);
+  state->chunk_ready.assign(info.num_chunks, 0);
+  info.bands = state->bands.data();
+  info.chunk_ready = state->chunk_ready.data();
+
+  SpectrumStream* stream = new SpectrumStream();
+  stream->state = state;
+  essentia_spectrum_stream_set_focus(stream, focus_sec);
+
+  LOGI("Spectrum stream: %d frames in %d chunks, focus %.1f s", info.num_frames, info.num_chunks,
+       focus_sec);
+  std::thread(run_stream, state).detach();
+  return stream;
+}
+
+const SpectrumStreamInfo* essentia_spectrum_stream_info(SpectrumStream* stream) {
+  return stream ? &stream->state->info : nullptr;
+}
+
+void essentia_spectrum_stream_set_focus(SpectrumStream* stream, float position_sec) {
+  if (!stream) return;
+  const SpectrumStreamInfo& info = stream->state->info;
+  int frame = (int)(std::max(0.0f, position_sec) / info.hop_duration);
+  int chunk = std::min(info.num_chunks - 1, frame / info.frames_per_chunk);
+  stream->state->focus_chunk.store(std::max(0, chunk), std::memory_order_relaxed);
+}
+
+void essentia_spectrum_stream_destroy(SpectrumStream* stream) {
+  if (!stream) return;
+  essentia_cancel_flag_set(stream->state->cancel_flag);
+  delete stream;
+}
+
+}  // extern "C"
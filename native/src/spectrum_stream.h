@@ -0,0 +1,46 @@
+#ifndef SPECTRUM_STREAM_H
+#define SPECTRUM_STREAM_H
+
+#include "essentia_bridge.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SpectrumStream SpectrumStream;
+
+// Shared with the background worker. Layout fields are fixed before
+// essentia_spectrum_stream_start returns; bands, chunk_ready, error_code and done are written by
+// the worker as chunks complete (each chunk's bands before its ready flag).
+typedef struct {
+  float* bands;          // numFrames * numBands dB values, -100 until the chunk is ready
+  uint8_t* chunk_ready;  // numChunks flags, 1 once the chunk's frames are final
+  int32_t num_frames;
+  int32_t num_bands;
+  int32_t num_chunks;
+  int32_t frames_per_chunk;
+  float hop_duration;  // hop_size / sample_rate (seconds)
+  int32_t error_code;  // 0=success, 1=cancelled, 2=decode error, 3=analysis error
+  int32_t done;        // 1 once the worker has stopped
+} SpectrumStreamInfo;
+
+// Computes the same bands as essentia_compute_spectrum on a background thread, starting with the
+// chunk around focus_sec and widening outwards. Returns NULL if the track length is unknown.
+SpectrumStream* essentia_spectrum_stream_start(const char* path, int32_t num_bands,
+                                               int32_t frame_size, int32_t hop_size,
+                                               float focus_sec);
+
+// Valid until essentia_spectrum_stream_destroy.
+const SpectrumStreamInfo* essentia_spectrum_stream_info(SpectrumStream* stream);
+
+// Moves the priority to the chunk around position_sec, e.g. after a seek.
+void essentia_spectrum_stream_set_focus(SpectrumStream* stream, float position_sec);
+
+// Stops the worker and releases the stream; the worker frees the buffers once it has exited.
+void essentia_spectrum_stream_destroy(SpectrumStream* stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SPECTRUM_STREAM_H
@@ -1,13 +1,29 @@
 #include "style_classifier.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
 #include <memory>
 #include <numeric>
+#include <string>
 #include <vector>
 
 #include "audio_decode.h"
 #include "essentia_lock.h"
+#include "excerpt.h"
+#include "log_timer.h"
+#include "mapped_file.h"
+#include "model_cache.h"
+#include "thread_budget.h"
+#include "track_analysis.h"
+#include "track_audio.h"
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -22,6 +38,7 @@
 #include <essentia/algorithmfactory.h>
 #include <essentia/essentiamath.h>
 #include <onnxruntime_c_api.h>
+#include <onnxruntime_session_options_config_keys.h>
 
 using namespace essentia;
 using namespace essentia::standard;
@@ -32,15 +49,17 @@ static const int HOP_SIZE = 256;
 static const int NUM_BANDS = 96;
 static const int PATCH_FRAMES = 128;
 static const int NUM_CLASSES = 400;
+static const int FAST_INITIAL_PATCHES = 8;
 
 static bool is_cancelled(EssentiaCancelFlag* flag) {
   return essentia_cancel_flag_is_set(flag) != 0;
 }
 
 struct OrtContext {
+  std::shared_ptr<MappedFile> model;  // セッションより長く生存させる
   const OrtApi* ort = nullptr;
   OrtAllocator* allocator = nullptr;
-  OrtEnv* env = nullptr;
+  OrtEnv* env = nullptr;  // プロセス共有（解放しない）
   OrtSessionOptions* session_opts = nullptr;
   OrtSession* session = nullptr;
   OrtMemoryInfo* mem_info = nullptr;
@@ -53,42 +72,14 @@ struct OrtContext {
     if (mem_info && ort) ort->ReleaseMemoryInfo(mem_info);
     if (session && ort) ort->ReleaseSession(session);
     if (session_opts && ort) ort->ReleaseSessionOptions(session_opts);
-    if (env && ort) ort->ReleaseEnv(env);
   }
 };
 
-extern "C" {
-
-StyleResult essentia_classify_style(const char* audio_path, const char* model_path,
-                                    EssentiaCancelFlag* cancel_flag) {
-  std::unique_lock<std::mutex> essentiaGuard(essentiaGlobalMutex());
-
-  StyleResult result = {};
-  result.count = 0;
-  result.error_code = 0;
-
-  std::vector<float> audio;
-  int decode_ret = decode_audio(audio_path, audio, STYLE_SR, cancel_flag);
-  if (decode_ret < 0) {
-    result.error_code = 2;
-    return result;
-  }
-  if (decode_ret == 1 || is_cancelled(cancel_flag)) {
-    result.error_code = 1;
-    return result;
-  }
-
-  if (audio.empty()) {
-    LOGE("No audio samples decoded");
-    result.error_code = 2;
-    return result;
-  }
-
-  if (is_cancelled(cancel_flag)) {
-    result.error_code = 1;
-    return result;
-  }
-
+// 信号の log-mel を非オーバーラップの 128 フレームパッチに分割して patches に追加する
+// Essentia のロックを保持して呼ぶこと。戻り値は StyleResult::error_code と同じ体系
+static int append_mel_patches(const std::vector<float>& audio,
+                              std::vector<std::vector<float> >& patches,
+                              EssentiaCancelFlag* cancel_flag) {
   AlgorithmFactory& factory = AlgorithmFactory::instance();
 
   std::vector<std::vector<float> > mel_frames;
@@ -136,10 +127,7 @@ StyleResult essentia_classify_style(const char* audio_path, const char* model_pa
       frameCutter->compute();
       if (current_frame.empty()) break;
 
-      if (is_cancelled(cancel_flag)) {
-        result.error_code = 1;
-        return result;
-      }
+      if (is_cancelled(cancel_flag)) return 1;
 
       windowing->compute();
       spec->compute();
@@ -151,20 +139,9 @@ StyleResult essentia_classify_style(const char* audio_path, const char* model_pa
     }
   } catch (const std::exception& e) {
     LOGE("Mel spectrogram error: %s", e.what());
-    result.error_code = 3;
-    return result;
+    return 3;
   }
 
-  // ONNX 推論は Essentia を触らないためロックを解放
-  essentiaGuard.unlock();
-
-  if ((int)mel_frames.size() < PATCH_FRAMES) {
-    LOGE("Not enough frames for a patch: %zu < %d", mel_frames.size(), PATCH_FRAMES);
-    result.error_code = 3;
-    return result;
-  }
-
-  std::vector<std::vector<float> > patches;
   for (int start = 0; start + PATCH_FRAMES <= (int)mel_frames.size(); start += PATCH_FRAMES) {
     std::vector<float> patch;
     patch.reserve(PATCH_FRAMES * NUM_BANDS);
@@ -174,146 +151,702 @@ StyleResult essentia_classify_style(const char* audio_path, const char* model_pa
     patches.push_back(std::move(patch));
   }
 
-  if (is_cancelled(cancel_flag)) {
-    result.error_code = 1;
-    return result;
+  return 0;
+}
+
+// 音声をデコードし、非オーバーラップの 128 フレームパッチに分割した log-mel を返す
+// 戻り値は StyleResult::error_code と同じ体系（0=成功）
+static int compute_mel_patches(TrackAudio& track, std::vector<std::vector<float> >& patches,
+                               EssentiaCancelFlag* cancel_flag) {
+  ThreadBudgetGuard budgetGuard(1);
+  std::unique_lock<std::mutex> essentiaGuard(essentiaGlobalMutex());
+
+  const std::vector<float>* audio = nullptr;
+  int decode_ret = track.mono(STYLE_SR, &audio);
+  if (decode_ret != 0) return decode_ret;
+  if (is_cancelled(cancel_flag)) return 1;
+
+  int mel_ret = append_mel_patches(*audio, patches, cancel_flag);
+  if (mel_ret != 0) return mel_ret;
+
+  // ONNX 推論は Essentia を触らないためロックを解放
+  essentiaGuard.unlock();
+
+  if (patches.empty()) {
+    LOGE("Not enough frames for a patch");
+    return 3;
+  }
+
+  return is_cancelled(cancel_flag) ? 1 : 0;
+}
+
+// 抜粋区間だけをデコードしてパッチにする。抜粋できない曲や復号失敗時は -1 を返す
+static int compute_excerpt_mel_patches(const char* audio_path, double excerpt_seconds,
+                                       std::vector<std::vector<float> >& patches,
+                                       EssentiaCancelFlag* cancel_flag) {
+  ThreadBudgetGuard budgetGuard(1);
+
+  // 区間のデコードは FFmpeg だけで済むため、Essentia のロックは log-mel の計算時のみ取る
+  std::vector<ExcerptWindow> windows =
+      select_excerpt_windows(audio_path, excerpt_seconds, cancel_flag);
+  if (is_cancelled(cancel_flag)) return 1;
+  if (windows.empty()) return -1;
+
+  std::vector<std::vector<float> > segments(windows.size());
+  for (size_t w = 0; w < windows.size(); w++) {
+    int decode_ret = decode_audio_range(audio_path, windows[w].start_sec,
+                                        windows[w].duration_sec, STYLE_SR, 1, segments[w],
+                                        nullptr, cancel_flag);
+    if (decode_ret == 1) return 1;
+    if (decode_ret < 0) return -1;
+  }
+
+  std::lock_guard<std::mutex> essentiaGuard(essentiaGlobalMutex());
+  for (const std::vector<float>& audio : segments) {
+    int mel_ret = append_mel_patches(audio, patches, cancel_flag);
+    if (mel_ret != 0) return mel_ret;
+  }
+
+  return patches.empty() ? -1 : 0;
+}
+
+// モデルファイルのマッピングはプロセス内で共有し、ファイルが差し替えられた場合のみ張り直す
+static std::shared_ptr<MappedFile> acquire_model_mapping(const std::string& model_path) {
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<MappedFile> > cached;
+
+  std::lock_guard<std::mutex> guard(mutex);
+  struct stat st;
+  if (stat(model_path.c_str(), &st) != 0) {
+    cached.erase(model_path);
+    return nullptr;
+  }
+  std::shared_ptr<MappedFile>& entry = cached[model_path];
+  if (entry && (size_t)st.st_size == entry->size() && (int64_t)st.st_mtime == entry->mtime()) {
+    return entry;
+  }
+  entry = MappedFile::open(model_path.c_str());
+  return entry;
+}
+
+// 全セッションで 1 つの OrtEnv とグローバルスレッドプールを共有し、並行推論でもスレッドを増やさない
+static OrtEnv* shared_env(const OrtApi* ort) {
+  static std::mutex mutex;
+  static OrtEnv* env = nullptr;
+
+  std::lock_guard<std::mutex> guard(mutex);
+  if (env) return env;
+
+  ThreadBudget& budget = ThreadBudget::instance();
+  OrtThreadingOptions* threading = nullptr;
+  OrtStatus* status = ort->CreateThreadingOptions(&threading);
+  if (!status) status = ort->SetGlobalIntraOpNumThreads(threading, budget.ort_intra_op_threads());
+  if (!status) status = ort->SetGlobalInterOpNumThreads(threading, budget.ort_inter_op_threads());
+  // スピン待ちのスレッドは予算外でコアを占有するため無効化
+  if (!status) status = ort->SetGlobalSpinControl(threading, 0);
+  if (!status) {
+    status = ort->CreateEnvWithGlobalThreadPools(ORT_LOGGING_LEVEL_WARNING, "style_classifier",
+                                                 threading, &env);
   }
+  if (threading) ort->ReleaseThreadingOptions(threading);
+  if (status) {
+    LOGE("CreateEnvWithGlobalThreadPools failed: %s", ort->GetErrorMessage(status));
+    ort->ReleaseStatus(status);
+    env = nullptr;
+    return nullptr;
+  }
+
+  LOGI("ORT env created: intra-op %d threads, inter-op %d threads",
+       budget.ort_intra_op_threads(), budget.ort_inter_op_threads());
+  return env;
+}
 
+// 重みのプリパック結果を同時に存在するセッション間で共有する（プロセス終了まで保持）
+static OrtPrepackedWeightsContainer* prepacked_weights(const OrtApi* ort) {
+  static OrtPrepackedWeightsContainer* container = [ort]() {
+    OrtPrepackedWeightsContainer* created = nullptr;
+    OrtStatus* status = ort->CreatePrepackedWeightsContainer(&created);
+    if (status) {
+      LOGE("CreatePrepackedWeightsContainer failed: %s", ort->GetErrorMessage(status));
+      ort->ReleaseStatus(status);
+      return (OrtPrepackedWeightsContainer*)nullptr;
+    }
+    return created;
+  }();
+  return container;
+}
+
+// ORT 形式（FlatBuffers, 識別子 "ORTM"）ならマップしたバイト列を初期化子ごと直接参照できる
+static bool is_ort_format(const MappedFile& file) {
+  return file.size() >= 8 && memcmp((const char*)file.data() + 4, "ORTM", 4) == 0;
+}
+
+// 戻り値は 0=成功, 4=モデルエラー
+static int init_ort_context(OrtContext& ctx, const char* model_path) {
   LOGI("Loading ONNX model: %s", model_path);
 
-  OrtContext ctx;
   ctx.ort = OrtGetApiBase()->GetApi(ORT_API_VERSION);
   if (!ctx.ort) {
     LOGE("Failed to get ONNX Runtime API");
-    result.error_code = 4;
-    return result;
+    return 4;
   }
 
-  OrtStatus* status = ctx.ort->CreateEnv(ORT_LOGGING_LEVEL_WARNING, "style_classifier", &ctx.env);
+  ctx.env = shared_env(ctx.ort);
+  if (!ctx.env) return 4;
+
+  OrtStatus* status = ctx.ort->CreateSessionOptions(&ctx.session_opts);
   if (status) {
-    LOGE("CreateEnv failed: %s", ctx.ort->GetErrorMessage(status));
+    LOGE("CreateSessionOptions failed: %s", ctx.ort->GetErrorMessage(status));
     ctx.ort->ReleaseStatus(status);
-    result.error_code = 4;
-    return result;
+    return 4;
   }
 
-  status = ctx.ort->CreateSessionOptions(&ctx.session_opts);
+  status = ctx.ort->DisablePerSessionThreads(ctx.session_opts);
   if (status) {
-    LOGE("CreateSessionOptions failed: %s", ctx.ort->GetErrorMessage(status));
+    LOGE("DisablePerSessionThreads failed: %s", ctx.ort->GetErrorMessage(status));
     ctx.ort->ReleaseStatus(status);
-    result.error_code = 4;
-    return result;
+    return 4;
+  }
+
+  ctx.model = acquire_model_mapping(model_path);
+  if (!ctx.model) {
+    LOGE("Failed to map model: %s", model_path);
+    return 4;
+  }
+
+  // 最適化済みの ORT 形式モデルがキャッシュにあればグラフ最適化を省略してそれを読み込む
+  std::string optimized_path =
+      optimized_model_path(*ctx.model, OrtGetApiBase()->GetVersionString());
+  std::shared_ptr<MappedFile> optimized;
+  if (!optimized_path.empty()) {
+    optimized = acquire_model_mapping(optimized_path);
+    if (optimized && !is_ort_format(*optimized)) optimized.reset();
+  }
+
+  std::string temp_path;
+  if (optimized) {
+    ctx.model = optimized;
+    status = ctx.ort->SetSessionGraphOptimizationLevel(ctx.session_opts, ORT_DISABLE_ALL);
+  } else {
+    status = ctx.ort->SetSessionGraphOptimizationLevel(ctx.session_opts, ORT_ENABLE_EXTENDED);
+  }
+  if (status) {
+    LOGE("SetSessionGraphOptimizationLevel failed: %s", ctx.ort->GetErrorMessage(status));
+    ctx.ort->ReleaseStatus(status);
+    return 4;
+  }
+
+  if (!optimized && !optimized_path.empty()) {
+    // 書き込み途中のファイルを他のセッションが読まないよう一時ファイル経由で保存する
+    static std::atomic<int> temp_counter{0};
+    temp_path = optimized_path + "." + std::to_string(temp_counter.fetch_add(1)) + ".tmp";
+    status = ctx.ort->SetOptimizedModelFilePath(ctx.session_opts, temp_path.c_str());
+    if (!status) {
+      status = ctx.ort->AddSessionConfigEntry(ctx.session_opts,
+                                              kOrtSessionOptionsConfigSaveModelFormat, "ORT");
+    }
+    if (status) {
+      LOGE("Optimized model output setup failed: %s", ctx.ort->GetErrorMessage(status));
+      ctx.ort->ReleaseStatus(status);
+      return 4;
+    }
   }
 
-  status = ctx.ort->CreateSession(ctx.env, model_path, ctx.session_opts, &ctx.session);
+  if (is_ort_format(*ctx.model)) {
+    const char* keys[] = {kOrtSessionOptionsConfigUseORTModelBytesDirectly,
+                          kOrtSessionOptionsConfigUseORTModelBytesForInitializers};
+    for (const char* key : keys) {
+      status = ctx.ort->AddSessionConfigEntry(ctx.session_opts, key, "1");
+      if (status) {
+        LOGE("AddSessionConfigEntry(%s) failed: %s", key, ctx.ort->GetErrorMessage(status));
+        ctx.ort->ReleaseStatus(status);
+        return 4;
+      }
+    }
+  }
+
+  LogTimer session_timer;
+  OrtPrepackedWeightsContainer* prepacked = prepacked_weights(ctx.ort);
+  if (prepacked) {
+    status = ctx.ort->CreateSessionFromArrayWithPrepackedWeightsContainer(
+        ctx.env, ctx.model->data(), ctx.model->size(), ctx.session_opts, prepacked,
+        &ctx.session);
+  } else {
+    status = ctx.ort->CreateSessionFromArray(ctx.env, ctx.model->data(), ctx.model->size(),
+                                             ctx.session_opts, &ctx.session);
+  }
   if (status) {
     LOGE("CreateSession failed: %s", ctx.ort->GetErrorMessage(status));
     ctx.ort->ReleaseStatus(status);
-    result.error_code = 4;
-    return result;
+    if (!temp_path.empty()) unlink(temp_path.c_str());
+    return 4;
+  }
+  LOGI("Session created in %.1f ms (%s)", session_timer.elapsed_ms(),
+       optimized ? "cached optimized model" : "optimized at load");
+
+  if (!temp_path.empty()) {
+    if (rename(temp_path.c_str(), optimized_path.c_str()) == 0) {
+      LOGI("Saved optimized model: %s", optimized_path.c_str());
+      remove_stale_optimized_models(*ctx.model, optimized_path);
+    } else {
+      unlink(temp_path.c_str());
+    }
   }
 
   status = ctx.ort->GetAllocatorWithDefaultOptions(&ctx.allocator);
   if (status) {
     LOGE("GetAllocator failed: %s", ctx.ort->GetErrorMessage(status));
     ctx.ort->ReleaseStatus(status);
-    result.error_code = 4;
-    return result;
+    return 4;
   }
 
   status = ctx.ort->SessionGetInputName(ctx.session, 0, ctx.allocator, &ctx.input_name);
   if (status) {
     LOGE("SessionGetInputName failed: %s", ctx.ort->GetErrorMessage(status));
     ctx.ort->ReleaseStatus(status);
-    result.error_code = 4;
-    return result;
+    return 4;
   }
   status = ctx.ort->SessionGetOutputName(ctx.session, 0, ctx.allocator, &ctx.output_name);
   if (status) {
     LOGE("SessionGetOutputName failed: %s", ctx.ort->GetErrorMessage(status));
     ctx.ort->ReleaseStatus(status);
-    result.error_code = 4;
-    return result;
+    return 4;
   }
 
   status = ctx.ort->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &ctx.mem_info);
   if (status) {
     LOGE("CreateCpuMemoryInfo failed: %s", ctx.ort->GetErrorMessage(status));
     ctx.ort->ReleaseStatus(status);
-    result.error_code = 4;
-    return result;
+    return 4;
   }
 
-  std::vector<float> avg_output(NUM_CLASSES, 0.0f);
+  return 0;
+}
+
+// 1 パッチ分の推論を行い、NUM_CLASSES 個の活性値を out に書き込む
+// 戻り値は 0=成功, 3=解析エラー
+static int run_patch(OrtContext& ctx, std::vector<float>& patch, float* out) {
   const int64_t input_shape[] = {1, PATCH_FRAMES, NUM_BANDS};
 
-  for (size_t p = 0; p < patches.size(); p++) {
-    if (is_cancelled(cancel_flag)) {
-      result.error_code = 1;
-      return result;
-    }
+  OrtValue* input_tensor = nullptr;
+  OrtStatus* status = ctx.ort->CreateTensorWithDataAsOrtValue(
+      ctx.mem_info, patch.data(), patch.size() * sizeof(float), input_shape, 3,
+      ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &input_tensor);
+  if (status) {
+    LOGE("CreateTensor failed: %s", ctx.ort->GetErrorMessage(status));
+    ctx.ort->ReleaseStatus(status);
+    return 3;
+  }
 
-    OrtValue* input_tensor = nullptr;
-    status = ctx.ort->CreateTensorWithDataAsOrtValue(
-        ctx.mem_info, patches[p].data(), patches[p].size() * sizeof(float), input_shape, 3,
-        ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &input_tensor);
-    if (status) {
-      LOGE("CreateTensor failed for patch %zu: %s", p, ctx.ort->GetErrorMessage(status));
-      ctx.ort->ReleaseStatus(status);
-      result.error_code = 3;
-      return result;
-    }
+  OrtValue* output_tensor = nullptr;
+  const char* input_names[] = {ctx.input_name};
+  const char* output_names[] = {ctx.output_name};
 
-    OrtValue* output_tensor = nullptr;
-    const char* input_names[] = {ctx.input_name};
-    const char* output_names[] = {ctx.output_name};
+  {
+    ThreadBudgetGuard budgetGuard(ThreadBudget::instance().ort_intra_op_threads());
+    status = ctx.ort->Run(ctx.session, nullptr, input_names,
+                          (const OrtValue* const*)&input_tensor, 1, output_names, 1,
+                          &output_tensor);
+  }
+  if (status) {
+    LOGE("Run failed: %s", ctx.ort->GetErrorMessage(status));
+    ctx.ort->ReleaseStatus(status);
+    ctx.ort->ReleaseValue(input_tensor);
+    return 3;
+  }
 
-    status = ctx.ort->Run(ctx.session, nullptr, input_names, (const OrtValue* const*)&input_tensor,
-                          1, output_names, 1, &output_tensor);
-    if (status) {
-      LOGE("Run failed for patch %zu: %s", p, ctx.ort->GetErrorMessage(status));
-      ctx.ort->ReleaseStatus(status);
-      ctx.ort->ReleaseValue(input_tensor);
-      result.error_code = 3;
-      return result;
-    }
+  float* output_data = nullptr;
+  status = ctx.ort->GetTensorMutableData(output_tensor, (void**)&output_data);
+  if (status) {
+    LOGE("GetTensorMutableData failed: %s", ctx.ort->GetErrorMessage(status));
+    ctx.ort->ReleaseStatus(status);
+    ctx.ort->ReleaseValue(output_tensor);
+    ctx.ort->ReleaseValue(input_tensor);
+    return 3;
+  }
 
-    float* output_data = nullptr;
-    status = ctx.ort->GetTensorMutableData(output_tensor, (void**)&output_data);
-    if (status) {
-      LOGE("GetTensorMutableData failed: %s", ctx.ort->GetErrorMessage(status));
-      ctx.ort->ReleaseStatus(status);
-      ctx.ort->ReleaseValue(output_tensor);
-      ctx.ort->ReleaseValue(input_tensor);
-      result.error_code = 3;
-      return result;
-    }
+  std::copy(output_data, output_data + NUM_CLASSES, out);
+
+  ctx.ort->ReleaseValue(output_tensor);
+  ctx.ort->ReleaseValue(input_tensor);
+  return 0;
+}
+
+// 全パッチを推論して出力を平均する。戻り値は StyleResult::error_code と同じ体系
+static int average_patches(OrtContext& ctx, std::vector<std::vector<float> >& patches,
+                           std::vector<float>& avg_output, EssentiaCancelFlag* cancel_flag) {
+  avg_output.assign(NUM_CLASSES, 0.0f);
+  std::vector<float> patch_output(NUM_CLASSES);
+
+  for (size_t p = 0; p < patches.size(); p++) {
+    if (is_cancelled(cancel_flag)) return 1;
+
+    int run_ret = run_patch(ctx, patches[p], patch_output.data());
+    if (run_ret != 0) return run_ret;
 
     for (int c = 0; c < NUM_CLASSES; c++) {
-      avg_output[c] += output_data[c];
+      avg_output[c] += patch_output[c];
     }
-
-    ctx.ort->ReleaseValue(output_tensor);
-    ctx.ort->ReleaseValue(input_tensor);
   }
 
   for (int c = 0; c < NUM_CLASSES; c++) {
     avg_output[c] /= (float)patches.size();
   }
+  return 0;
+}
 
-  std::vector<int> indices(NUM_CLASSES);
+static std::vector<int> top_indices(const std::vector<float>& scores, int k) {
+  std::vector<int> indices(scores.size());
   std::iota(indices.begin(), indices.end(), 0);
-  std::partial_sort(indices.begin(), indices.begin() + STYLE_MAX_RESULTS, indices.end(),
-                    [&avg_output](int a, int b) { return avg_output[a] > avg_output[b]; });
+  std::partial_sort(indices.begin(), indices.begin() + k, indices.end(),
+                    [&scores](int a, int b) { return scores[a] > scores[b]; });
+  indices.resize(k);
+  return indices;
+}
 
+static void fill_top_results(const std::vector<float>& avg_output, StyleResult& result) {
+  std::vector<int> indices = top_indices(avg_output, STYLE_MAX_RESULTS);
   result.count = STYLE_MAX_RESULTS;
   for (int i = 0; i < STYLE_MAX_RESULTS; i++) {
     result.indices[i] = indices[i];
     result.confidences[i] = avg_output[indices[i]];
   }
+}
+
+// 層化サンプリング順：トラック全体を 8 区間に分けた中央から始め、区間を倍々に細分化していく
+static std::vector<std::vector<size_t> > stratified_rounds(size_t num_patches) {
+  std::vector<std::vector<size_t> > rounds;
+  std::vector<bool> visited(num_patches, false);
+  size_t strata = std::min(num_patches, (size_t)FAST_INITIAL_PATCHES);
+  while (true) {
+    std::vector<size_t> round;
+    for (size_t s = 0; s < strata; s++) {
+      size_t idx = (2 * s + 1) * num_patches / (2 * strata);
+      if (!visited[idx]) {
+        visited[idx] = true;
+        round.push_back(idx);
+      }
+    }
+    if (!round.empty()) rounds.push_back(std::move(round));
+    if (strata >= num_patches) break;
+    strata = std::min(num_patches, strata * 2);
+  }
+
+  std::vector<size_t> rest;
+  for (size_t i = 0; i < num_patches; i++) {
+    if (!visited[i]) rest.push_back(i);
+  }
+  if (!rest.empty()) rounds.push_back(std::move(rest));
+  return rounds;
+}
+
+static StyleResult classify_full(TrackAudio& audio, const char* model_path,
+                                 EssentiaCancelFlag* cancel_flag) {
+  StyleResult result = {};
+  result.count = 0;
+  result.error_code = 0;
+
+  std::vector<std::vector<float> > patches;
+  int mel_ret = compute_mel_patches(audio, patches, cancel_flag);
+  if (mel_ret != 0) {
+    result.error_code = mel_ret;
+    return result;
+  }
+
+  OrtContext ctx;
+  int ort_ret = init_ort_context(ctx, model_path);
+  if (ort_ret != 0) {
+    result.error_code = ort_ret;
+    return result;
+  }
+
+  std::vector<float> avg_output;
+  int run_ret = average_patches(ctx, patches, avg_output, cancel_flag);
+  if (run_ret != 0) {
+    result.error_code = run_ret;
+    return result;
+  }
+
+  fill_top_results(avg_output, result);
+  result.patches_evaluated = (int32_t)patches.size();
+  result.patches_total = (int32_t)patches.size();
+  result.error_code = 0;
+
+  return result;
+}
+
+static StyleResult classify_fast(TrackAudio& audio, const char* model_path,
+                                 float stability_threshold, EssentiaCancelFlag* cancel_flag) {
+  StyleResult result = {};
+  result.count = 0;
+  result.error_code = 0;
+
+  std::vector<std::vector<float> > patches;
+  int mel_ret = compute_mel_patches(audio, patches, cancel_flag);
+  if (mel_ret != 0) {
+    result.error_code = mel_ret;
+    return result;
+  }
+
+  OrtContext ctx;
+  int ort_ret = init_ort_context(ctx, model_path);
+  if (ort_ret != 0) {
+    result.error_code = ort_ret;
+    return result;
+  }
+
+  std::vector<float> sum_output(NUM_CLASSES, 0.0f);
+  std::vector<float> mean_output(NUM_CLASSES, 0.0f);
+  std::vector<float> patch_output(NUM_CLASSES);
+  std::vector<int> prev_top;
+  std::vector<float> prev_conf;
+  int evaluated = 0;
+
+  // ラウンドごとに上位 5 件の順位と信頼度の変化を確認し、安定したら打ち切る
+  for (const std::vector<size_t>& round : stratified_rounds(patches.size())) {
+    for (size_t p : round) {
+      if (is_cancelled(cancel_flag)) {
+        result.error_code = 1;
+        return result;
+      }
+
+      int run_ret = run_patch(ctx, patches[p], patch_output.data());
+      if (run_ret != 0) {
+        result.error_code = run_ret;
+        return result;
+      }
+
+      for (int c = 0; c < NUM_CLASSES; c++) {
+        sum_output[c] += patch_output[c];
+      }
+      evaluated++;
+    }
+
+    for (int c = 0; c < NUM_CLASSES; c++) {
+      mean_output[c] = sum_output[c] / (float)evaluated;
+    }
+
+    std::vector<int> top = top_indices(mean_output, STYLE_MAX_RESULTS);
+    bool stable = !prev_top.empty() && top == prev_top;
+    for (int i = 0; stable && i < STYLE_MAX_RESULTS; i++) {
+      if (std::fabs(mean_output[top[i]] - prev_conf[i]) > stability_threshold) stable = false;
+    }
+    if (stable) break;
+
+    prev_top = top;
+    prev_conf.resize(STYLE_MAX_RESULTS);
+    for (int i = 0; i < STYLE_MAX_RESULTS; i++) {
+      prev_conf[i] = mean_output[top[i]];
+    }
+  }
+
+  LOGI("Fast style: evaluated %d/%zu patches", evaluated, patches.size());
+
+  fill_top_results(mean_output, result);
+  result.patches_evaluated = evaluated;
+  result.patches_total = (int32_t)patches.size();
   result.error_code = 0;
 
   return result;
 }
 
+static StyleResult classify_excerpt(TrackAudio& audio, const char* model_path,
+                                    float excerpt_seconds, float min_margin,
+                                    EssentiaCancelFlag* cancel_flag) {
+  StyleResult result = {};
+  result.count = 0;
+  result.error_code = 0;
+
+  std::vector<std::vector<float> > patches;
+  int mel_ret = compute_excerpt_mel_patches(
+      audio.path(), excerpt_seconds > 0 ? excerpt_seconds : DEFAULT_EXCERPT_SECONDS, patches,
+      cancel_flag);
+  if (mel_ret < 0) {
+    LOGI("Excerpt unavailable, classifying full track");
+    return classify_full(audio, model_path, cancel_flag);
+  }
+  if (mel_ret != 0) {
+    result.error_code = mel_ret;
+    return result;
+  }
+
+  OrtContext ctx;
+  int ort_ret = init_ort_context(ctx, model_path);
+  if (ort_ret != 0) {
+    result.error_code = ort_ret;
+    return result;
+  }
+
+  std::vector<float> avg_output;
+  int run_ret = average_patches(ctx, patches, avg_output, cancel_flag);
+  if (run_ret != 0) {
+    result.error_code = run_ret;
+    return result;
+  }
+
+  fill_top_results(avg_output, result);
+  result.patches_evaluated = (int32_t)patches.size();
+  result.patches_total = (int32_t)patches.size();
+
+  // 1 位と 2 位の差が小さければ抜粋では判断できないとみなして全曲で推論し直す
+  float margin = result.count >= 2 ? result.confidences[0] - result.confidences[1]
+                                   : (result.count == 1 ? result.confidences[0] : 0.0f);
+  if (margin < min_margin) {
+    LOGI("Excerpt style margin %.3f < %.3f, classifying full track", margin, min_margin);
+    return classify_full(audio, model_path, cancel_flag);
+  }
+
+  LOGI("Excerpt style: %zu patches, margin %.3f", patches.size(), margin);
+  return result;
+}
+
+StyleResult classify_track_style(TrackAudio& audio, const char* model_path, int32_t mode,
+                                 float stability_threshold, float excerpt_seconds,
+                                 float min_margin, EssentiaCancelFlag* cancel_flag) {
+  if (!model_path) {
+    StyleResult result = {};
+    result.error_code = 4;
+    return result;
+  }
+  switch (mode) {
+    case ESSENTIA_STYLE_FAST:
+      return classify_fast(audio, model_path, stability_threshold, cancel_flag);
+    case ESSENTIA_STYLE_EXCERPT:
+      return classify_excerpt(audio, model_path, excerpt_seconds, min_margin, cancel_flag);
+    default:
+      return classify_full(audio, model_path, cancel_flag);
+  }
+}
+
+extern "C" {
+
+StyleResult essentia_classify_style(const char* audio_path, const char* model_path,
+                                    EssentiaCancelFlag* cancel_flag) {
+  TrackAudio audio(audio_path, cancel_flag);
+  return classify_full(audio, model_path, cancel_flag);
+}
+
+StyleResult essentia_classify_style_fast(const char* audio_path, const char* model_path,
+                                         float stability_threshold,
+                                         EssentiaCancelFlag* cancel_flag) {
+  TrackAudio audio(audio_path, cancel_flag);
+  return classify_fast(audio, model_path, stability_threshold, cancel_flag);
+}
+
+StyleResult essentia_classify_style_excerpt(const char* audio_path, const char* model_path,
+                                            float excerpt_seconds, float min_margin,
+                                            EssentiaCancelFlag* cancel_flag) {
+  TrackAudio audio(audio_path, cancel_flag);
+  return classify_excerpt(audio, model_path, excerpt_seconds, min_margin, cancel_flag);
+}
+
+StyleTimeline* essentia_classify_style_timeline(const char* audio_path, const char* model_path,
+                                                int32_t patches_per_segment, int32_t top_k,
+                                                EssentiaCancelFlag* cancel_flag) {
+  StyleTimeline* timeline = (StyleTimeline*)malloc(sizeof(StyleTimeline));
+  if (!timeline) return nullptr;
+
+  if (patches_per_segment < 1) patches_per_segment = 1;
+  top_k = std::max(1, std::min(top_k, (int32_t)NUM_CLASSES));
+
+  timeline->indices = nullptr;
+  timeline->confidences = nullptr;
+  timeline->num_segments = 0;
+  timeline->top_k = top_k;
+  timeline->segment_duration =
+      (float)(patches_per_segment * PATCH_FRAMES * HOP_SIZE) / (float)STYLE_SR;
+  timeline->summary = StyleResult();
+  timeline->error_code = 0;
+
+  TrackAudio audio(audio_path, cancel_flag);
+  std::vector<std::vector<float> > patches;
+  int mel_ret = compute_mel_patches(audio, patches, cancel_flag);
+  if (mel_ret != 0) {
+    timeline->error_code = mel_ret;
+    return timeline;
+  }
+
+  OrtContext ctx;
+  int ort_ret = init_ort_context(ctx, model_path);
+  if (ort_ret != 0) {
+    timeline->error_code = ort_ret;
+    return timeline;
+  }
+
+  int num_segments = ((int)patches.size() + patches_per_segment - 1) / patches_per_segment;
+  timeline->indices = (int32_t*)malloc(sizeof(int32_t) * num_segments * top_k);
+  timeline->confidences = (float*)malloc(sizeof(float) * num_segments * top_k);
+  if (!timeline->indices || !timeline->confidences) {
+    LOGE("Failed to allocate timeline arrays");
+    free(timeline->indices);
+    free(timeline->confidences);
+    timeline->indices = nullptr;
+    timeline->confidences = nullptr;
+    timeline->error_code = 3;
+    return timeline;
+  }
+
+  std::vector<float> avg_output(NUM_CLASSES, 0.0f);
+  std::vector<float> segment_output(NUM_CLASSES, 0.0f);
+  std::vector<float> patch_output(NUM_CLASSES);
+  int segment = 0;
+  int segment_patches = 0;
+
+  for (size_t p = 0; p < patches.size(); p++) {
+    if (is_cancelled(cancel_flag)) {
+      timeline->error_code = 1;
+      return timeline;
+    }
+
+    int run_ret = run_patch(ctx, patches[p], patch_output.data());
+    if (run_ret != 0) {
+      timeline->error_code = run_ret;
+      return timeline;
+    }
+
+    for (int c = 0; c < NUM_CLASSES; c++) {
+      avg_output[c] += patch_output[c];
+      segment_output[c] += patch_output[c];
+    }
+    segment_patches++;
+
+    // セグメント単位で平均し上位 k 件だけを残す
+    if (segment_patches == patches_per_segment || p + 1 == patches.size()) {
+      for (int c = 0; c < NUM_CLASSES; c++) {
+        segment_output[c] /= (float)segment_patches;
+      }
+      std::vector<int> top = top_indices(segment_output, top_k);
+      for (int i = 0; i < top_k; i++) {
+        timeline->indices[segment * top_k + i] = top[i];
+        timeline->confidences[segment * top_k + i] = segment_output[top[i]];
+      }
+      std::fill(segment_output.begin(), segment_output.end(), 0.0f);
+      segment_patches = 0;
+      segment++;
+    }
+  }
+
+  for (int c = 0; c < NUM_CLASSES; c++) {
+    avg_output[c] /= (float)patches.size();
+  }
+
+  timeline->num_segments = num_segments;
+  fill_top_results(avg_output, timeline->summary);
+  timeline->summary.patches_evaluated = (int32_t)patches.size();
+  timeline->summary.patches_total = (int32_t)patches.size();
+
+  LOGI("Style timeline computed: %d segments x top %d", num_segments, top_k);
+  return timeline;
+}
+
+void essentia_free_style_timeline(StyleTimeline* timeline) {
+  if (timeline) {
+    free(timeline->indices);
+    free(timeline->confidences);
+    free(timeline);
+  }
+}
+
+void essentia_set_model_cache_dir(const char* dir) { model_cache_set_dir(dir); }
+
 }  // extern "C"
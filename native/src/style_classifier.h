@@ -13,12 +13,46 @@ typedef struct {
   int32_t count;                       // 0..STYLE_MAX_RESULTS
   int32_t indices[STYLE_MAX_RESULTS];  // label indices (0..399)
   float confidences[STYLE_MAX_RESULTS];
+  int32_t patches_evaluated;  // patches run through the model
+  int32_t patches_total;      // patches available in the track
   int32_t error_code;  // 0=success, 1=cancelled, 2=decode error, 3=analysis error, 4=model error
 } StyleResult;
 
+// Directory where ORT-optimized copies of the model are cached. Empty or NULL disables caching.
+void essentia_set_model_cache_dir(const char* dir);
+
 StyleResult essentia_classify_style(const char* audio_path, const char* model_path,
                                     EssentiaCancelFlag* cancel_flag);
 
+// Evaluates patches in stratified order and stops once the top results change by no more than
+// stability_threshold between rounds.
+StyleResult essentia_classify_style_fast(const char* audio_path, const char* model_path,
+                                         float stability_threshold,
+                                         EssentiaCancelFlag* cancel_flag);
+
+// Classifies only the middle and loudest windows, excerpt_seconds in total (<= 0 = 45 s), and
+// redoes the whole track when the top-1/top-2 confidence margin is below min_margin or the
+// track is too short to excerpt. patches_total counts the patches of whichever pass is returned.
+StyleResult essentia_classify_style_excerpt(const char* audio_path, const char* model_path,
+                                            float excerpt_seconds, float min_margin,
+                                            EssentiaCancelFlag* cancel_flag);
+
+typedef struct {
+  int32_t* indices;     // numSegments * topK label indices, best first (heap-allocated)
+  float* confidences;   // numSegments * topK mean activations (heap-allocated)
+  int32_t num_segments;
+  int32_t top_k;
+  float segment_duration;  // seconds covered by one segment (last one may be shorter)
+  StyleResult summary;     // whole-track top results from the same inference pass
+  int32_t error_code;  // 0=success, 1=cancelled, 2=decode error, 3=analysis error, 4=model error
+} StyleTimeline;
+
+StyleTimeline* essentia_classify_style_timeline(const char* audio_path, const char* model_path,
+                                                int32_t patches_per_segment, int32_t top_k,
+                                                EssentiaCancelFlag* cancel_flag);
+
+void essentia_free_style_timeline(StyleTimeline* timeline);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,209 @@
+#include "tempo_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "frame_engine.h"
+
+static const int ONSET_SAMPLE_RATE = 11025;
+static const int ONSET_FRAME_SIZE = 512;
+static const int ONSET_HOP_SIZE = 128;  // 約 86 フレーム/秒
+static const float MIN_BPM = 40.0f;
+static const float MAX_BPM = 220.0f;
+static const float BPM_STEP = 0.25f;
+static const int COMB_HARMONICS = 4;
+static const int MAX_ESTIMATES = 5;
+
+// 整数比で間引く。エイリアス防止に Hamming 窓付き sinc の FIR を通す
+static std::vector<float> decimate(const std::vector<float>& in, int factor) {
+  if (factor <= 1) return in;
+
+  static const int kTaps = 64;
+  const float cutoff = 0.45f / (float)factor;  // 入力サンプルレート基準の正規化周波数
+  std::vector<float> taps(kTaps);
+  float sum = 0;
+  for (int i = 0; i < kTaps; i++) {
+    float x = (float)i - (kTaps - 1) * 0.5f;
+    float sinc = x == 0 ? 2.0f * cutoff : sinf(2.0f * (float)M_PI * cutoff * x) / ((float)M_PI * x);
+    float window = 0.54f - 0.46f * cosf(2.0f * (float)M_PI * i / (kTaps - 1));
+    taps[i] = sinc * window;
+    sum += taps[i];
+  }
+  for (float& t : taps) t /= sum;
+
+  const int n = (int)in.size();
+  std::vector<float> out(n / factor);
+  for (size_t o = 0; o < out.size(); o++) {
+    int center = (int)o * factor;
+    float acc = 0;
+    for (int i = 0; i < kTaps; i++) {
+      int idx = center + i - kTaps / 2;
+      if (idx >= 0 && idx < n) acc += in[idx] * taps[i];
+    }
+    out[o] = acc;
+  }
+  return out;
+}
+
+// 対数圧縮した振幅スペクトルの半波整流差分（スペクトルフラックス）
+class OnsetEnvelope : public FrameConsumer {
+ public:
+  std::vector<float> values;
+
+  void consume(const std::vector<float>& spectrum) override {
+    if (previous_.empty()) previous_.assign(spectrum.size(), 0.0f);
+    float flux = 0;
+    for (size_t k = 0; k < spectrum.size(); k++) {
+      float mag = log1pf(spectrum[k]);
+      float diff = mag - previous_[k];
+      if (diff > 0) flux += diff;
+      previous_[k] = mag;
+    }
+    values.push_back(flux);
+  }
+
+ private:
+  std::vector<float> previous_;
+};
+
+// 局所平均を引いて半波整流し、音量変化ではなくアタックだけを残す
+static void whiten_envelope(std::vector<float>& env) {
+  static const int kRadius = 8;
+  const int n = (int)env.size();
+  std::vector<float> prefix(n + 1, 0.0f);
+  for (int i = 0; i < n; i++) prefix[i + 1] = prefix[i] + env[i];
+
+  std::vector<float> out(n);
+  for (int i = 0; i < n; i++) {
+    int lo = std::max(0, i - kRadius);
+    int hi = std::min(n, i + kRadius + 1);
+    float mean = (prefix[hi] - prefix[lo]) / (float)(hi - lo);
+    out[i] = std::max(0.0f, env[i] - mean);
+  }
+  env.swap(out);
+}
+
+static float interpolate(const std::vector<float>& v, float pos) {
+  int i = (int)pos;
+  if (i < 0 || i + 1 >= (int)v.size()) return 0.0f;
+  float frac = pos - (float)i;
+  return v[i] * (1.0f - frac) + v[i + 1] * frac;
+}
+
+int estimate_tempo_fast(const std::vector<float>& audio, int sample_rate, TempoEstimate& out,
+                        EssentiaCancelFlag* cancel_flag) {
+  const int factor = std::max(1, sample_rate / ONSET_SAMPLE_RATE);
+  const float envelope_rate = (float)sample_rate / (float)factor / (float)ONSET_HOP_SIZE;
+
+  std::vector<float> decimated = decimate(audio, factor);
+  if (essentia_cancel_flag_is_set(cancel_flag)) return 1;
+
+  OnsetEnvelope onset;
+  FrameEngine engine(sample_rate / factor);
+  engine.add_consumer(ONSET_FRAME_SIZE, ONSET_HOP_SIZE, &onset);
+  if (engine.run(decimated, cancel_flag) != 0) return 1;
+
+  std::vector<float>& env = onset.values;
+  whiten_envelope(env);
+  const int n = (int)env.size();
+
+  // 最も遅いテンポの倍音まで届く範囲で自己相関を取る
+  const int max_lag = std::min(n - 1, (int)std::ceil(60.0f * envelope_rate / MIN_BPM) *
+                                          COMB_HARMONICS + 1);
+  if (max_lag < (int)(60.0f * envelope_rate / MAX_BPM) * 2) return 0;
+
+  std::vector<float> acf(max_lag + 1, 0.0f);
+  for (int lag = 0; lag <= max_lag; lag++) {
+    if (lag % 64 == 0 && essentia_cancel_flag_is_set(cancel_flag)) return 1;
+    float acc = 0;
+    for (int i = lag; i < n; i++) acc += env[i] * env[i - lag];
+    acf[lag] = acc / (float)(n - lag);
+  }
+  if (acf[0] <= 0) return 0;
+  for (float& a : acf) a /= acf[0];
+
+  // コムフィルタ：周期の整数倍の自己相関を加重和し、125 BPM 中心の対数正規事前分布を掛ける
+  const int num_candidates = (int)((MAX_BPM - MIN_BPM) / BPM_STEP) + 1;
+  std::vector<float> scores(num_candidates);
+  for (int c = 0; c < num_candidates; c++) {
+    float bpm = MIN_BPM + c * BPM_STEP;
+    float period = 60.0f * envelope_rate / bpm;
+    float comb = 0;
+    for (int h = 1; h <= COMB_HARMONICS; h++) {
+      comb += interpolate(acf, period * h) / (float)h;
+    }
+    float octaves = log2f(bpm / 125.0f);
+    scores[c] = comb * expf(-0.5f * octaves * octaves);
+  }
+
+  std::vector<int> peaks;
+  for (int c = 1; c + 1 < num_candidates; c++) {
+    if (scores[c] > scores[c - 1] && scores[c] >= scores[c + 1]) peaks.push_back(c);
+  }
+  if (peaks.empty()) return 0;
+  std::sort(peaks.begin(), peaks.end(), [&scores](int a, int b) { return scores[a] > scores[b]; });
+
+  // 放物線補間で候補グリッドより細かく最大値を求める
+  int best = peaks[0];
+  float a = scores[best - 1], b = scores[best], c = scores[best + 1];
+  float denom = a - 2.0f * b + c;
+  float offset = denom < 0 ? 0.5f * (a - c) / denom : 0.0f;
+  out.bpm = MIN_BPM + ((float)best + offset) * BPM_STEP;
+
+  for (size_t i = 0; i < peaks.size() && (int)i < MAX_ESTIMATES; i++) {
+    out.estimates.push_back(MIN_BPM + peaks[i] * BPM_STEP);
+  }
+
+  float period = 60.0f * envelope_rate / out.bpm;
+  // 信頼度は拍周期での正規化自己相関そのもの。RhythmExtractor2013 の値とは比べられないので、
+  // 抜粋の打ち切りには fast 専用の閾値を使う
+  out.confidence = std::max(0.0f, std::min(1.0f, interpolate(acf, period)));
+
+  // 位相合わせ：周期を ±1.5% の範囲で振りながら、グリッド上のオンセット強度の和が
+  // 最大になる周期と開始位置を選ぶ（ラグの量子化誤差が曲の後半で積み上がるのを防ぐ）
+  const float base_period = period;
+  float best_phase = 0;
+  float best_sum = -1;
+  for (int p = -15; p <= 15; p++) {
+    float candidate = base_period * (1.0f + 0.001f * p);
+    for (float phase = 0; phase < candidate; phase += 0.5f) {
+      float sum = 0;
+      for (float pos = phase; pos < n - 1; pos += candidate) sum += interpolate(env, pos);
+      if (sum > best_sum) {
+        best_sum = sum;
+        best_phase = phase;
+        period = candidate;
+      }
+    }
+  }
+  out.bpm = 60.0f * envelope_rate / period;
+
+  // 各拍は周期の 1 割以内で最寄りのオンセットへ寄せる
+  const int snap = std::max(1, (int)(period * 0.1f));
+  for (float pos = best_phase; pos <= n - 1; pos += period) {
+    int center = (int)std::lround(pos);
+    int peak = center;
+    for (int i = std::max(0, center - snap); i <= std::min(n - 1, center + snap); i++) {
+      if (env[i] > env[peak]) peak = i;
+    }
+    out.ticks.push_back((float)peak / envelope_rate);
+  }
+
+  // 拍位置の回帰直線の傾きで BPM を自己相関のラグ分解能より細かく補正する
+  const size_t count = out.ticks.size();
+  if (count >= 8) {
+    double mean_i = (count - 1) * 0.5;
+    double mean_t = 0;
+    for (float t : out.ticks) mean_t += t;
+    mean_t /= count;
+    double cov = 0, var = 0;
+    for (size_t i = 0; i < count; i++) {
+      cov += (i - mean_i) * (out.ticks[i] - mean_t);
+      var += (i - mean_i) * (i - mean_i);
+    }
+    float fitted = (float)(60.0 * var / cov);
+    if (cov > 0 && std::fabs(fitted - out.bpm) < out.bpm * 0.02f) out.bpm = fitted;
+  }
+
+  return 0;
+}
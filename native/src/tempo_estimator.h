@@ -0,0 +1,22 @@
+#ifndef TEMPO_ESTIMATOR_H
+#define TEMPO_ESTIMATOR_H
+
+#include <vector>
+
+#include "essentia_bridge.h"
+
+struct TempoEstimate {
+  float bpm = 0;
+  float confidence = 0;  // precise は RhythmExtractor2013 の 0–5.32、fast は 0–1（尺度は別）
+  std::vector<float> ticks;      // 拍位置（秒）
+  std::vector<float> estimates;  // BPM 候補（スコア降順）
+};
+
+// 約 11 kHz に間引いた信号のオンセット包絡から自己相関とコムフィルタでテンポを推定する
+// RhythmExtractor2013 より大幅に軽い代わりに、テンポは曲全体で一定とみなす
+// Essentia のアルゴリズムを使わないため、グローバルロックなしで呼べる
+// 戻り値は 0=成功, 1=キャンセル
+int estimate_tempo_fast(const std::vector<float>& audio, int sample_rate, TempoEstimate& out,
+                        EssentiaCancelFlag* cancel_flag);
+
+#endif  // TEMPO_ESTIMATOR_H
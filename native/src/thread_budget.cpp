@@ -0,0 +1,69 @@
+#include "thread_budget.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "essentia_bridge.h"
+
+static int hardware_threads() {
+  unsigned int n = std::thread::hardware_concurrency();
+  return n > 0 ? (int)n : 1;
+}
+
+ThreadBudget& ThreadBudget::instance() {
+  static ThreadBudget budget;
+  return budget;
+}
+
+ThreadBudget::ThreadBudget() { configure(0, 0, 0); }
+
+void ThreadBudget::configure(int max_threads, int ort_intra_op_threads,
+                             int ort_inter_op_threads) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  max_threads_ = max_threads > 0 ? max_threads : hardware_threads();
+  // 既定では推論中も DSP ワーカー 1 本分の余裕を残す
+  ort_intra_op_threads_ =
+      ort_intra_op_threads > 0 ? ort_intra_op_threads : std::max(1, max_threads_ - 1);
+  ort_intra_op_threads_ = std::min(ort_intra_op_threads_, max_threads_);
+  ort_inter_op_threads_ = ort_inter_op_threads > 0 ? ort_inter_op_threads : 1;
+  available_.notify_all();
+}
+
+int ThreadBudget::max_threads() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return max_threads_;
+}
+
+int ThreadBudget::ort_intra_op_threads() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return ort_intra_op_threads_;
+}
+
+int ThreadBudget::ort_inter_op_threads() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return ort_inter_op_threads_;
+}
+
+int ThreadBudget::acquire(int slots) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  slots = std::max(1, std::min(slots, max_threads_));
+  available_.wait(lock,
+                  [this, slots]() { return in_use_ + slots <= max_threads_ || in_use_ == 0; });
+  in_use_ += slots;
+  return slots;
+}
+
+void ThreadBudget::release(int slots) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  in_use_ -= slots;
+  available_.notify_all();
+}
+
+extern "C" {
+
+void essentia_set_thread_budget(int32_t max_threads, int32_t ort_intra_op_threads,
+                                int32_t ort_inter_op_threads) {
+  ThreadBudget::instance().configure(max_threads, ort_intra_op_threads, ort_inter_op_threads);
+}
+
+}  // extern "C"
@@ -0,0 +1,46 @@
+#ifndef THREAD_BUDGET_H
+#define THREAD_BUDGET_H
+
+#include <condition_variable>
+#include <mutex>
+
+// ブリッジ内で同時に実行するスレッド数をコア数の予算内に収めるためのカウンタ
+// DSP ワーカーは 1 スロット、ORT の推論は intra-op スレッド数分のスロットを確保してから動く
+class ThreadBudget {
+ public:
+  static ThreadBudget& instance();
+
+  void configure(int max_threads, int ort_intra_op_threads, int ort_inter_op_threads);
+
+  int max_threads();
+  int ort_intra_op_threads();
+  int ort_inter_op_threads();
+
+  // 予算を超える要求は予算いっぱいに丸める。戻り値は実際に確保したスロット数
+  int acquire(int slots);
+  void release(int slots);
+
+ private:
+  ThreadBudget();
+
+  std::mutex mutex_;
+  std::condition_variable available_;
+  int max_threads_;
+  int ort_intra_op_threads_;
+  int ort_inter_op_threads_;
+  int in_use_ = 0;
+};
+
+class ThreadBudgetGuard {
+ public:
+  explicit ThreadBudgetGuard(int slots) : slots_(ThreadBudget::instance().acquire(slots)) {}
+  ~ThreadBudgetGuard() { ThreadBudget::instance().release(slots_); }
+
+  ThreadBudgetGuard(const ThreadBudgetGuard&) = delete;
+  ThreadBudgetGuard& operator=(const ThreadBudgetGuard&) = delete;
+
+ private:
+  int slots_;
+};
+
+#endif  // THREAD_BUDGET_H
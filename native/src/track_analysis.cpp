@@ -0,0 +1,198 @@
+#include "track_analysis.h"
+
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "dart_port.h"
+#include "essentia_lock.h"
+#include "thread_budget.h"
+#include "track_audio.h"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "TrackAnalysis"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGI(...)
+#define LOGE(...)
+#endif
+
+// 16 kHz は Discogs-EffNet の入力レート（style_classifier.cpp の STYLE_SR）
+static const int STYLE_SAMPLE_RATE = 16000;
+
+// 次の段が使う形式を今ある中間データから作っておき、元のデータを早めに解放できるようにする
+// 失敗はここでは扱わず、TrackAudio が覚えた error_code をその段が返す
+static void prepare_mono(TrackAudio& audio, int sample_rate) {
+  ThreadBudgetGuard budgetGuard(1);
+  std::lock_guard<std::mutex> essentiaGuard(essentiaGlobalMutex());
+  const std::vector<float>* unused;
+  audio.mono(sample_rate, &unused);
+}
+
+// 節の error_code。節が NULL なのは確保の失敗なので解析失敗として扱う
+static int32_t section_error(const EssentiaTrackAnalysis* result, int32_t feature) {
+  switch (feature) {
+    case ESSENTIA_FEATURE_TEMPO_KEY:
+      return result->analysis ? result->analysis->result.error_code : 3;
+    case ESSENTIA_FEATURE_STYLE:
+      return result->style.error_code;
+    case ESSENTIA_FEATURE_SPECTRUM:
+      return result->spectrum ? result->spectrum->error_code : 3;
+    default:
+      return result->stereo_peaks ? result->stereo_peaks->error_code : 3;
+  }
+}
+
+// 要求された節が終わるたびに呼ばれる（on_section が NULL なら呼ばない）
+typedef void (*SectionCallback)(int32_t feature, int32_t error_code, void* user);
+
+static EssentiaTrackAnalysis* analyze_track(const char* path, const EssentiaTrackConfig* config,
+                                            EssentiaCancelFlag* cancel_flag,
+                                            SectionCallback on_section, void* user) {
+  EssentiaTrackAnalysis* result = (EssentiaTrackAnalysis*)calloc(1, sizeof(EssentiaTrackAnalysis));
+  if (!result) return nullptr;
+  if (!config) {
+    result->error_code = 3;
+    return result;
+  }
+
+  const int32_t features = config->features;
+  const bool styleFromFullTrack = config->style_mode != ESSENTIA_STYLE_EXCERPT;
+  result->features = features;
+  LOGI("Analyzing track: path=%s, features=0x%x", path, features);
+
+  auto finished = [&](int32_t feature) {
+    if (on_section) on_section(feature, section_error(result, feature), user);
+  };
+
+  TrackAudio audio(path, cancel_flag);
+
+  // ステレオのデコードが必要な段を先に済ませ、モノラルを作ったら左右は捨てる
+  if (features & ESSENTIA_FEATURE_STEREO_PEAKS) {
+    result->stereo_peaks =
+        compute_track_stereo_peaks(audio, config->peak_hop_size, config->silence_start_db,
+                                   config->silence_end_db, cancel_flag);
+    finished(ESSENTIA_FEATURE_STEREO_PEAKS);
+    // 全曲を読む段（16 kHz の全曲を作る様式も含む）があるときだけ作る
+    // 抜粋モードの段が全曲へ切り替えたときは、その場でデコードし直す
+    const bool tempoFromFullTrack =
+        (features & ESSENTIA_FEATURE_TEMPO_KEY) && !config->analysis.excerpt_mode;
+    if (tempoFromFullTrack || (features & ESSENTIA_FEATURE_SPECTRUM) ||
+        ((features & ESSENTIA_FEATURE_STYLE) && styleFromFullTrack)) {
+      prepare_mono(audio, TrackAudio::SOURCE_RATE);
+    }
+    audio.release_stereo();
+  }
+
+  if (features & ESSENTIA_FEATURE_TEMPO_KEY) {
+    result->analysis = analyze_track_tempo_key(audio, &config->analysis, cancel_flag);
+    finished(ESSENTIA_FEATURE_TEMPO_KEY);
+  }
+
+  if (features & ESSENTIA_FEATURE_SPECTRUM) {
+    result->spectrum =
+        compute_track_spectrum_u8(audio, config->spectrum_bands, config->spectrum_frame_size,
+                                  config->spectrum_hop_size, cancel_flag);
+    finished(ESSENTIA_FEATURE_SPECTRUM);
+  }
+
+  if (features & ESSENTIA_FEATURE_STYLE) {
+    // 抜粋モードは全曲に切り替えるまで 16 kHz の全曲を使わないため、作るのはそのときに任せる
+    if (styleFromFullTrack) {
+      prepare_mono(audio, STYLE_SAMPLE_RATE);
+      audio.release_mono(TrackAudio::SOURCE_RATE);
+    }
+    result->style = classify_track_style(
+        audio, config->model_path, config->style_mode, config->style_stability_threshold,
+        config->style_excerpt_seconds, config->style_min_margin, cancel_flag);
+    finished(ESSENTIA_FEATURE_STYLE);
+  }
+
+  result->decodes = audio.decodes();
+
+  const int32_t order[] = {ESSENTIA_FEATURE_TEMPO_KEY, ESSENTIA_FEATURE_STYLE,
+                           ESSENTIA_FEATURE_SPECTRUM, ESSENTIA_FEATURE_STEREO_PEAKS};
+  for (int i = 0; i < 4 && result->error_code == 0; i++) {
+    if (features & order[i]) result->error_code = section_error(result, order[i]);
+  }
+
+  LOGI("Track analyzed: features=0x%x, %d decodes, error %d", features, result->decodes,
+       result->error_code);
+  return result;
+}
+
+// essentia_analyze_track_async の 1 件分。呼び出し元のメモリは戻った後に解放されるため複製して持つ
+struct TrackJob {
+  std::string path;
+  std::string model_path;
+  bool has_model_path;
+  EssentiaTrackConfig config;
+  EssentiaCancelFlag* cancel_flag;
+  int64_t dart_port;
+};
+
+static void post_section(int32_t feature, int32_t error_code, void* user) {
+  const TrackJob* job = (const TrackJob*)user;
+  const int64_t message[] = {ESSENTIA_TRACK_MESSAGE_SECTION, feature, error_code};
+  post_dart_int64_array(job->dart_port, message, 3);
+}
+
+static void run_track_job(TrackJob* owned) {
+  std::unique_ptr<TrackJob> job(owned);
+  job->config.model_path = job->has_model_path ? job->model_path.c_str() : nullptr;
+
+  EssentiaTrackAnalysis* result =
+      analyze_track(job->path.c_str(), &job->config, job->cancel_flag, post_section, job.get());
+
+  // DONE の後は cancel_flag に触れない（受け取った側が破棄する）
+  const int64_t message[] = {ESSENTIA_TRACK_MESSAGE_DONE, (int64_t)(intptr_t)result};
+  if (!post_dart_int64_array(job->dart_port, message, 2)) {
+    LOGE("Could not post track analysis, port %lld closed", (long long)job->dart_port);
+    essentia_free_track_analysis(result);
+  }
+}
+
+extern "C" {
+
+EssentiaTrackAnalysis* essentia_analyze_track(const char* path, const EssentiaTrackConfig* config,
+                                              EssentiaCancelFlag* cancel_flag) {
+  return analyze_track(path, config, cancel_flag, nullptr, nullptr);
+}
+
+int32_t essentia_analyze_track_async(const char* path, const EssentiaTrackConfig* config,
+                                     EssentiaCancelFlag* cancel_flag, int64_t dart_port) {
+  if (!dart_post_available() || !path || !config) return -1;
+
+  std::unique_ptr<TrackJob> job(new TrackJob());
+  job->path = path;
+  job->has_model_path = config->model_path != nullptr;
+  if (job->has_model_path) job->model_path = config->model_path;
+  job->config = *config;
+  job->cancel_flag = cancel_flag;
+  job->dart_port = dart_port;
+
+  // 段ごとのスレッド予算とロックは各段が取るので、ワーカーは要求ごとに立てるだけでよい
+  try {
+    std::thread(run_track_job, job.get()).detach();
+  } catch (const std::exception& e) {
+    LOGE("Could not start track analysis thread: %s", e.what());
+    return -1;
+  }
+  job.release();
+  return 0;
+}
+
+void essentia_free_track_analysis(EssentiaTrackAnalysis* analysis) {
+  if (analysis) {
+    essentia_free_analysis(analysis->analysis);
+    essentia_free_spectrum_u8(analysis->spectrum);
+    essentia_free_stereo_peaks(analysis->stereo_peaks);
+    free(analysis);
+  }
+}
+
+}  // extern "C"
@@ -0,0 +1,79 @@
+#ifndef TRACK_ANALYSIS_H
+#define TRACK_ANALYSIS_H
+
+#include "essentia_bridge.h"
+#include "spectrum_analyzer.h"
+#include "style_classifier.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sections of EssentiaTrackAnalysis, combined as a bitmask in EssentiaTrackConfig.features.
+#define ESSENTIA_FEATURE_TEMPO_KEY (1 << 0)     // as essentia_analyze_detailed
+#define ESSENTIA_FEATURE_STYLE (1 << 1)         // as essentia_classify_style*
+#define ESSENTIA_FEATURE_SPECTRUM (1 << 2)      // as essentia_compute_spectrum_u8
+#define ESSENTIA_FEATURE_STEREO_PEAKS (1 << 3)  // as essentia_compute_stereo_peaks
+
+// style_mode values for EssentiaTrackConfig.
+#define ESSENTIA_STYLE_FULL 0     // essentia_classify_style
+#define ESSENTIA_STYLE_FAST 1     // essentia_classify_style_fast
+#define ESSENTIA_STYLE_EXCERPT 2  // essentia_classify_style_excerpt
+
+typedef struct {
+  int32_t features;                  // ESSENTIA_FEATURE_* bitmask
+  EssentiaAnalysisOptions analysis;  // TEMPO_KEY
+  const char* model_path;            // STYLE
+  int32_t style_mode;                // ESSENTIA_STYLE_*
+  float style_stability_threshold;   // ESSENTIA_STYLE_FAST
+  float style_excerpt_seconds;       // ESSENTIA_STYLE_EXCERPT (<= 0 = 45 s)
+  float style_min_margin;            // ESSENTIA_STYLE_EXCERPT
+  int32_t spectrum_bands;            // SPECTRUM
+  int32_t spectrum_frame_size;
+  int32_t spectrum_hop_size;
+  int32_t peak_hop_size;  // STEREO_PEAKS
+  float silence_start_db;
+  float silence_end_db;
+} EssentiaTrackConfig;
+
+// Sections that were not requested are NULL (style: count 0, error_code 0). Each section keeps
+// its own error_code, so a failed style model still returns the tempo and key.
+typedef struct {
+  int32_t features;              // sections that were requested
+  EssentiaAnalysis* analysis;    // TEMPO_KEY; errors in analysis->result.error_code
+  StyleResult style;             // STYLE
+  SpectrumDataU8* spectrum;      // SPECTRUM
+  StereoPeakData* stereo_peaks;  // STEREO_PEAKS
+  int32_t decodes;     // times the file was decoded for the whole call
+  int32_t error_code;  // first section error in the order above, 0 when every section succeeded
+} EssentiaTrackAnalysis;
+
+// Runs the requested sections on one track in a single call. The file is decoded once per
+// format and shared between sections: 44.1 kHz stereo (peaks) also yields the 44.1 kHz mono
+// (tempo/key, spectrum), which is resampled to 16 kHz for the style model. Intermediates are
+// released as soon as no remaining section needs them. Returns NULL only when out of memory;
+// release with essentia_free_track_analysis.
+EssentiaTrackAnalysis* essentia_analyze_track(const char* path, const EssentiaTrackConfig* config,
+                                              EssentiaCancelFlag* cancel_flag);
+
+// Messages posted by essentia_analyze_track_async, each an array of int64 (List<int> in Dart).
+#define ESSENTIA_TRACK_MESSAGE_SECTION 0  // [type, ESSENTIA_FEATURE_* bit, section error_code]
+#define ESSENTIA_TRACK_MESSAGE_DONE 1     // [type, EssentiaTrackAnalysis* address]
+
+// Runs essentia_analyze_track on a bridge thread instead of the caller's. A SECTION message is
+// posted to dart_port (SendPort.nativePort) as each requested section finishes, then DONE with
+// the result, which the receiver releases with essentia_free_track_analysis (address 0 when out
+// of memory). path and config are copied before returning; cancel_flag must stay alive until
+// DONE arrives, so a receiver that stops listening earlier sets it and leaves it allocated.
+// Returns 0 when started, -1 when essentia_set_dart_post_cobject was not called or the thread
+// could not be started (nothing is posted then).
+int32_t essentia_analyze_track_async(const char* path, const EssentiaTrackConfig* config,
+                                     EssentiaCancelFlag* cancel_flag, int64_t dart_port);
+
+void essentia_free_track_analysis(EssentiaTrackAnalysis* analysis);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TRACK_ANALYSIS_H
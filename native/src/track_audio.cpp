@@ -0,0 +1,172 @@
+#include "track_audio.h"
+
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include "audio_decode.h"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "TrackAudio"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGI(...)
+#define LOGE(...)
+#endif
+
+#include <essentia/algorithmfactory.h>
+
+using namespace essentia;
+using namespace essentia::standard;
+
+static bool is_cancelled(EssentiaCancelFlag* flag) {
+  return essentia_cancel_flag_is_set(flag) != 0;
+}
+
+static void resample(std::vector<float>& signal, Real from_rate, Real to_rate) {
+  std::vector<float> resampled;
+  std::unique_ptr<Algorithm> rs(AlgorithmFactory::instance().create(
+      "Resample", "inputSampleRate", from_rate, "outputSampleRate", to_rate, "quality", 4));
+  rs->input("signal").set(signal);
+  rs->output("signal").set(resampled);
+  rs->compute();
+  signal = std::move(resampled);
+}
+
+TrackAudio::TrackAudio(const char* path, EssentiaCancelFlag* cancel_flag)
+    : path_(path), cancel_flag_(cancel_flag) {}
+
+TrackAudio::Mono* TrackAudio::find_mono(int sample_rate) {
+  for (Mono& mono : mono_) {
+    if (mono.sample_rate == sample_rate) return &mono;
+  }
+  return nullptr;
+}
+
+int TrackAudio::stereo(const std::vector<float>** left, const std::vector<float>** right,
+                       bool* is_stereo) {
+  if (stereo_error_ < 0) {
+    if (is_cancelled(cancel_flag_)) return 1;
+
+    std::vector<StereoSample> stereoAudio;
+    Real nativeSR;
+    int numChannels;
+    std::string md5, codec;
+    int bitRate;
+
+    decodes_++;
+    try {
+      std::unique_ptr<Algorithm> loader(AlgorithmFactory::instance().create(
+          "AudioLoader", "filename", std::string(path_), "computeMD5", false));
+      loader->output("audio").set(stereoAudio);
+      loader->output("sampleRate").set(nativeSR);
+      loader->output("numberChannels").set(numChannels);
+      loader->output("md5").set(md5);
+      loader->output("codec").set(codec);
+      loader->output("bit_rate").set(bitRate);
+      loader->compute();
+    } catch (const std::exception& e) {
+      LOGE("AudioLoader failed: %s", e.what());
+      stereo_error_ = 2;
+      return stereo_error_;
+    }
+
+    if (stereoAudio.empty()) {
+      LOGE("No stereo audio samples decoded");
+      stereo_error_ = 2;
+      return stereo_error_;
+    }
+    LOGI("Loaded %zu stereo samples at %.0f Hz, %d channels", stereoAudio.size(), nativeSR,
+         numChannels);
+
+    if (is_cancelled(cancel_flag_)) return 1;
+
+    const size_t n = stereoAudio.size();
+    is_stereo_ = numChannels >= 2;
+    left_.resize(n);
+    right_.resize(n);
+    for (size_t i = 0; i < n; i++) {
+      left_[i] = stereoAudio[i].left();
+      right_[i] = is_stereo_ ? stereoAudio[i].right() : stereoAudio[i].left();
+    }
+    stereoAudio.clear();
+
+    if (std::abs(nativeSR - (float)SOURCE_RATE) > 1.0f) {
+      LOGI("Resampling from %.0f to %d Hz", nativeSR, SOURCE_RATE);
+      try {
+        resample(left_, nativeSR, (Real)SOURCE_RATE);
+        resample(right_, nativeSR, (Real)SOURCE_RATE);
+      } catch (const std::exception& e) {
+        LOGE("Resample failed: %s", e.what());
+        left_.clear();
+        right_.clear();
+        stereo_error_ = 3;
+        return stereo_error_;
+      }
+    }
+    stereo_error_ = 0;
+  }
+
+  if (stereo_error_ != 0) return stereo_error_;
+  *left = &left_;
+  *right = &right_;
+  *is_stereo = is_stereo_;
+  return 0;
+}
+
+int TrackAudio::mono(int sample_rate, const std::vector<float>** out) {
+  Mono* cached = find_mono(sample_rate);
+  if (cached) {
+    if (cached->error_code != 0) return cached->error_code;
+    *out = &cached->samples;
+    return 0;
+  }
+  if (is_cancelled(cancel_flag_)) return 1;
+
+  Mono entry;
+  entry.sample_rate = sample_rate;
+  entry.error_code = 0;
+  const std::vector<float>* source = nullptr;
+
+  if (sample_rate == SOURCE_RATE && stereo_error_ == 0) {
+    // MonoLoader の MonoMixer と同じ (L + R) / 2
+    entry.samples.resize(left_.size());
+    for (size_t i = 0; i < left_.size(); i++) {
+      entry.samples[i] = is_stereo_ ? 0.5f * (left_[i] + right_[i]) : left_[i];
+    }
+  } else if (sample_rate != SOURCE_RATE && (stereo_error_ == 0 || find_mono(SOURCE_RATE)) &&
+             mono(SOURCE_RATE, &source) == 0) {
+    entry.samples = *source;
+    try {
+      resample(entry.samples, (Real)SOURCE_RATE, (Real)sample_rate);
+    } catch (const std::exception& e) {
+      LOGE("Resample failed: %s", e.what());
+      entry.samples.clear();
+      entry.error_code = 3;
+    }
+  } else {
+    decodes_++;
+    int decode_ret = decode_audio(path_, entry.samples, sample_rate, cancel_flag_);
+    if (decode_ret == 1) return 1;  // キャンセルは覚えない
+    if (decode_ret < 0) entry.error_code = 2;
+  }
+
+  if (entry.error_code == 0 && entry.samples.empty()) entry.error_code = 2;
+  mono_.push_back(std::move(entry));
+  Mono& stored = mono_.back();
+  if (stored.error_code != 0) return stored.error_code;
+  *out = &stored.samples;
+  return 0;
+}
+
+void TrackAudio::release_stereo() {
+  std::vector<float>().swap(left_);
+  std::vector<float>().swap(right_);
+  if (stereo_error_ == 0) stereo_error_ = -1;
+}
+
+void TrackAudio::release_mono(int sample_rate) {
+  mono_.remove_if([sample_rate](const Mono& mono) { return mono.sample_rate == sample_rate; });
+}
@@ -0,0 +1,77 @@
+#ifndef TRACK_AUDIO_H
+#define TRACK_AUDIO_H
+
+#include <list>
+#include <vector>
+
+#include "essentia_bridge.h"
+#include "spectrum_analyzer.h"
+#include "style_classifier.h"
+
+// 1 曲のデコード結果を解析の段の間で共有する。同じ形式はファイルから 1 度だけデコードし、
+// 44.1 kHz のステレオがあればモノラルはその平均、他のレートは 44.1 kHz のモノラルを
+// リサンプルして作る。MonoLoader と同じ処理の順なので、44.1 kHz の音源では単独でデコードした
+// 場合と同じ値になる（他のレートの音源はリサンプルが 1 段増える）
+// デコードに失敗した形式は結果の error_code を覚えておき、2 度目は読みに行かない
+class TrackAudio {
+ public:
+  static const int SOURCE_RATE = 44100;
+
+  TrackAudio(const char* path, EssentiaCancelFlag* cancel_flag);
+
+  TrackAudio(const TrackAudio&) = delete;
+  TrackAudio& operator=(const TrackAudio&) = delete;
+
+  const char* path() const { return path_; }
+  int decodes() const { return decodes_; }  // ファイルをデコードした回数
+
+  // 以下は Essentia のロックを保持して呼ぶこと
+  // 戻り値は error_code（0=成功, 1=キャンセル, 2=デコード失敗, 3=解析失敗）
+
+  // SOURCE_RATE の左右チャンネル。モノラルの音源は left と right に同じ値を返す
+  int stereo(const std::vector<float>** left, const std::vector<float>** right,
+             bool* is_stereo);
+  // sample_rate のモノラル
+  int mono(int sample_rate, const std::vector<float>** out);
+
+  // 以降の段で使わない形式を解放する
+  void release_stereo();
+  void release_mono(int sample_rate);
+
+ private:
+  struct Mono {
+    int sample_rate;
+    int error_code;
+    std::vector<float> samples;
+  };
+
+  Mono* find_mono(int sample_rate);
+
+  const char* path_;
+  EssentiaCancelFlag* cancel_flag_;
+  int decodes_ = 0;
+  int stereo_error_ = -1;  // -1 = 未デコード
+  bool is_stereo_ = false;
+  std::vector<float> left_, right_;
+  std::list<Mono> mono_;  // 返したポインタが動かないよう list に置く
+};
+
+// essentia_analyze_track の各段。デコードを TrackAudio から受け取る以外は、対応する公開関数
+// （essentia_analyze_detailed, essentia_classify_style*, essentia_compute_spectrum_u8,
+// essentia_compute_stereo_peaks）と同じ結果を返し、ロックとスレッド予算もそれぞれが取る
+EssentiaAnalysis* analyze_track_tempo_key(TrackAudio& audio, const EssentiaAnalysisOptions* options,
+                                          EssentiaCancelFlag* cancel_flag);
+
+StyleResult classify_track_style(TrackAudio& audio, const char* model_path, int32_t mode,
+                                 float stability_threshold, float excerpt_seconds,
+                                 float min_margin, EssentiaCancelFlag* cancel_flag);
+
+SpectrumDataU8* compute_track_spectrum_u8(TrackAudio& audio, int32_t num_bands,
+                                          int32_t frame_size, int32_t hop_size,
+                                          EssentiaCancelFlag* cancel_flag);
+
+StereoPeakData* compute_track_stereo_peaks(TrackAudio& audio, int32_t hop_size,
+                                           float silence_start_db, float silence_end_db,
+                                           EssentiaCancelFlag* cancel_flag);
+
+#endif  // TRACK_AUDIO_H
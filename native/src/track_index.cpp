@@ -0,0 +1,166 @@
+#include "track_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <numeric>
+#include <queue>
+#include <vector>
+
+#include "simd.h"
+
+// 半分・倍のテンポで一致した候補に足す距離
+static const float HALF_DOUBLE_PENALTY = 0.25f;
+// 同じ調 0、隣接・平行調 KEY_NEIGHBOUR_DISTANCE、それ以外と不明は KEY_OTHER_DISTANCE
+static const float KEY_NEIGHBOUR_DISTANCE = 0.5f;
+static const float KEY_OTHER_DISTANCE = 1.0f;
+// エネルギー差 0.5 で 1、ラウドネス差 6 LU で 1
+static const float ENERGY_WEIGHT = 2.0f;
+static const float LOUDNESS_WEIGHT = 1.0f / 6.0f;
+static const float MIN_LOUDNESS = -70.0f;
+static const int CAMELOT_CODES = 24;
+
+struct EssentiaTrackIndex {
+  // 列ごとに連続させ、テンポ列だけを SIMD で走査する
+  std::vector<float> bpm;
+  std::vector<int8_t> camelot;
+  std::vector<float> energy;
+  std::vector<float> loudness;
+  mutable std::vector<uint32_t> candidates;
+};
+
+// query と同じ番号・同じ記号、番号が ±1（12 と 1 は隣接）、同じ番号の A/B を 1 とする表
+static void camelot_neighbours(int code, bool out[CAMELOT_CODES]) {
+  std::fill(out, out + CAMELOT_CODES, false);
+  if (code < 0 || code >= CAMELOT_CODES) return;
+  const int number = code / 2, letter = code % 2;
+  out[((number + 1) % 12) * 2 + letter] = true;
+  out[((number + 11) % 12) * 2 + letter] = true;
+  out[number * 2 + (1 - letter)] = true;
+}
+
+struct MatchLess {
+  bool operator()(const EssentiaTrackMatch& a, const EssentiaTrackMatch& b) const {
+    return a.distance < b.distance || (a.distance == b.distance && a.row < b.row);
+  }
+};
+
+extern "C" {
+
+EssentiaTrackIndex* essentia_track_index_create(void) {
+  return new (std::nothrow) EssentiaTrackIndex();
+}
+
+int32_t essentia_track_index_load(EssentiaTrackIndex* index, const float* bpm,
+                                  const int8_t* camelot, const float* energy,
+                                  const float* loudness, int32_t count) {
+  if (!index) return 3;
+  const size_t n = count > 0 ? (size_t)count : 0;
+  try {
+    index->bpm.assign(bpm, bpm + n);
+    index->camelot.assign(camelot, camelot + n);
+    index->energy.assign(energy, energy + n);
+    index->loudness.assign(loudness, loudness + n);
+    index->candidates.resize(n);
+  } catch (const std::bad_alloc&) {
+    index->bpm.clear();
+    index->camelot.clear();
+    index->energy.clear();
+    index->loudness.clear();
+    index->candidates.clear();
+    return 3;
+  }
+  return 0;
+}
+
+int32_t essentia_track_index_query(const EssentiaTrackIndex* index,
+                                   const EssentiaTrackQuery* query, EssentiaTrackMatch* out,
+                                   int32_t max_results) {
+  if (!index || !query || !out || max_results <= 0) return 0;
+  const size_t n = index->bpm.size();
+  uint32_t* candidates = index->candidates.data();
+
+  // テンポの範囲で絞り込む。半分・倍を含めると範囲は 3 つ
+  const float ref = query->bpm;
+  const float tol = std::max(query->bpm_tolerance, 0.0f);
+  static const float RATIOS[3] = {1.0f, 0.5f, 2.0f};
+  const int numRatios = query->half_double ? 3 : 1;
+  const float invTol = tol > 0 ? 1.0f / tol : 1.0f;
+  float invTarget[3];
+  size_t count;
+  if (ref > 0) {
+    float lo[3], hi[3];
+    for (int r = 0; r < numRatios; r++) {
+      lo[r] = ref * RATIOS[r] * (1.0f - tol);
+      hi[r] = ref * RATIOS[r] * (1.0f + tol);
+      invTarget[r] = 1.0f / (ref * RATIOS[r]);
+    }
+    count = simd::range_scan(index->bpm.data(), n, lo, hi, numRatios, candidates);
+  } else {
+    std::iota(candidates, candidates + n, 0u);
+    count = n;
+  }
+
+  const int key = query->camelot;
+  const bool useKey = key >= 0 && key < CAMELOT_CODES;
+  bool neighbours[CAMELOT_CODES];
+  camelot_neighbours(key, neighbours);
+  const bool useEnergy = query->energy >= 0;
+  const bool useLoudness = query->loudness > MIN_LOUDNESS;
+
+  // 距離の大きい順に並ぶヒープで上位 max_results 件だけを保持する
+  std::priority_queue<EssentiaTrackMatch, std::vector<EssentiaTrackMatch>, MatchLess> best;
+  for (size_t c = 0; c < count; c++) {
+    const uint32_t row = candidates[c];
+    if ((int32_t)row == query->exclude_row) continue;
+
+    // 調で落ちる行が多いため、テンポの距離より先に調を見る
+    float distance = 0;
+    const int rowKey = index->camelot[row];
+    if (useKey && rowKey != key) {
+      if (rowKey >= 0 && rowKey < CAMELOT_CODES && neighbours[rowKey]) {
+        distance += KEY_NEIGHBOUR_DISTANCE;
+      } else if (query->harmonic_only) {
+        continue;
+      } else {
+        distance += KEY_OTHER_DISTANCE;
+      }
+    }
+
+    if (ref > 0) {
+      float dev = HUGE_VALF;
+      for (int r = 0; r < numRatios; r++) {
+        float d = std::abs(index->bpm[row] * invTarget[r] - 1.0f) * invTol;
+        if (r > 0) d += HALF_DOUBLE_PENALTY;
+        dev = std::min(dev, d);
+      }
+      distance += dev;
+    }
+
+    if (useEnergy && index->energy[row] >= 0) {
+      distance += ENERGY_WEIGHT * std::abs(index->energy[row] - query->energy);
+    }
+    if (useLoudness && index->loudness[row] > MIN_LOUDNESS) {
+      distance += LOUDNESS_WEIGHT * std::abs(index->loudness[row] - query->loudness);
+    }
+
+    EssentiaTrackMatch match = {(int32_t)row, distance};
+    if ((int32_t)best.size() < max_results) {
+      best.push(match);
+    } else if (MatchLess()(match, best.top())) {
+      best.pop();
+      best.push(match);
+    }
+  }
+
+  const int32_t written = (int32_t)best.size();
+  for (int32_t i = written - 1; i >= 0; i--) {
+    out[i] = best.top();
+    best.pop();
+  }
+  return written;
+}
+
+void essentia_track_index_destroy(EssentiaTrackIndex* index) { delete index; }
+
+}  // extern "C"
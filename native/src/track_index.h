@@ -0,0 +1,52 @@
+#ifndef TRACK_INDEX_H
+#define TRACK_INDEX_H
+
+#include "essentia_bridge.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct EssentiaTrackIndex EssentiaTrackIndex;
+
+typedef struct {
+  float bpm;                // reference tempo, <= 0 = any tempo
+  float bpm_tolerance;      // relative, e.g. 0.06 = +-6 %
+  int32_t half_double;      // 1 = also match half and double time
+  int32_t camelot;          // reference key as a Camelot code (see load), -1 = any key
+  int32_t harmonic_only;    // 1 = keep only the same, adjacent or relative Camelot key
+  float energy;             // reference energy 0..1, < 0 = ignore
+  float loudness;           // reference integrated LUFS, <= -70 = ignore
+  int32_t exclude_row;      // row to leave out (usually the reference track), -1 = none
+} EssentiaTrackQuery;
+
+typedef struct {
+  int32_t row;
+  float distance;  // lower is a better fit
+} EssentiaTrackMatch;
+
+// Columnar in-memory index of per-track features for "what fits after this track" queries.
+// Queries scan the tempo column with SIMD range compares and rank the survivors; the index is
+// not synchronized, so load and query from one thread (or guard externally).
+EssentiaTrackIndex* essentia_track_index_create(void);
+
+// Replaces the contents with count rows; row i is the i-th element of every array.
+// camelot = (number - 1) * 2 + (1 for B / major, 0 for A / minor), -1 = unknown key.
+// bpm <= 0, energy < 0 and loudness <= -70 mark unknown values. Returns 0, or 3 when out of
+// memory (the index is then empty).
+int32_t essentia_track_index_load(EssentiaTrackIndex* index, const float* bpm,
+                                  const int8_t* camelot, const float* energy,
+                                  const float* loudness, int32_t count);
+
+// Writes up to max_results matches to out, best first, and returns how many were written.
+int32_t essentia_track_index_query(const EssentiaTrackIndex* index,
+                                   const EssentiaTrackQuery* query, EssentiaTrackMatch* out,
+                                   int32_t max_results);
+
+void essentia_track_index_destroy(EssentiaTrackIndex* index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TRACK_INDEX_H
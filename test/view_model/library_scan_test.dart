@@ -1,6 +1,10 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
 import 'package:audio_service/audio_service.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:segue/database/database.dart';
+import 'package:segue/src/native/audio_analysis.dart';
 import 'package:segue/usecase/library_scan.dart';
 
 void main() {
@@ -220,25 +224,172 @@ void main() {
       expect(tracks, ['c', 'a', 'b']);
     });
   });
+
+  group('computeAlbumGains', () {
+    Track measured(String path, double lufs, int ms, double peak) => _track(
+      path,
+      durationMs: ms,
+      integratedLufs: lufs,
+      trackGain: gainReferenceLufs - lufs,
+      trackPeak: peak,
+    );
+
+    test('equal tracks give the track gain and the max peak', () {
+      final albums = computeAlbumGains([
+        measured('/a', -12, 200000, 0.8),
+        measured('/b', -12, 100000, 0.95),
+      ]);
+      final album = albums['AL']!;
+      expect(album.gain, closeTo(-6, 1e-9));
+      expect(album.peak, 0.95);
+      expect(album.filePaths, ['/a', '/b']);
+    });
+
+    test('weights loudness by duration in the power domain', () {
+      final albums = computeAlbumGains([
+        measured('/a', -10, 100000, 1),
+        measured('/b', -20, 300000, 1),
+      ]);
+      // 10*log10((1*0.1 + 3*0.01) / 4) = -14.88
+      expect(albums['AL']!.gain, closeTo(-18 + 14.881, 1e-3));
+    });
+
+    test('uses the loudness behind the track gain', () {
+      final albums = computeAlbumGains([
+        _track(
+          '/a',
+          durationMs: 100000,
+          integratedLufs: -9,
+          trackGain: gainReferenceLufs + 12,
+          trackPeak: 1,
+        ),
+      ]);
+      expect(albums['AL']!.gain, closeTo(-6, 1e-9));
+    });
+
+    test('skips albums with unmeasured tracks or no album name', () {
+      final albums = computeAlbumGains([
+        measured('/a', -10, 100000, 1),
+        _track('/b'),
+        _track('/c', album: null, integratedLufs: -10, trackGain: -8),
+      ]);
+      expect(albums, isEmpty);
+    });
+  });
+
+  group('analysisDonors', () {
+    test('copies from an analyzed duplicate of about the same length', () {
+      final tracks = [
+        _track('/a.flac', durationMs: 200000, bpm: 128),
+        _track('/a.mp3', durationMs: 200400),
+        _track('/b.mp3', durationMs: 180000),
+      ];
+      final donors = analysisDonors(tracks, [
+        [DuplicateMember(0, 0), DuplicateMember(1, 0)],
+      ]);
+      expect(donors.keys, ['/a.mp3']);
+      expect(donors['/a.mp3']!.filePath, '/a.flac');
+    });
+
+    test('shifts beats and mix points by the offset between files', () {
+      final tracks = [
+        _track('/a.mp3', durationMs: 10000),
+        _track(
+          '/a.flac',
+          durationMs: 9500,
+          bpm: 120,
+          beatTicks: Float32List.fromList([0.25, 0.75, 9.25]),
+          mixPointsJson: jsonEncode([
+            {'in': true, 'start': 0.25, 'end': 4.25, 'beats': 16, 'score': 1},
+            {'in': false, 'start': 5.25, 'end': 9.25, 'beats': 16, 'score': 1},
+          ]),
+          previewStartUs: 2000000,
+        ),
+      ];
+      // /a.mp3 の 0.5 秒が /a.flac の 0 秒に当たる
+      final donors = analysisDonors(tracks, [
+        [DuplicateMember(0, 0), DuplicateMember(1, 0.5)],
+      ]);
+      final donor = donors['/a.mp3']!;
+      expect(
+        AnalysisResult.beatTicksFromBlob(donor.beatTicks!),
+        [0.75, 1.25, 9.75],
+      );
+      final points = MixPoint.listFromJson(donor.mixPointsJson!);
+      expect([for (final p in points) p.startSec], [0.75, 5.75]);
+      expect(donor.previewStartUs, 2500000);
+
+      // 逆向きでは曲頭より前に出る拍とミックスポイントを捨てる
+      final earlier = analysisDonors(tracks, [
+        [DuplicateMember(0, 0), DuplicateMember(1, -0.5)],
+      ])['/a.mp3']!;
+      expect(
+        AnalysisResult.beatTicksFromBlob(earlier.beatTicks!),
+        [0.25, 8.75],
+      );
+      final earlierPoints = MixPoint.listFromJson(earlier.mixPointsJson!);
+      expect([for (final p in earlierPoints) p.startSec], [4.75]);
+      expect(earlier.previewStartUs, 1500000);
+    });
+
+    test('skips groups without analysis and edits of another length', () {
+      final tracks = [
+        _track('/a.flac', durationMs: 200000, bpm: 128),
+        _track('/a_edit.mp3', durationMs: 150000),
+        _track('/b.flac', durationMs: 180000),
+        _track('/b.mp3', durationMs: 180000),
+        _track('/c.mp3'),
+      ];
+      final donors = analysisDonors(tracks, [
+        [DuplicateMember(0, 0), DuplicateMember(1, 0), DuplicateMember(4, 0)],
+        [DuplicateMember(2, 0), DuplicateMember(3, 0)],
+      ]);
+      expect(donors, isEmpty);
+    });
+  });
 }
 
-Track _track(String filePath, {String? artCachePath}) => Track(
+Track _track(
+  String filePath, {
+  String? artCachePath,
+  String? album = 'AL',
+  int? durationMs,
+  double? integratedLufs,
+  double? trackGain,
+  double? trackPeak,
+  double? bpm,
+  Float32List? beatTicks,
+  String? mixPointsJson,
+  int? previewStartUs,
+}) => Track(
   filePath: filePath,
   title: 'T',
-  album: 'AL',
+  album: album,
   artist: 'AR',
   discNumber: null,
   trackNumber: null,
-  durationMs: null,
+  durationMs: durationMs,
   artCachePath: artCachePath,
   waveCachePath: '/tmp/$filePath.wave',
-  bpm: null,
+  bpm: bpm,
   bpmConfidence: null,
   musicalKey: null,
   keyConfidence: null,
+  beatTicks: beatTicks?.buffer.asUint8List(),
   stylesJson: null,
   lufsCachePath: null,
-  integratedLufs: null,
+  integratedLufs: integratedLufs,
+  trackGain: trackGain,
+  trackPeak: trackPeak,
+  albumGain: null,
+  albumPeak: null,
+  contentStartUs: null,
+  contentEndUs: null,
+  mixPointsJson: mixPointsJson,
+  energy: null,
+  fingerprint: null,
+  previewStartUs: previewStartUs,
+  analysisVersion: null,
   scannedAt: DateTime(2026),
   analyzedAt: null,
 );